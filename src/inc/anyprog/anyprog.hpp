@@ -3,4 +3,5 @@
 #include "block.hpp"
 #include "fit.hpp"
 #include "equation.hpp"
-#include "util.hpp"
\ No newline at end of file
+#include "util.hpp"
+#include "autodiff.hpp"
\ No newline at end of file
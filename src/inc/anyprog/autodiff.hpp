@@ -0,0 +1,231 @@
+#ifndef ANYPROG_AUTODIFF_HPP
+#define ANYPROG_AUTODIFF_HPP
+
+#include "block.hpp"
+#include "optimization.hpp"
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace anyprog {
+namespace autodiff {
+
+    class var;
+
+    // Per-thread Wengert list. Each recorded operation keeps at most two parents and
+    // the local partial derivative towards each, so a reverse sweep costs a small
+    // constant multiple of the forward evaluation.
+    class tape {
+    public:
+        static const size_t npos = static_cast<size_t>(-1);
+
+    private:
+        struct node {
+            size_t parent[2];
+            double partial[2];
+        };
+        std::vector<node> nodes;
+        std::vector<double> adjoint;
+
+    public:
+        tape() = default;
+        virtual ~tape() = default;
+
+    public:
+        size_t push(size_t p0, double d0, size_t p1 = npos, double d1 = 0)
+        {
+            this->nodes.push_back({ { p0, p1 }, { d0, d1 } });
+            return this->nodes.size() - 1;
+        }
+        var variable(double);
+        void clear();
+        void backward(const var&, real_vector_map&);
+
+    public:
+        static tape& active();
+    };
+
+    class var {
+    private:
+        double val;
+        size_t id;
+
+    public:
+        var()
+            : val(0)
+            , id(tape::npos)
+        {
+        }
+        var(double v)
+            : val(v)
+            , id(tape::npos)
+        {
+        }
+        var(double v, size_t i)
+            : val(v)
+            , id(i)
+        {
+        }
+        double value() const { return this->val; }
+        size_t index() const { return this->id; }
+        bool is_constant() const { return this->id == tape::npos; }
+
+        var& operator+=(const var&);
+        var& operator-=(const var&);
+        var& operator*=(const var&);
+        var& operator/=(const var&);
+    };
+
+    typedef Eigen::Matrix<var, Eigen::Dynamic, 1> var_block;
+    typedef std::function<var(const var_block&)> function_t;
+
+    inline var unary(double v, const var& a, double da)
+    {
+        if (a.is_constant()) {
+            return var(v);
+        }
+        return var(v, tape::active().push(a.index(), da));
+    }
+    inline var binary(double v, const var& a, double da, const var& b, double db)
+    {
+        if (a.is_constant()) {
+            return unary(v, b, db);
+        }
+        if (b.is_constant()) {
+            return unary(v, a, da);
+        }
+        return var(v, tape::active().push(a.index(), da, b.index(), db));
+    }
+
+    inline var operator+(const var& a) { return a; }
+    inline var operator-(const var& a) { return unary(-a.value(), a, -1); }
+    inline var operator+(const var& a, const var& b) { return binary(a.value() + b.value(), a, 1, b, 1); }
+    inline var operator-(const var& a, const var& b) { return binary(a.value() - b.value(), a, 1, b, -1); }
+    inline var operator*(const var& a, const var& b) { return binary(a.value() * b.value(), a, b.value(), b, a.value()); }
+    inline var operator/(const var& a, const var& b)
+    {
+        double r = a.value() / b.value();
+        return binary(r, a, 1 / b.value(), b, -r / b.value());
+    }
+    inline var operator+(const var& a, double b) { return unary(a.value() + b, a, 1); }
+    inline var operator+(double a, const var& b) { return unary(a + b.value(), b, 1); }
+    inline var operator-(const var& a, double b) { return unary(a.value() - b, a, 1); }
+    inline var operator-(double a, const var& b) { return unary(a - b.value(), b, -1); }
+    inline var operator*(const var& a, double b) { return unary(a.value() * b, a, b); }
+    inline var operator*(double a, const var& b) { return unary(a * b.value(), b, a); }
+    inline var operator/(const var& a, double b) { return unary(a.value() / b, a, 1 / b); }
+    inline var operator/(double a, const var& b)
+    {
+        double r = a / b.value();
+        return unary(r, b, -r / b.value());
+    }
+
+    inline var& var::operator+=(const var& b) { return *this = *this + b; }
+    inline var& var::operator-=(const var& b) { return *this = *this - b; }
+    inline var& var::operator*=(const var& b) { return *this = *this * b; }
+    inline var& var::operator/=(const var& b) { return *this = *this / b; }
+
+    inline bool operator==(const var& a, const var& b) { return a.value() == b.value(); }
+    inline bool operator!=(const var& a, const var& b) { return a.value() != b.value(); }
+    inline bool operator<(const var& a, const var& b) { return a.value() < b.value(); }
+    inline bool operator<=(const var& a, const var& b) { return a.value() <= b.value(); }
+    inline bool operator>(const var& a, const var& b) { return a.value() > b.value(); }
+    inline bool operator>=(const var& a, const var& b) { return a.value() >= b.value(); }
+
+    inline var sqrt(const var& a)
+    {
+        double r = std::sqrt(a.value());
+        return unary(r, a, 0.5 / r);
+    }
+    inline var exp(const var& a)
+    {
+        double r = std::exp(a.value());
+        return unary(r, a, r);
+    }
+    inline var log(const var& a) { return unary(std::log(a.value()), a, 1 / a.value()); }
+    inline var log10(const var& a) { return unary(std::log10(a.value()), a, 1 / (a.value() * std::log(10.0))); }
+    inline var sin(const var& a) { return unary(std::sin(a.value()), a, std::cos(a.value())); }
+    inline var cos(const var& a) { return unary(std::cos(a.value()), a, -std::sin(a.value())); }
+    inline var tan(const var& a)
+    {
+        double r = std::tan(a.value());
+        return unary(r, a, 1 + r * r);
+    }
+    inline var asin(const var& a) { return unary(std::asin(a.value()), a, 1 / std::sqrt(1 - a.value() * a.value())); }
+    inline var acos(const var& a) { return unary(std::acos(a.value()), a, -1 / std::sqrt(1 - a.value() * a.value())); }
+    inline var atan(const var& a) { return unary(std::atan(a.value()), a, 1 / (1 + a.value() * a.value())); }
+    inline var sinh(const var& a) { return unary(std::sinh(a.value()), a, std::cosh(a.value())); }
+    inline var cosh(const var& a) { return unary(std::cosh(a.value()), a, std::sinh(a.value())); }
+    inline var tanh(const var& a)
+    {
+        double r = std::tanh(a.value());
+        return unary(r, a, 1 - r * r);
+    }
+    inline var abs(const var& a) { return unary(std::fabs(a.value()), a, a.value() < 0 ? -1 : 1); }
+    inline var fabs(const var& a) { return abs(a); }
+    inline var abs2(const var& a) { return a * a; }
+    inline var pow(const var& a, double b) { return unary(std::pow(a.value(), b), a, b == 0 ? 0 : b * std::pow(a.value(), b - 1)); }
+    inline var pow(double a, const var& b)
+    {
+        double r = std::pow(a, b.value());
+        return unary(r, b, r * std::log(a));
+    }
+    inline var pow(const var& a, const var& b)
+    {
+        double r = std::pow(a.value(), b.value());
+        return binary(r, a, b.value() == 0 ? 0 : b.value() * std::pow(a.value(), b.value() - 1), b, a.value() > 0 ? r * std::log(a.value()) : 0);
+    }
+    inline var atan2(const var& a, const var& b)
+    {
+        double d = a.value() * a.value() + b.value() * b.value();
+        return binary(std::atan2(a.value(), b.value()), a, b.value() / d, b, -a.value() / d);
+    }
+    inline var fmax(const var& a, const var& b) { return a < b ? b : a; }
+    inline var fmin(const var& a, const var& b) { return b < a ? b : a; }
+    inline var round(const var& a) { return var(std::round(a.value())); }
+    inline var floor(const var& a) { return var(std::floor(a.value())); }
+    inline var ceil(const var& a) { return var(std::ceil(a.value())); }
+
+    // Evaluates f at x and, when g is non-empty, fills g with the exact gradient through
+    // one forward pass on this thread's tape and one reverse sweep. The tape is cleared
+    // first, so an AD objective must not call another AD objective from inside itself.
+    double evaluate(const function_t& f, const const_real_vector_map& x, real_vector_map& g);
+
+    optimization::function_t value(const function_t&);
+    optimization::gradient_function_t gradient(const function_t&);
+    optimization::map_function_t map_function(const function_t&);
+    std::vector<optimization::function_t> value(const std::vector<function_t>&);
+    std::vector<optimization::gradient_function_t> gradient(const std::vector<function_t>&);
+    std::vector<optimization::map_function_t> map_function(const std::vector<function_t>&);
+}
+}
+
+namespace Eigen {
+template <>
+struct NumTraits<anyprog::autodiff::var> : GenericNumTraits<anyprog::autodiff::var> {
+    typedef anyprog::autodiff::var Real;
+    typedef anyprog::autodiff::var NonInteger;
+    typedef anyprog::autodiff::var Nested;
+    typedef anyprog::autodiff::var Literal;
+    enum {
+        IsComplex = 0,
+        IsInteger = 0,
+        IsSigned = 1,
+        RequireInitialization = 1,
+        ReadCost = 1,
+        AddCost = 3,
+        MulCost = 3
+    };
+};
+template <typename BinaryOp>
+struct ScalarBinaryOpTraits<anyprog::autodiff::var, double, BinaryOp> {
+    typedef anyprog::autodiff::var ReturnType;
+};
+template <typename BinaryOp>
+struct ScalarBinaryOpTraits<double, anyprog::autodiff::var, BinaryOp> {
+    typedef anyprog::autodiff::var ReturnType;
+};
+}
+
+#endif
@@ -10,6 +10,8 @@ namespace anyprog {
 
 typedef Eigen::MatrixXd real_block;
 typedef Eigen::MatrixXcd complex_block;
+typedef Eigen::Map<Eigen::VectorXd> real_vector_map;
+typedef Eigen::Map<const Eigen::VectorXd> const_real_vector_map;
 
 namespace block{
     real_block reshape(const real_block& ret, size_t rows, size_t cols);
@@ -2,12 +2,21 @@
 #define ANYPROG_OPTIMIZATION
 
 #include "block.hpp"
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 namespace anyprog {
+class evaluation_cache;
+class stats_recorder;
+class trace_recorder;
+class ask_tell_state;
+class process_pool_state;
 class optimization {
 public:
     typedef std::function<double(const real_block&)> function_t;
@@ -15,6 +24,15 @@ public:
     typedef function_t inequation_condition_function_t;
     typedef std::function<void(real_block&)> filter_function_t;
     typedef std::function<real_block(const real_block&)> gradient_function_t;
+    typedef std::function<double(const const_real_vector_map&, real_vector_map&)> map_function_t;
+    // Returns the objective at x and fills the equation and inequation values in one call;
+    // when the jacobian is not null it also fills its rows with the gradients of the
+    // objective, the equations and the inequations in that order.
+    typedef std::function<double(const real_block& x, real_block& eq, real_block& ineq, real_block* jacobian)> fused_function_t;
+    // Returns the objective at every column of an n x k block of points as k values.
+    typedef std::function<real_block(const real_block&)> batch_function_t;
+    // Called with the objective and the point of every new incumbent.
+    typedef std::function<void(double, const real_block&)> progress_function_t;
     typedef std::pair<double, double> range_t;
     typedef std::vector<std::pair<double, real_block>> history_t;
     enum method {
@@ -50,37 +68,205 @@ public:
         GN_AGS
     };
     enum solver_t {
-        NLOPT = 0
+        NLOPT = 0,
+        LP_SIMPLEX,
+        BRANCH_BOUND
+    };
+    class process_pool;
+    // What the solves since set_enable_stats() did. result is the nlopt_result of the
+    // last local solve, or the one the status of a linear solve maps to (a time budget
+    // stop is NLOPT_MAXTIME_REACHED), and evaluations sums nlopt_get_numevals; the
+    // calls count the user callbacks actually run (not cache hits), condition_calls by
+    // condition in the order eq_fun, map_eq_fun, ineq_fun, map_ineq_fun. The seconds
+    // are summed over threads, so in a parallel search they can exceed the wall clock.
+    // best holds the incumbent objective each time it improved, with the seconds since
+    // enabling.
+    // nodes, bound and gap follow the LP branch and bound of a linear integer solve.
+    class solve_stats {
+    public:
+        solve_stats()
+            : result(0)
+            , solves(0)
+            , failed(0)
+            , evaluations(0)
+            , objective_calls(0)
+            , fused_calls(0)
+            , condition_calls()
+            , rounds(0)
+            , reloops(0)
+            , solver_seconds(0)
+            , callback_seconds(0)
+            , best()
+            , nodes(0)
+            , bound(-std::numeric_limits<double>::infinity())
+            , gap(std::numeric_limits<double>::infinity())
+        {
+        }
+        virtual ~solve_stats() = default;
+        int result;
+        size_t solves, failed, evaluations, objective_calls, fused_calls;
+        std::vector<size_t> condition_calls;
+        size_t rounds, reloops;
+        double solver_seconds, callback_seconds;
+        std::vector<std::pair<double, double>> best;
+        size_t nodes;
+        double bound, gap;
+        std::string to_json() const;
+    };
+    // Flag shared by its copies that stops solves from any thread: running local solves
+    // are force-stopped at their next objective evaluation, linear solves at their next
+    // branch and bound node or within stop_interval pivots, and search() starts no
+    // further ones. It stays raised until reset().
+    class cancel_token {
+    public:
+        cancel_token();
+        virtual ~cancel_token() = default;
+        void cancel() const;
+        void reset() const;
+        bool is_cancelled() const;
+
+    private:
+        std::shared_ptr<std::atomic<bool>> flag;
     };
 
 private:
+    typedef std::pair<real_block, real_block> linear_condition_t;
+    // Last point handed to the fused function with its stacked results: value holds
+    // the objective, the equations and the inequations, jacobian their gradients by row.
+    class fused_point_t {
+    public:
+        fused_point_t()
+            : fun(0)
+            , x()
+            , value()
+            , jacobian()
+            , eq()
+            , ineq()
+            , ready(false)
+            , with_jacobian(false)
+            , calls(0)
+            , seconds(0)
+            , timed(false)
+        {
+        }
+        virtual ~fused_point_t() = default;
+        const optimization::fused_function_t* fun;
+        real_block x, value, jacobian, eq, ineq;
+        bool ready, with_jacobian;
+        size_t calls;
+        double seconds;
+        bool timed;
+    };
     class help_t {
     public:
         help_t()
-            : fun(0)
+            : fun()
             , filter(0)
-            , grad(0)
+            , buffer()
+            , linear(0)
+            , cache(0)
+            , slot(0)
+            , fused(0)
+            , batch(0)
+            , batch_point()
+            , batch_value()
+            , batch_next(0)
+            , calls(0)
+            , seconds(0)
+            , timed(false)
+            , trace(0)
+            , cancel(0)
+            , handle(0)
         {
         }
         virtual ~help_t() = default;
-        optimization::function_t* fun;
+        optimization::map_function_t fun;
         optimization::filter_function_t* filter;
-        optimization::gradient_function_t* grad;
+        real_block buffer;
+        const linear_condition_t* linear;
+        evaluation_cache* cache;
+        size_t slot;
+        fused_point_t* fused;
+        const optimization::batch_function_t* batch;
+        real_block batch_point, batch_value;
+        size_t batch_next;
+        size_t calls;
+        double seconds;
+        bool timed;
+        trace_recorder* trace;
+        const cancel_token* cancel;
+        void* handle;
+    };
+    class nlopt_context;
+    class nlopt_workspace;
+    class budget_scope;
+    class solver_state;
+    // Solver contexts kept between nlopt_solve calls. They point into the problem they
+    // were built for, so a copied problem starts with an empty workspace of its own.
+    class workspace_t {
+    public:
+        workspace_t();
+        workspace_t(const workspace_t&);
+        workspace_t& operator=(const workspace_t&);
+        virtual ~workspace_t() = default;
+        std::shared_ptr<nlopt_workspace> pool;
+    };
+    // Evaluation cache shared by the threads of one solve. Its keys are only (slot, x),
+    // so a copied problem starts with an empty cache of the same capacity.
+    class cache_t {
+    public:
+        cache_t();
+        cache_t(const cache_t&);
+        cache_t& operator=(const cache_t&);
+        virtual ~cache_t() = default;
+        std::shared_ptr<evaluation_cache> table;
+        size_t capacity;
     };
     solver_t solver;
     double fval;
     bool ok;
+    double gap;
     real_block point;
     function_t cb;
+    map_function_t map_cb;
     filter_function_t filter_cb;
     gradient_function_t grad_cb;
+    fused_function_t fused_cb;
+    size_t fused_eq, fused_ineq;
+    batch_function_t batch_cb;
     std::vector<equation_condition_function_t> eq_fun;
     std::vector<inequation_condition_function_t> ineq_fun;
     std::vector<gradient_function_t> eq_grad_fun, ineq_grad_fun;
+    std::vector<map_function_t> map_eq_fun, map_ineq_fun;
+    std::vector<linear_condition_t> eq_linear, ineq_linear;
+    real_block linear_obj;
+    std::vector<int> lp_basis;
+    std::vector<size_t> integer_index;
     std::vector<range_t> range;
     history_t history;
-    bool check(const real_block&, double) const;
+    size_t threads;
+    unsigned long seed;
+    cache_t cache;
+    workspace_t workspace;
+    real_block warm_step;
+    std::shared_ptr<solver_state> warm;
+    solver_state* recording;
+    std::shared_ptr<stats_recorder> stats;
+    std::shared_ptr<trace_recorder> trace;
+    double time_budget;
+    std::chrono::steady_clock::time_point deadline;
+    size_t budget_depth;
+    cancel_token cancel;
+    progress_function_t progress_cb;
+    bool check(const real_block&, double, fused_point_t* = 0) const;
+    void prepare(fused_point_t&) const;
+    double cached(size_t, const real_block&, const function_t&) const;
+    void clear_cache();
+    void reset_workspace();
+    void report_incumbent(double, const real_block&) const;
+    bool stopping() const;
     int select_nlopt_method(optimization::method) const;
+    bool is_linear() const;
 
 public:
     optimization() = delete;
@@ -92,6 +278,10 @@ public:
     optimization(const real_block&, const std::vector<range_t>& range);
     optimization(const real_block&, const range_t& range);
     optimization(const real_block&, const real_block&, const std::vector<range_t>& range);
+    optimization(const map_function_t&, const real_block&);
+    optimization(const map_function_t&, const std::vector<range_t>& range);
+    optimization(const map_function_t&, const range_t& range, size_t dim);
+    optimization(const map_function_t&, const real_block&, const std::vector<range_t>& range);
     virtual ~optimization() = default;
 
 public:
@@ -99,7 +289,12 @@ public:
     optimization& set_inequation_condition(const std::vector<inequation_condition_function_t>&);
     optimization& set_equation_condition(const real_block&, const real_block&);
     optimization& set_inequation_condition(const real_block&, const real_block&);
+    optimization& set_equation_condition(const std::vector<map_function_t>&);
+    optimization& set_inequation_condition(const std::vector<map_function_t>&);
     optimization& set_filter_function(const filter_function_t&);
+    optimization& set_fused_function(const fused_function_t&, size_t, size_t);
+    optimization& set_batch_function(const batch_function_t&);
+    optimization& set_process_pool(const process_pool&);
     optimization& set_gradient_function(const gradient_function_t&);
     optimization& set_equation_gradient_function(const std::vector<gradient_function_t>&);
     optimization& set_inequation_gradient_function(const std::vector<gradient_function_t>&);
@@ -108,21 +303,66 @@ public:
     optimization& set_enable_integer_filter(const std::vector<size_t>&);
     optimization& set_enable_binary_filter(const std::vector<size_t>&);
     optimization& set_solver(optimization::solver_t);
+    optimization& set_thread_number(size_t);
+    // Seeds the start points and range shrinking of search() and the generator NLopt's
+    // stochastic methods draw from, so a seeded run repeats for any thread count.
+    optimization& set_seed(unsigned long);
+    optimization& set_evaluation_cache(size_t);
+    optimization& update_equation_condition(size_t, const real_block&, const real_block&);
+    optimization& update_inequation_condition(size_t, const real_block&, const real_block&);
+    optimization& update_linear_objective(const real_block&);
+    optimization& set_data_changed();
+    optimization& set_enable_stats();
+    optimization& set_enable_trace(size_t = 65536);
+    optimization& set_time_budget(double);
+    optimization& set_cancel_token(const cancel_token&);
+    optimization& set_progress_function(const progress_function_t&);
     const history_t& get_history() const;
+    double get_cache_hit_rate() const;
+    solve_stats get_stats() const;
+    bool write_trace(const std::string&) const;
     bool is_ok() const;
+    // Inequation rows whose multiplier was positive in the last quadratic program of an
+    // LD_SLSQP solve() or resolve(), counted over the inequation conditions, then the
+    // rows of the linear inequations, then the fused ones.
+    const std::vector<size_t>& get_active_set() const;
+    // Relative gap between the last branch and bound solution and the lowest bound of
+    // the nodes a node limit left open; 0 when the tree was searched to the end.
+    double get_gap() const;
 
 public:
+    // For a linear problem with integer columns the last argument caps the branch and
+    // bound nodes, and every new incumbent reaches the progress function as it is found.
     const real_block& solve(optimization::method = optimization::method::LN_COBYLA, double = 1e-5, size_t = 1000);
     const real_block& search(size_t = 100, size_t = 30, double = 0.382, optimization::method = optimization::method::LN_COBYLA, double = 1e-5, size_t = 1000);
+    // Solves again from the last solution, for data that drifted since. LD_SLSQP starts
+    // from the quasi-Newton matrix and penalty weights the last solve() or resolve()
+    // ended with, LD_LBFGS from its limited-memory history, LD_MMA from its asymptotes,
+    // penalties and dual variables, and the derivative-free methods from a small initial
+    // step; falls back to solve() when the warm run fails.
+    const real_block& resolve(optimization::method = optimization::method::LN_COBYLA, double = 1e-5, size_t = 1000);
     double obj(const real_block&) const;
 
 private:
-    const real_block& nlopt_solve(optimization::method = optimization::method::LN_COBYLA, double = 1e-5, size_t = 1000);
+    bool local_solve(real_block&, double&, optimization::method, double, size_t) const;
+    bool nlopt_solve(real_block&, double&, optimization::method, double, size_t) const;
+    bool nlopt_solve(real_block&, double&, const std::vector<range_t>&, const filter_function_t&, optimization::method, double, size_t) const;
+    bool simplex_solve(real_block&, double&, double, size_t);
+    bool milp_solve(real_block&, double&, double, size_t);
+    bool minlp_solve(real_block&, double&, optimization::method, double, size_t);
 
 private:
     static double instance_fun(unsigned n, const double* x, double* grad, void* my_func_data);
     static double instance_eq_fun(unsigned n, const double* x, double* grad, void* my_func_data);
     static double instance_ineq_fun(unsigned n, const double* x, double* grad, void* my_func_data);
+    static void instance_linear_fun(unsigned m, double* result, unsigned n, const double* x, double* grad, void* my_func_data);
+    static double instance_fused_fun(unsigned n, const double* x, double* grad, void* my_func_data);
+    static void instance_fused_condition_fun(unsigned m, double* result, unsigned n, const double* x, double* grad, void* my_func_data);
+    static const fused_point_t& evaluate(fused_point_t&, const double*, size_t, bool);
+    static void instance_prefetch(unsigned n, unsigned k, const double* const* x, void* my_func_data);
+    static map_function_t make_map_function(const function_t&, const gradient_function_t*, size_t);
+    static double evaluate(const map_function_t&, const real_block&);
+    static map_function_t make_linear_function(const real_block&);
 
 public:
     static optimization::method default_local_method;
@@ -130,6 +370,10 @@ public:
     static double default_bound_step;
     static size_t default_population;
     static size_t max_reloop_iter;
+    static size_t default_thread_number;
+    static size_t max_branch_node;
+    static size_t max_idle_context;
+    static double warm_start_step;
 
 public:
     static real_block fminunc(const optimization::function_t&, const real_block&, bool&, double = 1e-5, size_t = 1000);
@@ -140,42 +384,464 @@ public:
     static void print(bool ok, const real_block& ret, const optimization::function_t& obj);
     static void print(bool ok, const real_block& ret, const real_block& obj);
 
+    // Bounded revised simplex for min c'x s.t. A x <= b, A x = b, lb <= x <= ub.
+    // Every row gets a slack column, so the slack basis is always a valid start.
+    // Cold starts crash boxed columns onto the bound their cost favours. A dual
+    // feasible start, such as that one or a basis from set_basis() after bounds were
+    // tightened, runs the dual simplex with dual steepest-edge pricing and a
+    // bound-flipping ratio test. Any other start runs a composite phase 1 (minimising
+    // the sum of infeasibilities) and then phase 2 of the primal simplex with devex
+    // partial pricing. The basis is kept as a sparse Markowitz LU factorisation, with
+    // a dense kernel for the core once it fills in, and Forrest-Tomlin updates; it is
+    // refactored every refactor_interval pivots. solve(0) stops only at
+    // 100 (m + n) + 10000 pivots, as a guard against cycling. The stop function is
+    // polled every stop_interval pivots; once it returns true solve() ends with STOPPED
+    // and the point it had reached, which is feasible only if phase 1 was done.
+    class simplex {
+    public:
+        enum status_t {
+            OPTIMAL = 0,
+            INFEASIBLE,
+            UNBOUNDED,
+            ITERATION_LIMIT,
+            STOPPED
+        };
+        typedef std::function<bool()> stop_function_t;
+        enum state_t {
+            BASIC = 0,
+            AT_LOWER,
+            AT_UPPER,
+            AT_ZERO
+        };
+        typedef std::vector<int> basis_t;
+        typedef Eigen::SparseMatrix<double> sparse_block;
+
+    private:
+        // B = L R^-1 U up to row and column permutations: L as the column etas of the
+        // elimination, R as the row etas of the Forrest-Tomlin updates since, and U
+        // both by row (urow) and by basis position (ucol). order lists the rows in
+        // pivot order, pcol the basis position each row pivots on and prow the reverse.
+        class factor_t {
+        public:
+            factor_t();
+            virtual ~factor_t() = default;
+            size_t m, updates;
+            std::vector<int> l_pivot, l_start, l_index, r_pivot, r_start, r_index;
+            std::vector<double> l_value, r_value, diag;
+            std::vector<std::vector<std::pair<int, double>>> urow, ucol;
+            std::vector<int> order, pcol, prow;
+            mutable std::vector<double> work, spike;
+            bool build(const sparse_block&, const std::vector<size_t>&, std::vector<std::pair<size_t, size_t>>&);
+            void eliminate_dense(const std::vector<std::vector<std::pair<int, double>>>&);
+            void ftran(Eigen::VectorXd&, bool) const;
+            void btran(Eigen::VectorXd&) const;
+            bool update(size_t, double);
+        };
+        size_t rows, cols;
+        real_block c;
+        std::vector<Eigen::Triplet<double>> entries;
+        std::vector<double> rhs;
+        std::vector<char> equality;
+        std::vector<range_t> bound;
+        sparse_block A;
+        Eigen::SparseMatrix<double, Eigen::RowMajor> AR;
+        Eigen::VectorXd x, cost, weight;
+        basis_t state;
+        std::vector<size_t> basis;
+        factor_t lu;
+        Eigen::VectorXd reduced;
+        real_block sol;
+        double fval;
+        size_t iter;
+        status_t status;
+        bool dirty;
+        stop_function_t stop;
+        void build();
+        void cold_start();
+        bool factor();
+        bool refactor();
+        void ftran(Eigen::VectorXd&, bool = false) const;
+        void btran(Eigen::VectorXd&) const;
+        void row_product(const Eigen::VectorXd&, Eigen::VectorXd&, std::vector<size_t>* = nullptr) const;
+        void compute_primal();
+        void compute_reduced();
+        double infeasibility() const;
+        bool make_dual_feasible();
+        status_t primal(bool, size_t);
+        status_t dual(size_t);
+        bool stopped() const;
+
+    public:
+        static size_t refactor_interval;
+        static size_t stop_interval;
+
+    public:
+        simplex() = delete;
+        simplex(const real_block&, const std::vector<range_t>&);
+        virtual ~simplex() = default;
+        simplex& add_equation(const real_block&, const real_block&);
+        simplex& add_inequation(const real_block&, const real_block&);
+        simplex& add_equation(const sparse_block&, const real_block&);
+        simplex& add_inequation(const sparse_block&, const real_block&);
+        simplex& set_bound(size_t, const range_t&);
+        simplex& set_basis(const basis_t&);
+        simplex& set_stop_function(const stop_function_t&);
+        status_t solve(size_t = 0);
+        const real_block& solution() const;
+        double obj() const;
+        size_t iterations() const;
+        const basis_t& get_basis() const;
+        const range_t& get_bound(size_t) const;
+        double reduced_cost(size_t) const;
+        size_t gomory(const std::vector<char>&, size_t, real_block&, real_block&) const;
+    };
+
+    // LP-relaxation branch and bound for mixed-integer linear programs. The root LP is
+    // tightened with a few rounds of Gomory mixed-integer and knapsack cover cuts; nodes
+    // are then taken best-bound first and each branch dives depth-first into the child
+    // on the rounding side. Child LPs warm start from the parent basis through the dual
+    // simplex, and nonbasic integer columns are fixed by reduced cost once an incumbent
+    // exists. The progress function receives (nodes, incumbent, bound) on every new
+    // incumbent and every progress_interval nodes. set_node_limit() caps one instance
+    // below the shared max_nodes; 0 keeps max_nodes. The stop function is polled before
+    // every node and handed to the node LPs; once it returns true solve() ends with
+    // STOPPED, keeping the incumbent and the bound reached so far.
+    class milp {
+    public:
+        typedef std::function<void(size_t, double, double)> progress_function_t;
+
+    private:
+        class node_t {
+        public:
+            double bound;
+            std::vector<std::pair<size_t, range_t>> change;
+            std::shared_ptr<const simplex::basis_t> basis;
+        };
+        real_block c;
+        std::vector<range_t> root;
+        std::vector<char> integer;
+        std::vector<std::pair<real_block, real_block>> ineq;
+        simplex lp;
+        progress_function_t progress;
+        size_t node_limit;
+        simplex::stop_function_t stop;
+        real_block sol;
+        double fval, lower_bound;
+        size_t node_count;
+        simplex::status_t status;
+        bool integral(const real_block&, size_t&) const;
+        size_t cover(const real_block&, real_block&, real_block&) const;
+        bool branch(node_t&, node_t&, node_t&);
+
+    public:
+        static size_t max_nodes;
+        static size_t progress_interval;
+        static size_t cut_rounds;
+        static double relative_gap;
+
+    public:
+        milp() = delete;
+        milp(const real_block&, const std::vector<range_t>&, const std::vector<size_t>&);
+        virtual ~milp() = default;
+        milp& add_equation(const real_block&, const real_block&);
+        milp& add_inequation(const real_block&, const real_block&);
+        milp& set_progress_function(const progress_function_t&);
+        milp& set_node_limit(size_t);
+        milp& set_stop_function(const simplex::stop_function_t&);
+        simplex::status_t solve();
+        const real_block& solution() const;
+        double obj() const;
+        double bound() const;
+        double gap() const;
+        size_t nodes() const;
+    };
+
+    // Linear assignment: matches every row to a distinct column (or every column to a
+    // distinct row when there are fewer columns) at minimum total cost. Dense input runs
+    // the Jonker-Volgenant shortest augmenting path form of the Hungarian method, exact
+    // in O(n^2 m); entries at or above inf mark forbidden pairs and are left out of the
+    // result. Sparse input, where only stored entries are allowed pairs, runs a Jacobi
+    // epsilon-scaling auction whose bidding rounds are spread over `threads` threads.
+    // Its total is within min(rows, cols) * tolerance of the optimum; tolerance 0 picks
+    // a step that is exact for integer costs. An infeasible sparse pattern gives an
+    // empty matching and an infinite obj().
     class assignment {
+    public:
+        typedef Eigen::SparseMatrix<double> sparse_block;
+
     private:
-        const real_block& bk;
-        real_block data;
-        double max_value, sum;
+        double sum;
         std::vector<std::pair<size_t, size_t>> path;
-        void find(size_t i);
+        void hungarian(const real_block&, double);
+        void auction(const sparse_block&, double, size_t);
+
+    public:
+        static size_t auction_grain;
 
     public:
         assignment() = delete;
         assignment(const real_block& c, double inf = 1e10);
+        assignment(const sparse_block& c, double tolerance = 0, size_t threads = optimization::default_thread_number);
         virtual ~assignment() = default;
         const std::vector<std::pair<size_t, size_t>>& solve() const;
         double obj() const;
     };
 
+    // Travelling salesman tour through every city of a distance matrix, starting and
+    // ending at `start`. Each of `starts` nearest-neighbour tours (grown from different
+    // first cities and run on `threads` threads) is improved by local search over
+    // candidate lists of the `neighbors` nearest cities, driven by don't-look bits:
+    // Lin-Kernighan chains of up to max_depth 2-opt flips, and Or-opt moves of segments
+    // of up to three cities. An asymmetric matrix gets Or-opt moves only, since a flip
+    // changes the cost of every reversed edge. Pairs at or above inf never become
+    // candidates. The best tour found is kept.
+    //
+    // Points with a sparse candidate graph (see neighbor_index) avoid the n x n matrix:
+    // column i lists the candidates of city i, other pairs are priced by f on demand,
+    // and the first tours follow candidate edges, jumping along a Hilbert curve over
+    // the coordinates when every candidate is already visited.
+    //
+    // Given a cluster size instead, the points are cut into runs of that many cities
+    // along the Hilbert curve, which keeps each run compact and next to the following
+    // one. The runs are routed on `threads` threads through their own candidate graphs,
+    // and the cycles are joined in curve order, each broken at the edge that is
+    // cheapest to leave for the previous run. Local search over a global candidate
+    // graph then repairs the tour, starting only from the cities around the joins.
+    // Both candidate graphs come from a neighbor_index built with `geographic`: keep
+    // it for (latitude, longitude) points and pass false for planar (x, y) ones.
+    // decomposition() reports the time of both stages and the length right after the
+    // join, so the repair gain is decomposition().joined - obj().
     class tsp {
+    public:
+        // Symmetric n x n matrix stored as its packed upper triangle, diagonal included,
+        // in half the memory of a dense block (a quarter with T = float).
+        template <typename T>
+        class packed_block {
+        private:
+            size_t n;
+            std::vector<T> data;
+            size_t index(size_t i, size_t j) const
+            {
+                if (i > j) {
+                    std::swap(i, j);
+                }
+                return i * this->n - i * (i - 1) / 2 + j - i;
+            }
+
+        public:
+            packed_block(size_t n = 0)
+                : n(n)
+                , data(n * (n + 1) / 2)
+            {
+            }
+            virtual ~packed_block() = default;
+            size_t rows() const { return this->n; }
+            size_t cols() const { return this->n; }
+            T operator()(size_t i, size_t j) const { return this->data[this->index(i, j)]; }
+            T& operator()(size_t i, size_t j) { return this->data[this->index(i, j)]; }
+        };
+
+        class decomposition_t {
+        public:
+            size_t clusters;
+            double route_seconds, stitch_seconds, joined;
+        };
+
     private:
         size_t start;
-        const real_block& bk;
-        real_block data;
-        double max_value, sum;
+        double sum;
         std::vector<size_t> path;
-        void find(size_t i);
+        decomposition_t report;
+        template <typename M, typename I>
+        void run(const M&, const std::vector<std::vector<size_t>>&, const I&, size_t, size_t, bool);
+
+    public:
+        static size_t neighbors;
+        static size_t max_depth;
 
     public:
         typedef std::pair<double, double> point2d_t;
         typedef std::function<double(const point2d_t&, const point2d_t)> point2d_distance_function_t;
+        typedef std::function<void(size_t, size_t, const real_block&)> tile_function_t;
         tsp() = delete;
-        tsp(const real_block&, size_t = 0, double inf = 1e10);
+        tsp(const real_block&, size_t = 0, double inf = 1e10, size_t starts = 1, size_t threads = optimization::default_thread_number);
+        template <typename T>
+        tsp(const packed_block<T>&, size_t = 0, double inf = 1e10, size_t starts = 1, size_t threads = optimization::default_thread_number);
+        tsp(const assignment::sparse_block& candidates, const std::vector<point2d_t>&, const point2d_distance_function_t&, size_t = 0, size_t starts = 1, size_t threads = optimization::default_thread_number);
+        tsp(const std::vector<point2d_t>&, const point2d_distance_function_t&, size_t cluster_size, size_t = 0, size_t threads = optimization::default_thread_number, bool geographic = true);
         virtual ~tsp() = default;
         const std::vector<size_t>& solve() const;
         double obj() const;
+        const decomposition_t& decomposition() const;
+
+    public:
+        // The builders below call f once per unordered pair (i < j) and mirror the value,
+        // so f must be symmetric; the diagonal is set to inf. Rows are handed out to
+        // `threads` threads dynamically, since the rows of a triangle differ in length.
+        static real_block distance(const std::vector<point2d_t>&, const point2d_distance_function_t&, double inf = 1e10, size_t threads = optimization::default_thread_number);
+        template <typename T>
+        static packed_block<T> packed_distance(const std::vector<point2d_t>&, const point2d_distance_function_t&, double inf = 1e10, size_t threads = optimization::default_thread_number);
+        // Streams the upper triangle as tile x tile blocks: out(row, col, block) receives
+        // the distances from points [row, row + block.rows()) to [col, col + block.cols())
+        // for every row <= col, in row-major tile order on the calling thread. Only one
+        // wave of `threads` tiles is held at a time, so memory stays at threads * tile^2.
+        // A tile of 0 is taken as 1.
+        static void distance_tiles(const std::vector<point2d_t>&, const point2d_distance_function_t&, const tile_function_t& out, size_t tile = 1024, double inf = 1e10, size_t threads = optimization::default_thread_number);
+    };
+
+    // Capacitated vehicle routing, optionally with time windows, on an n x n distance
+    // matrix such as tsp::distance builds, with the depot at row `depot`. At most
+    // `vehicles` routes leave the depot and return to it, each carrying at most
+    // `capacity` of demand. Clarke-Wright savings over the `neighbors` nearest pairs
+    // gives the first solution. Adaptive large neighbourhood search then removes stops
+    // (random, worst, related or whole-route removal) and puts them back (greedy or
+    // regret-2 insertion) under simulated annealing. Operator weights adapt every
+    // `segment` iterations. An insertion is tried next to the stop's nearest stops,
+    // and its cost and its load and time window feasibility take O(1) from the route
+    // loads and each stop's earliest and latest service start. solve() runs one search
+    // per thread on its own random stream until `seconds` or max_iterations run out;
+    // at the end of a segment a worker behind the shared best restarts from it. Stops
+    // that fit nowhere are left unserved at a penalty above any detour.
+    class vrp {
+    private:
+        real_block c, travel, demand, service;
+        std::vector<range_t> window;
+        double capacity;
+        size_t vehicles, depot;
+        double sum;
+        std::vector<std::vector<size_t>> path;
+        std::vector<size_t> missed;
+
+    public:
+        static size_t neighbors;
+        static size_t segment;
+        static size_t max_iterations;
+
+    public:
+        vrp() = delete;
+        vrp(const real_block& c, const real_block& demand, double capacity, size_t vehicles, size_t depot = 0);
+        virtual ~vrp() = default;
+        // travel(i, j) is the driving time, service(i) the time spent at stop i and
+        // window[i] the interval in which service at i has to start, waiting allowed.
+        // window[depot] bounds the departure and the return of every vehicle.
+        vrp& set_time_windows(const real_block& travel, const std::vector<range_t>& window, const real_block& service);
+        // True when every stop is served.
+        bool solve(double seconds = 10, size_t threads = optimization::default_thread_number);
+        // Each used vehicle's stops from the depot back to the depot.
+        const std::vector<std::vector<size_t>>& routes() const;
+        const std::vector<size_t>& unserved() const;
+        double obj() const;
+    };
+
+    // k-d tree over points, built in O(n log n). With `geographic` the points are
+    // (latitude, longitude) in degrees and are placed on the unit sphere, so neighbours
+    // come in order of great circle distance; otherwise they are planar (x, y).
+    // candidates() answers one k nearest query per point on `threads` threads and
+    // returns a sparse graph whose column q holds the k nearest indexed points j of
+    // query q, priced at f(query[q], point[j]). Without a query set the indexed points
+    // query themselves and leave themselves out. The graph feeds the sparse tsp and
+    // assignment constructors directly; too small a k may leave an assignment without
+    // a perfect matching.
+    class neighbor_index {
+    private:
+        std::vector<tsp::point2d_t> point;
+        std::vector<double> coordinate;
+        std::vector<size_t> order;
+        std::vector<unsigned char> axis;
+        bool geographic;
+        void locate(const tsp::point2d_t&, double*) const;
+        void build(size_t, size_t);
+        void search(const double*, size_t, size_t, size_t, size_t, std::vector<std::pair<double, size_t>>&) const;
+
+    public:
+        static size_t leaf_size;
+
+    public:
+        neighbor_index() = delete;
+        neighbor_index(const std::vector<tsp::point2d_t>&, bool geographic = true);
+        virtual ~neighbor_index() = default;
+        size_t size() const;
+        // The indices of the k nearest points to p, nearest first, leaving out `skip`.
+        std::vector<size_t> nearest(const tsp::point2d_t& p, size_t k, size_t skip = static_cast<size_t>(-1)) const;
+        assignment::sparse_block candidates(size_t k, const tsp::point2d_distance_function_t&, size_t threads = optimization::default_thread_number) const;
+        assignment::sparse_block candidates(const std::vector<tsp::point2d_t>& query, size_t k, const tsp::point2d_distance_function_t&, size_t threads = optimization::default_thread_number) const;
+    };
+
+    // Inverts control over the objective: solve() or search() of a copy of the problem
+    // runs on a background thread whose objective only posts the point as a request and
+    // waits for its value, so the caller takes requests with ask(), evaluates them
+    // wherever it likes and hands the values back with tell() without ever waiting on
+    // the solver. search() keeps up to `in_flight` local solves going, each with one
+    // request open; ESCH and ISRES post a whole generation at once through the batch
+    // hook. Conditions, gradients and filters of the problem still run in place and a
+    // fused function is dropped together with its conditions. Destroying a running
+    // ask_tell answers every open and later request with HUGE_VAL until the solver ends.
+    class ask_tell {
+    public:
+        class request_t {
+        public:
+            size_t id;
+            real_block x;
+        };
+
+    private:
+        std::shared_ptr<optimization> problem;
+        std::shared_ptr<ask_tell_state> state;
+        bool start(const std::function<void(optimization&)>&);
+
+    public:
+        ask_tell() = delete;
+        ask_tell(const optimization&, size_t in_flight = 1);
+        // A copy would share the running solve and cancel it when destroyed.
+        ask_tell(const ask_tell&) = delete;
+        ask_tell& operator=(const ask_tell&) = delete;
+        virtual ~ask_tell();
+        // Both return false when a solver is already running.
+        bool start_solve(optimization::method = optimization::method::LN_COBYLA, double = 1e-5, size_t = 1000);
+        bool start_search(size_t = 100, size_t = 30, double = 0.382, optimization::method = optimization::method::LN_COBYLA, double = 1e-5, size_t = 1000);
+        // Requests posted since the last call, waiting up to `seconds` for one to come.
+        std::vector<request_t> ask(double seconds = 0);
+        void tell(size_t id, double value);
+        size_t in_flight() const;
+        bool done() const;
+        // Valid once done() holds.
+        const real_block& solution() const;
+        bool is_ok() const;
+    };
+
+    // Evaluates an objective in forked worker processes, for code that must not run
+    // on two threads of one process. Each worker owns one end of a Unix domain socket
+    // pair and answers the points written to it; evaluate() borrows an idle worker and
+    // blocks only its calling thread, so search() on size() threads and the batch hook
+    // of ESCH and ISRES keep every worker busy. A worker that dies, or that takes more
+    // than `timeout` seconds when it is positive, is killed and forked again, at most
+    // max_restarts times per pool, and the point it held gets HUGE_VAL. With no worker
+    // left every point gets HUGE_VAL. The constructor forks a single-threaded helper
+    // that forks every worker, the first ones and the replacements, from the process
+    // as it was then, so construct the pool before starting threads of your own. When
+    // the last copy of the pool goes away the workers get exit_timeout seconds to
+    // leave (the value the pool was constructed with) before they are killed.
+    class process_pool {
+    private:
+        std::shared_ptr<process_pool_state> state;
+
+    public:
+        static size_t max_restarts;
+        static double timeout;
+        static double exit_timeout;
 
     public:
-        static real_block distance(const std::vector<point2d_t>&, const point2d_distance_function_t&, double inf = 1e10);
+        process_pool() = delete;
+        process_pool(const function_t&, size_t workers = optimization::default_thread_number);
+        virtual ~process_pool() = default;
+        // Workers alive.
+        size_t size() const;
+        size_t restarts() const;
+        double evaluate(const real_block&) const;
+        // One value per column, the columns spread over the workers.
+        real_block evaluate_batch(const real_block&) const;
+        function_t function() const;
+        batch_function_t batch_function() const;
     };
 };
 }
@@ -1,24 +1,38 @@
 #ifndef ANYPROG_RANDOM_HPP
 #define ANYPROG_RANDOM_HPP
 
+#include "block.hpp"
 #include <chrono>
+#include <cstdint>
 #include <random>
+#include <utility>
+#include <vector>
 
 namespace anyprog {
 
+// Counter-based uniform generator (Philox4x32-10). The seed is the key and every
+// stream id selects an independent sequence, so generators built from the same
+// seed with different stream ids (or handed out by substream()) never overlap.
 class random {
 private:
-    std::default_random_engine engine;
-    std::uniform_real_distribution<> distribution;
+    uint64_t key, stream, counter;
+    double lower, upper, buffer;
+    bool buffered;
 
 public:
     random();
     random(double l, double u);
+    random(double l, double u, unsigned long seed);
+    random(double l, double u, unsigned long seed, unsigned long stream);
     virtual ~random() = default;
 
 public:
     double generate();
+    random substream(unsigned long id) const;
+    void fill(real_block&);
+    void fill(real_block&, double l, double u);
+    void fill(real_block&, const std::vector<std::pair<double, double>>& range);
 };
 }
 
-#endif
\ No newline at end of file
+#endif
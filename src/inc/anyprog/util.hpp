@@ -1,9 +1,27 @@
 #ifndef ANYPROG_UTIL_HPP
 #define ANYPROG_UTIL_HPP
 
+#include <cstddef>
+
 namespace anyprog {
 
+// VINCENTY is the iterative ellipsoidal solution of the scalar gps_distance.
+// ANDOYER applies Lambert's first order flattening correction to the spherical
+// central angle: within 15 m of VINCENTY up to 10000 km and 60 m up to 15000 km,
+// degrading to a few km for nearly antipodal points. HAVERSINE uses a sphere of
+// radius 6371008.8 m and is off by up to 0.6%.
+enum gps_distance_method_t {
+    VINCENTY = 0,
+    ANDOYER,
+    HAVERSINE
+};
+
 double gps_distance(double lat1, double lon1, double lat2, double lon2, double u = 1e3);
+
+// out[i] = gps_distance(lat1[i], lon1[i], lat2[i], lon2[i], u) for i in [0, n) with
+// VINCENTY; ANDOYER and HAVERSINE trade accuracy for speed.
+void gps_distance(const double* lat1, const double* lon1, const double* lat2, const double* lon2,
+    double* out, size_t n, double u = 1e3, gps_distance_method_t method = VINCENTY);
 }
 
 #endif
\ No newline at end of file
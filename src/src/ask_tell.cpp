@@ -0,0 +1,184 @@
+#include "optimization.hpp"
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace anyprog {
+
+// Requests by id. The solver side posts points and sleeps on `answered`; the caller
+// side drains `fresh` and is woken through `posted` when a request or the end comes.
+class ask_tell_state {
+public:
+    class record_t {
+    public:
+        real_block x;
+        double value;
+        bool ready;
+    };
+    std::mutex lock;
+    std::condition_variable posted, answered;
+    std::unordered_map<size_t, record_t> record;
+    std::deque<size_t> fresh;
+    size_t next;
+    bool running, finished, cancelled;
+    std::thread worker;
+
+    ask_tell_state()
+        : next(0)
+        , running(false)
+        , finished(false)
+        , cancelled(false)
+    {
+    }
+
+    // Posts the columns of x as requests and waits for all their values.
+    real_block evaluate(const real_block& x)
+    {
+        size_t k = x.cols();
+        real_block ret(k, 1);
+        std::unique_lock<std::mutex> guard(this->lock);
+        size_t first = this->next;
+        for (size_t j = 0; j < k; ++j) {
+            record_t& r = this->record[this->next];
+            r.x = x.col(j);
+            r.ready = false;
+            this->fresh.push_back(this->next++);
+        }
+        this->posted.notify_all();
+        // Other threads insert while this one waits and may rehash the map, which moves
+        // no element but invalidates iterators, so hold a reference and erase by key.
+        for (size_t j = 0; j < k; ++j) {
+            record_t& r = this->record[first + j];
+            this->answered.wait(guard, [&]() { return r.ready || this->cancelled; });
+            ret(j) = r.ready ? r.value : HUGE_VAL;
+            this->record.erase(first + j);
+        }
+        return ret;
+    }
+};
+
+optimization::ask_tell::ask_tell(const optimization& opt, size_t in_flight)
+    : problem(std::make_shared<optimization>(opt))
+    , state(std::make_shared<ask_tell_state>())
+{
+    ask_tell_state* s = this->state.get();
+    optimization& p = *this->problem;
+    p.map_cb = optimization::map_function_t();
+    p.fused_cb = optimization::fused_function_t();
+    p.fused_eq = p.fused_ineq = 0;
+    p.cb = [s](const real_block& x) {
+        return s->evaluate(x)(0);
+    };
+    p.batch_cb = [s](const real_block& x) {
+        return s->evaluate(x);
+    };
+    p.set_thread_number(in_flight);
+}
+
+optimization::ask_tell::~ask_tell()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->state->lock);
+        this->state->cancelled = true;
+        this->state->answered.notify_all();
+    }
+    if (this->state->worker.joinable()) {
+        this->state->worker.join();
+    }
+}
+
+bool optimization::ask_tell::start(const std::function<void(optimization&)>& run)
+{
+    ask_tell_state* s = this->state.get();
+    std::lock_guard<std::mutex> guard(s->lock);
+    if (s->running) {
+        return false;
+    }
+    if (s->worker.joinable()) {
+        s->worker.join();
+    }
+    s->running = true;
+    s->finished = false;
+    std::shared_ptr<optimization> p = this->problem;
+    s->worker = std::thread([s, p, run]() {
+        run(*p);
+        std::lock_guard<std::mutex> guard(s->lock);
+        s->running = false;
+        s->finished = true;
+        s->posted.notify_all();
+    });
+    return true;
+}
+
+bool optimization::ask_tell::start_solve(optimization::method m, double eps, size_t max_iter)
+{
+    return this->start([=](optimization& p) {
+        p.solve(m, eps, max_iter);
+    });
+}
+
+bool optimization::ask_tell::start_search(size_t max_random_iter, size_t max_not_changed, double s, optimization::method m, double eps, size_t max_iter)
+{
+    return this->start([=](optimization& p) {
+        p.search(max_random_iter, max_not_changed, s, m, eps, max_iter);
+    });
+}
+
+std::vector<optimization::ask_tell::request_t> optimization::ask_tell::ask(double seconds)
+{
+    ask_tell_state* s = this->state.get();
+    std::unique_lock<std::mutex> guard(s->lock);
+    if (seconds > 0) {
+        s->posted.wait_for(guard, std::chrono::duration<double>(seconds), [s]() { return !s->fresh.empty() || !s->running; });
+    }
+    std::vector<request_t> ret;
+    ret.reserve(s->fresh.size());
+    for (const auto& i : s->fresh) {
+        ret.push_back({ i, s->record[i].x });
+    }
+    s->fresh.clear();
+    return ret;
+}
+
+void optimization::ask_tell::tell(size_t id, double value)
+{
+    ask_tell_state* s = this->state.get();
+    std::lock_guard<std::mutex> guard(s->lock);
+    auto i = s->record.find(id);
+    if (i != s->record.end() && !i->second.ready) {
+        i->second.value = value;
+        i->second.ready = true;
+        s->answered.notify_all();
+    }
+}
+
+size_t optimization::ask_tell::in_flight() const
+{
+    std::lock_guard<std::mutex> guard(this->state->lock);
+    size_t n = 0;
+    for (const auto& i : this->state->record) {
+        n += i.second.ready ? 0 : 1;
+    }
+    return n;
+}
+
+bool optimization::ask_tell::done() const
+{
+    std::lock_guard<std::mutex> guard(this->state->lock);
+    return this->state->finished && !this->state->running;
+}
+
+const real_block& optimization::ask_tell::solution() const
+{
+    return this->problem->point;
+}
+
+bool optimization::ask_tell::is_ok() const
+{
+    return this->problem->ok;
+}
+}
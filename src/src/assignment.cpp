@@ -0,0 +1,368 @@
+#include "optimization.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace anyprog {
+
+static const double assignment_inf = std::numeric_limits<double>::infinity();
+static const size_t assignment_npos = static_cast<size_t>(-1);
+
+size_t optimization::assignment::auction_grain = 4096;
+
+// Shortest augmenting path Hungarian method on an n x m matrix with n <= m. Each row
+// grows a Dijkstra tree over the columns on the reduced costs a(i, j) - u(i) - v(j)
+// until it reaches a free column and then flips the path, so the duals stay feasible
+// and the matching stays optimal for the rows added so far. match[i] is row i's column.
+template <typename M>
+static void shortest_augmenting_path(const M& a, std::vector<size_t>& match)
+{
+    size_t n = a.rows(), m = a.cols();
+    std::vector<double> u(n + 1, 0), v(m + 1, 0), minv(m + 1);
+    std::vector<size_t> p(m + 1, 0), way(m + 1, 0);
+    std::vector<char> used(m + 1);
+    for (size_t i = 1; i <= n; ++i) {
+        p[0] = i;
+        size_t j0 = 0;
+        std::fill(minv.begin(), minv.end(), assignment_inf);
+        std::fill(used.begin(), used.end(), 0);
+        do {
+            used[j0] = 1;
+            size_t i0 = p[j0], j1 = 0;
+            double delta = assignment_inf;
+            for (size_t j = 1; j <= m; ++j) {
+                if (!used[j]) {
+                    double cur = a(i0 - 1, j - 1) - u[i0] - v[j];
+                    if (cur < minv[j]) {
+                        minv[j] = cur;
+                        way[j] = j0;
+                    }
+                    if (j1 == 0 || minv[j] < delta) {
+                        delta = minv[j];
+                        j1 = j;
+                    }
+                }
+            }
+            for (size_t j = 0; j <= m; ++j) {
+                if (used[j]) {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                } else {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+        do {
+            size_t j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+    match.assign(n, 0);
+    for (size_t j = 1; j <= m; ++j) {
+        if (p[j] != 0) {
+            match[p[j] - 1] = j - 1;
+        }
+    }
+}
+
+// Hopcroft-Karp on the pattern of `arcs` (column i lists the objects of person i):
+// true when every person can be matched to a distinct object.
+static bool perfect_matching(const optimization::assignment::sparse_block& arcs)
+{
+    typedef optimization::assignment::sparse_block::InnerIterator iterator_t;
+    size_t n = arcs.cols(), m = arcs.rows(), matched = 0;
+    std::vector<size_t> mate(n, assignment_npos), owner(m, assignment_npos), dist(n), queue(n), stack, next(n);
+    while (true) {
+        size_t head = 0, tail = 0, limit = assignment_npos;
+        for (size_t i = 0; i < n; ++i) {
+            if (mate[i] == assignment_npos) {
+                dist[i] = 0;
+                queue[tail++] = i;
+            } else {
+                dist[i] = assignment_npos;
+            }
+        }
+        while (head < tail) {
+            size_t i = queue[head++];
+            if (dist[i] >= limit) {
+                continue;
+            }
+            for (iterator_t it(arcs, i); it; ++it) {
+                size_t k = owner[it.row()];
+                if (k == assignment_npos) {
+                    limit = std::min(limit, dist[i] + 1);
+                } else if (dist[k] == assignment_npos) {
+                    dist[k] = dist[i] + 1;
+                    queue[tail++] = k;
+                }
+            }
+        }
+        if (limit == assignment_npos) {
+            break;
+        }
+        std::vector<iterator_t> cursor;
+        for (size_t i = 0; i < n; ++i) {
+            cursor.emplace_back(arcs, i);
+        }
+        for (size_t root = 0; root < n; ++root) {
+            if (mate[root] != assignment_npos || dist[root] != 0) {
+                continue;
+            }
+            stack.assign(1, root);
+            while (!stack.empty()) {
+                size_t i = stack.back();
+                iterator_t& it = cursor[i];
+                bool advanced = false;
+                for (; it; ++it) {
+                    size_t j = it.row(), k = owner[j];
+                    if (k == assignment_npos ? dist[i] + 1 == limit : dist[k] == dist[i] + 1) {
+                        next[i] = j;
+                        if (k == assignment_npos) {
+                            for (const auto& s : stack) {
+                                size_t t = next[s];
+                                mate[s] = t;
+                                owner[t] = s;
+                            }
+                            ++matched;
+                            for (const auto& s : stack) {
+                                dist[s] = assignment_npos;
+                            }
+                            stack.clear();
+                        } else {
+                            stack.push_back(k);
+                        }
+                        ++it;
+                        advanced = true;
+                        break;
+                    }
+                }
+                if (!advanced && !stack.empty()) {
+                    dist[i] = assignment_npos;
+                    stack.pop_back();
+                }
+            }
+        }
+    }
+    return matched == n;
+}
+
+optimization::assignment::assignment(const real_block& c, double inf)
+    : sum(0)
+    , path()
+{
+    this->hungarian(c, inf);
+}
+
+optimization::assignment::assignment(const sparse_block& c, double tolerance, size_t threads)
+    : sum(0)
+    , path()
+{
+    this->auction(c, tolerance, threads);
+}
+
+void optimization::assignment::hungarian(const real_block& c, double inf)
+{
+    std::vector<size_t> match;
+    if (c.rows() < c.cols()) {
+        shortest_augmenting_path(c, match);
+        for (size_t i = 0; i < match.size(); ++i) {
+            this->path.push_back({ i, match[i] });
+        }
+    } else {
+        shortest_augmenting_path(c.transpose(), match);
+        std::vector<size_t> row(c.rows(), assignment_npos);
+        for (size_t j = 0; j < match.size(); ++j) {
+            row[match[j]] = j;
+        }
+        for (size_t i = 0; i < row.size(); ++i) {
+            if (row[i] != assignment_npos) {
+                this->path.push_back({ i, row[i] });
+            }
+        }
+    }
+    std::vector<std::pair<size_t, size_t>> allowed;
+    for (const auto& i : this->path) {
+        double v = c(i.first, i.second);
+        if (v < inf) {
+            this->sum += v;
+            allowed.push_back(i);
+        }
+    }
+    this->path.swap(allowed);
+}
+
+// Forward auction on benefits a = -cost with persons on the shorter side. Every round
+// the unassigned persons bid (in parallel once there are auction_grain of them) for
+// their best object, raising its price by the gap to their second best plus eps; each
+// object then goes to its highest bidder in person order, so the outcome does not
+// depend on the thread count. Prices carry over while eps shrinks by a factor of five.
+// With more objects than persons, a final reverse pass lowers the prices of objects
+// left unassigned to lambda, the lowest assigned price, which the asymmetric problem's
+// optimality conditions require.
+void optimization::assignment::auction(const sparse_block& c, double tolerance, size_t threads)
+{
+    bool transposed = c.rows() > c.cols();
+    sparse_block persons, objects;
+    if (transposed) {
+        persons = c;
+        objects = c.transpose();
+    } else {
+        persons = c.transpose();
+        objects = c;
+    }
+    persons.makeCompressed();
+    objects.makeCompressed();
+    size_t n = persons.cols(), m = persons.rows();
+    if (n == 0 || !perfect_matching(persons)) {
+        this->sum = n == 0 ? 0 : assignment_inf;
+        return;
+    }
+
+    double lo = assignment_inf, hi = -assignment_inf;
+    bool integral = true;
+    for (size_t k = 0; k < static_cast<size_t>(persons.nonZeros()); ++k) {
+        double v = persons.valuePtr()[k];
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+        integral = integral && v == std::round(v);
+    }
+    double range = hi - lo, final_eps = tolerance;
+    if (final_eps <= 0) {
+        final_eps = integral ? 1.0 / (n + 1) : std::max(range, 1.0) * 1e-9 / (n + 1);
+    }
+    double eps = std::max(final_eps, range / 5), lone = range + final_eps;
+
+    std::vector<double> price(m, 0), profit(n, 0), bid(n), best(m);
+    std::vector<size_t> object(n), owner(m), target(n), bidder(m), stamp(m, 0), unassigned, next, touched;
+    size_t round = 0;
+    while (true) {
+        std::fill(object.begin(), object.end(), assignment_npos);
+        std::fill(owner.begin(), owner.end(), assignment_npos);
+        unassigned.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            unassigned[i] = i;
+        }
+        while (!unassigned.empty()) {
+            size_t count = unassigned.size();
+            parallel::for_each_block(count, count >= optimization::assignment::auction_grain ? threads : 1, [&](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; ++k) {
+                    size_t i = unassigned[k], j1 = assignment_npos;
+                    double v1 = -assignment_inf, v2 = -assignment_inf, a1 = 0;
+                    for (sparse_block::InnerIterator it(persons, i); it; ++it) {
+                        double v = -it.value() - price[it.row()];
+                        if (v > v1) {
+                            v2 = v1;
+                            v1 = v;
+                            j1 = it.row();
+                            a1 = -it.value();
+                        } else if (v > v2) {
+                            v2 = v;
+                        }
+                    }
+                    if (v2 == -assignment_inf) {
+                        v2 = v1 - lone;
+                    }
+                    target[k] = j1;
+                    bid[k] = a1 - v2 + eps;
+                }
+            });
+            ++round;
+            touched.clear();
+            next.clear();
+            for (size_t k = 0; k < count; ++k) {
+                size_t j = target[k];
+                if (stamp[j] != round) {
+                    stamp[j] = round;
+                    best[j] = bid[k];
+                    bidder[j] = unassigned[k];
+                    touched.push_back(j);
+                } else if (bid[k] > best[j]) {
+                    next.push_back(bidder[j]);
+                    best[j] = bid[k];
+                    bidder[j] = unassigned[k];
+                } else {
+                    next.push_back(unassigned[k]);
+                }
+            }
+            for (const auto& j : touched) {
+                size_t i = bidder[j];
+                if (owner[j] != assignment_npos) {
+                    object[owner[j]] = assignment_npos;
+                    next.push_back(owner[j]);
+                }
+                owner[j] = i;
+                object[i] = j;
+                price[j] = best[j];
+                profit[i] = -persons.coeff(j, i) - price[j];
+            }
+            unassigned.swap(next);
+        }
+        if (eps <= final_eps) {
+            break;
+        }
+        eps = std::max(final_eps, eps / 5);
+    }
+
+    if (m > n) {
+        double lambda = assignment_inf;
+        for (size_t i = 0; i < n; ++i) {
+            lambda = std::min(lambda, price[object[i]]);
+        }
+        std::vector<size_t> queue;
+        for (size_t j = 0; j < m; ++j) {
+            if (owner[j] == assignment_npos && price[j] > lambda) {
+                queue.push_back(j);
+            }
+        }
+        while (!queue.empty()) {
+            size_t j = queue.back(), i1 = assignment_npos;
+            queue.pop_back();
+            double w1 = -assignment_inf, w2 = -assignment_inf, a1 = 0;
+            for (sparse_block::InnerIterator it(objects, j); it; ++it) {
+                double w = -it.value() - profit[it.row()];
+                if (w > w1) {
+                    w2 = w1;
+                    w1 = w;
+                    i1 = it.row();
+                    a1 = -it.value();
+                } else if (w > w2) {
+                    w2 = w;
+                }
+            }
+            if (i1 == assignment_npos || lambda >= w1 - eps) {
+                price[j] = lambda;
+                continue;
+            }
+            size_t k = object[i1];
+            price[j] = std::max(lambda, w2 - eps);
+            profit[i1] = a1 - price[j];
+            object[i1] = j;
+            owner[j] = i1;
+            owner[k] = assignment_npos;
+            if (price[k] > lambda) {
+                queue.push_back(k);
+            }
+        }
+    }
+
+    this->path.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        this->sum += persons.coeff(object[i], i);
+        this->path[i] = transposed ? std::make_pair(object[i], i) : std::make_pair(i, object[i]);
+    }
+    std::sort(this->path.begin(), this->path.end());
+}
+
+const std::vector<std::pair<size_t, size_t>>& optimization::assignment::solve() const
+{
+    return this->path;
+}
+
+double optimization::assignment::obj() const
+{
+    return this->sum;
+}
+}
@@ -0,0 +1,119 @@
+#include "autodiff.hpp"
+
+namespace anyprog {
+namespace autodiff {
+
+    tape& tape::active()
+    {
+        static thread_local tape t;
+        return t;
+    }
+
+    var tape::variable(double v)
+    {
+        return var(v, this->push(npos, 0));
+    }
+
+    void tape::clear()
+    {
+        this->nodes.clear();
+    }
+
+    void tape::backward(const var& y, real_vector_map& g)
+    {
+        g.setZero();
+        if (y.is_constant()) {
+            return;
+        }
+        this->adjoint.assign(y.index() + 1, 0.0);
+        this->adjoint[y.index()] = 1;
+        for (size_t i = y.index() + 1; i-- > 0;) {
+            double a = this->adjoint[i];
+            if (a == 0) {
+                continue;
+            }
+            const node& cur = this->nodes[i];
+            for (size_t k = 0; k < 2; ++k) {
+                if (cur.parent[k] != npos) {
+                    this->adjoint[cur.parent[k]] += cur.partial[k] * a;
+                }
+            }
+        }
+        size_t n = std::min<size_t>(g.size(), this->adjoint.size());
+        for (size_t i = 0; i < n; ++i) {
+            g(i) = this->adjoint[i];
+        }
+    }
+
+    double evaluate(const function_t& f, const const_real_vector_map& x, real_vector_map& g)
+    {
+        size_t n = x.size();
+        if (g.size() == 0) {
+            var_block v = x.cast<var>();
+            return f(v).value();
+        }
+        tape& t = tape::active();
+        t.clear();
+        var_block v(n);
+        for (size_t i = 0; i < n; ++i) {
+            v(i) = t.variable(x(i));
+        }
+        var y = f(v);
+        t.backward(y, g);
+        return y.value();
+    }
+
+    optimization::function_t value(const function_t& f)
+    {
+        return [f](const real_block& x) {
+            var_block v = x.col(0).cast<var>();
+            return f(v).value();
+        };
+    }
+
+    optimization::gradient_function_t gradient(const function_t& f)
+    {
+        return [f](const real_block& x) {
+            real_block ret(x.rows(), 1);
+            const_real_vector_map p(x.data(), x.rows());
+            real_vector_map g(ret.data(), ret.rows());
+            evaluate(f, p, g);
+            return ret;
+        };
+    }
+
+    optimization::map_function_t map_function(const function_t& f)
+    {
+        return [f](const const_real_vector_map& x, real_vector_map& g) {
+            return evaluate(f, x, g);
+        };
+    }
+
+    std::vector<optimization::function_t> value(const std::vector<function_t>& f)
+    {
+        std::vector<optimization::function_t> ret;
+        for (const auto& i : f) {
+            ret.push_back(value(i));
+        }
+        return ret;
+    }
+
+    std::vector<optimization::gradient_function_t> gradient(const std::vector<function_t>& f)
+    {
+        std::vector<optimization::gradient_function_t> ret;
+        for (const auto& i : f) {
+            ret.push_back(gradient(i));
+        }
+        return ret;
+    }
+
+    std::vector<optimization::map_function_t> map_function(const std::vector<function_t>& f)
+    {
+        std::vector<optimization::map_function_t> ret;
+        for (const auto& i : f) {
+            ret.push_back(map_function(i));
+        }
+        return ret;
+    }
+}
+}
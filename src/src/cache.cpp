@@ -0,0 +1,177 @@
+#include "cache.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace anyprog {
+
+static const size_t cache_shard_number = 16;
+
+evaluation_cache::evaluation_cache(size_t width, size_t capacity)
+    : width(width)
+    , shard_capacity(0)
+    , shard_count(capacity >= 64 * cache_shard_number ? cache_shard_number : 1)
+    , shard(new shard_t[capacity >= 64 * cache_shard_number ? cache_shard_number : 1])
+    , hits(0)
+    , lookups(0)
+{
+    this->shard_capacity = std::max<size_t>(1, (capacity + this->shard_count - 1) / this->shard_count);
+    size_t size = 2;
+    while (size < 2 * this->shard_capacity) {
+        size *= 2;
+    }
+    for (size_t s = 0; s < this->shard_count; ++s) {
+        shard_t& t = this->shard[s];
+        t.table.assign(size, -1);
+        t.prev.resize(this->shard_capacity);
+        t.next.resize(this->shard_capacity);
+        t.hash.resize(this->shard_capacity);
+        t.slot.resize(this->shard_capacity);
+        t.key.resize(this->shard_capacity * width);
+        t.value.resize(this->shard_capacity);
+        t.head = t.tail = -1;
+        t.used = 0;
+    }
+}
+
+size_t evaluation_cache::dimension() const
+{
+    return this->width;
+}
+
+double evaluation_cache::hit_rate() const
+{
+    size_t n = this->lookups.load();
+    return n == 0 ? 0 : static_cast<double>(this->hits.load()) / n;
+}
+
+void evaluation_cache::clear()
+{
+    for (size_t s = 0; s < this->shard_count; ++s) {
+        shard_t& t = this->shard[s];
+        std::lock_guard<std::mutex> guard(t.lock);
+        std::fill(t.table.begin(), t.table.end(), -1);
+        t.head = t.tail = -1;
+        t.used = 0;
+    }
+    this->hits = 0;
+    this->lookups = 0;
+}
+
+// splitmix64 over the slot and the bits of every coordinate, with -0 taken as +0
+// so that keys equal under == hash alike.
+uint64_t evaluation_cache::digest(size_t slot, const double* x) const
+{
+    auto mix = [](uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    };
+    uint64_t h = mix(slot + 0x9e3779b97f4a7c15ULL);
+    for (size_t i = 0; i < this->width; ++i) {
+        double v = x[i] + 0.0;
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        h = mix(h ^ (bits + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+    }
+    return h;
+}
+
+// Table position holding the key, or -1.
+int evaluation_cache::locate(const shard_t& t, uint64_t h, size_t slot, const double* x) const
+{
+    size_t mask = t.table.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        int n = t.table[i];
+        if (n < 0) {
+            return -1;
+        }
+        if (t.hash[n] == h && t.slot[n] == slot && std::equal(x, x + this->width, t.key.begin() + n * this->width)) {
+            return static_cast<int>(i);
+        }
+    }
+}
+
+// Moves node n to the front of the LRU list.
+void evaluation_cache::touch(shard_t& t, int n)
+{
+    if (t.head == n) {
+        return;
+    }
+    if (t.prev[n] >= 0) {
+        t.next[t.prev[n]] = t.next[n];
+        if (t.next[n] >= 0) {
+            t.prev[t.next[n]] = t.prev[n];
+        } else {
+            t.tail = t.prev[n];
+        }
+    }
+    t.prev[n] = -1;
+    t.next[n] = t.head;
+    if (t.head >= 0) {
+        t.prev[t.head] = n;
+    }
+    t.head = n;
+    if (t.tail < 0) {
+        t.tail = n;
+    }
+}
+
+// Empties table position i, shifting back the entries of the probe run after it so
+// that no lookup stops early at the hole.
+void evaluation_cache::erase(shard_t& t, int i)
+{
+    size_t mask = t.table.size() - 1, hole = i;
+    for (size_t j = (hole + 1) & mask; t.table[j] >= 0; j = (j + 1) & mask) {
+        size_t home = t.hash[t.table[j]] & mask;
+        bool stays = hole <= j ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (!stays) {
+            t.table[hole] = t.table[j];
+            hole = j;
+        }
+    }
+    t.table[hole] = -1;
+}
+
+bool evaluation_cache::find(size_t slot, const double* x, uint64_t h, double& v)
+{
+    shard_t& t = this->shard[(h >> 59) % this->shard_count];
+    std::lock_guard<std::mutex> guard(t.lock);
+    this->lookups.fetch_add(1, std::memory_order_relaxed);
+    int i = this->locate(t, h, slot, x);
+    if (i < 0) {
+        return false;
+    }
+    int n = t.table[i];
+    this->touch(t, n);
+    v = t.value[n];
+    this->hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void evaluation_cache::insert(size_t slot, const double* x, uint64_t h, double v)
+{
+    shard_t& t = this->shard[(h >> 59) % this->shard_count];
+    std::lock_guard<std::mutex> guard(t.lock);
+    if (this->locate(t, h, slot, x) >= 0) {
+        return;
+    }
+    int n;
+    if (static_cast<size_t>(t.used) < this->shard_capacity) {
+        n = t.used++;
+        t.prev[n] = t.next[n] = -1;
+    } else {
+        n = t.tail;
+        this->erase(t, this->locate(t, t.hash[n], t.slot[n], &t.key[n * this->width]));
+    }
+    t.hash[n] = h;
+    t.slot[n] = slot;
+    t.value[n] = v;
+    std::copy(x, x + this->width, t.key.begin() + n * this->width);
+    this->touch(t, n);
+    size_t mask = t.table.size() - 1, i = h & mask;
+    while (t.table[i] >= 0) {
+        i = (i + 1) & mask;
+    }
+    t.table[i] = n;
+}
+}
@@ -0,0 +1,62 @@
+#ifndef ANYPROG_CACHE_HPP
+#define ANYPROG_CACHE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace anyprog {
+
+// Bounded memo table from (slot, x) to a function value, where the slot tells the
+// objective and the conditions apart and x has `width` coordinates compared exactly.
+// Keys hash to one of several independently locked shards. A shard is an open
+// addressing table (linear probing, backward-shift deletion) of indices into a fixed
+// pool of nodes, and the nodes form its LRU list, so a full shard evicts the point
+// it used least recently. The function runs outside the lock: two threads missing
+// on the same point both evaluate it and the later insert is dropped.
+class evaluation_cache {
+private:
+    class shard_t {
+    public:
+        std::mutex lock;
+        std::vector<int> table, prev, next;
+        std::vector<uint64_t> hash;
+        std::vector<size_t> slot;
+        std::vector<double> key, value;
+        int head, tail, used;
+    };
+    size_t width, shard_capacity, shard_count;
+    std::unique_ptr<shard_t[]> shard;
+    std::atomic<size_t> hits, lookups;
+    uint64_t digest(size_t, const double*) const;
+    int locate(const shard_t&, uint64_t, size_t, const double*) const;
+    void touch(shard_t&, int);
+    void erase(shard_t&, int);
+    bool find(size_t, const double*, uint64_t, double&);
+    void insert(size_t, const double*, uint64_t, double);
+
+public:
+    evaluation_cache(size_t width, size_t capacity);
+    virtual ~evaluation_cache() = default;
+    size_t dimension() const;
+    double hit_rate() const;
+    void clear();
+
+    template <typename F>
+    double get(size_t slot, const double* x, const F& f)
+    {
+        uint64_t h = this->digest(slot, x);
+        double v;
+        if (this->find(slot, x, h, v)) {
+            return v;
+        }
+        v = f();
+        this->insert(slot, x, h, v);
+        return v;
+    }
+};
+}
+
+#endif
@@ -0,0 +1,356 @@
+#include "optimization.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace anyprog {
+
+static const double milp_inf = std::numeric_limits<double>::infinity();
+static const double integer_tol = 1e-6;
+
+size_t optimization::milp::max_nodes = 100000;
+size_t optimization::milp::progress_interval = 1000;
+size_t optimization::milp::cut_rounds = 5;
+double optimization::milp::relative_gap = 1e-6;
+
+optimization::milp::milp(const real_block& c, const std::vector<range_t>& range, const std::vector<size_t>& index)
+    : c(c)
+    , root(range)
+    , integer(c.rows(), 0)
+    , ineq()
+    , lp(c, range)
+    , progress()
+    , node_limit(0)
+    , stop()
+    , sol(c.rows(), 1)
+    , fval(milp_inf)
+    , lower_bound(-milp_inf)
+    , node_count(0)
+    , status(optimization::simplex::status_t::ITERATION_LIMIT)
+{
+    if (this->root.size() != this->integer.size()) {
+        this->root.assign(this->integer.size(), { -milp_inf, milp_inf });
+    }
+    for (const auto& j : index) {
+        this->integer[j] = 1;
+        range_t& b = this->root[j];
+        b = { std::ceil(b.first - integer_tol), std::floor(b.second + integer_tol) };
+        this->lp.set_bound(j, b);
+    }
+    this->sol.setZero();
+}
+
+optimization::milp& optimization::milp::add_equation(const real_block& A, const real_block& b)
+{
+    this->lp.add_equation(A, b);
+    return *this;
+}
+
+optimization::milp& optimization::milp::add_inequation(const real_block& A, const real_block& b)
+{
+    this->lp.add_inequation(A, b);
+    this->ineq.push_back({ A, b });
+    return *this;
+}
+
+optimization::milp& optimization::milp::set_progress_function(const optimization::milp::progress_function_t& f)
+{
+    this->progress = f;
+    return *this;
+}
+
+optimization::milp& optimization::milp::set_node_limit(size_t n)
+{
+    this->node_limit = n;
+    return *this;
+}
+
+optimization::milp& optimization::milp::set_stop_function(const optimization::simplex::stop_function_t& f)
+{
+    this->stop = f;
+    this->lp.set_stop_function(f);
+    return *this;
+}
+
+bool optimization::milp::integral(const real_block& x, size_t& j) const
+{
+    double best = integer_tol;
+    j = this->integer.size();
+    for (size_t i = 0; i < this->integer.size(); ++i) {
+        if (this->integer[i]) {
+            double f = fabs(x(i, 0) - std::round(x(i, 0)));
+            if (f > best) {
+                best = f;
+                j = i;
+            }
+        }
+    }
+    return j == this->integer.size();
+}
+
+size_t optimization::milp::cover(const real_block& x, real_block& G, real_block& h) const
+{
+    size_t n = this->integer.size();
+    std::vector<real_block> cuts;
+    for (const auto& block : this->ineq) {
+        const real_block& A = block.first;
+        for (size_t i = 0; i < static_cast<size_t>(A.rows()); ++i) {
+            double b = block.second(i, 0);
+            std::vector<std::pair<double, size_t>> items;
+            bool knapsack = b > 0;
+            for (size_t j = 0; knapsack && j < n; ++j) {
+                if (A(i, j) != 0) {
+                    knapsack = A(i, j) > 0 && this->integer[j] && this->root[j].first == 0 && this->root[j].second == 1;
+                    items.push_back({ 1 - x(j, 0), j });
+                }
+            }
+            if (!knapsack) {
+                continue;
+            }
+            std::sort(items.begin(), items.end());
+            double weight = 0, lhs = 0;
+            real_block row = real_block::Zero(1, n);
+            size_t size = 0;
+            for (const auto& it : items) {
+                weight += A(i, it.second);
+                lhs += x(it.second, 0);
+                row(0, it.second) = 1;
+                ++size;
+                if (weight > b + integer_tol) {
+                    break;
+                }
+            }
+            if (weight > b + integer_tol && lhs > size - 1 + integer_tol) {
+                cuts.push_back(row);
+            }
+        }
+    }
+    G.resize(cuts.size(), n);
+    h.setConstant(cuts.size(), 1, 0);
+    for (size_t i = 0; i < cuts.size(); ++i) {
+        G.row(i) = cuts[i];
+        h(i, 0) = cuts[i].sum() - 1;
+    }
+    return cuts.size();
+}
+
+bool optimization::milp::branch(node_t& cur, node_t& dive, node_t& other)
+{
+    size_t n = this->integer.size();
+    for (size_t j = 0; j < n; ++j) {
+        if (this->integer[j]) {
+            this->lp.set_bound(j, this->root[j]);
+        }
+    }
+    for (const auto& i : cur.change) {
+        this->lp.set_bound(i.first, i.second);
+    }
+    if (cur.basis) {
+        this->lp.set_basis(*cur.basis);
+    }
+    ++this->node_count;
+    this->status = this->lp.solve();
+    if (this->status != optimization::simplex::status_t::OPTIMAL) {
+        return false;
+    }
+    double z = this->lp.obj();
+    if (z >= this->fval - 1e-9 * std::max(1.0, fabs(this->fval))) {
+        return false;
+    }
+    const real_block& x = this->lp.solution();
+    size_t j;
+    if (this->integral(x, j)) {
+        this->sol = x;
+        for (size_t i = 0; i < n; ++i) {
+            if (this->integer[i]) {
+                this->sol(i, 0) = std::round(this->sol(i, 0));
+            }
+        }
+        this->fval = this->c.col(0).dot(this->sol.col(0));
+        if (this->progress) {
+            this->progress(this->node_count, this->fval, this->lower_bound);
+        }
+        return false;
+    }
+
+    std::vector<std::pair<size_t, range_t>> change(std::move(cur.change));
+    const simplex::basis_t& basis = this->lp.get_basis();
+    if (std::isfinite(this->fval)) {
+        for (size_t k = 0; k < n; ++k) {
+            if (!this->integer[k]) {
+                continue;
+            }
+            const range_t& b = this->lp.get_bound(k);
+            double d = this->lp.reduced_cost(k);
+            if (basis[k] == optimization::simplex::state_t::AT_LOWER && d > 1e-9) {
+                double u = b.first + std::floor((this->fval - z) / d + integer_tol);
+                if (u < b.second) {
+                    change.push_back({ k, { b.first, u } });
+                }
+            } else if (basis[k] == optimization::simplex::state_t::AT_UPPER && d < -1e-9) {
+                double l = b.second - std::floor((this->fval - z) / -d + integer_tol);
+                if (l > b.first) {
+                    change.push_back({ k, { l, b.second } });
+                }
+            }
+        }
+    }
+
+    double v = x(j, 0);
+    const range_t b = this->lp.get_bound(j);
+    std::shared_ptr<const simplex::basis_t> shared = std::make_shared<simplex::basis_t>(basis);
+    node_t down, up;
+    down.bound = up.bound = z;
+    down.basis = up.basis = shared;
+    down.change = change;
+    down.change.push_back({ j, { b.first, std::floor(v) } });
+    up.change = std::move(change);
+    up.change.push_back({ j, { std::ceil(v), b.second } });
+    if (v - std::floor(v) > 0.5) {
+        dive = std::move(up);
+        other = std::move(down);
+    } else {
+        dive = std::move(down);
+        other = std::move(up);
+    }
+    return true;
+}
+
+optimization::simplex::status_t optimization::milp::solve()
+{
+    this->fval = milp_inf;
+    this->lower_bound = -milp_inf;
+    this->node_count = 0;
+    this->status = optimization::simplex::status_t::INFEASIBLE;
+    for (const auto& b : this->root) {
+        if (b.first > b.second) {
+            return this->status;
+        }
+    }
+    this->status = this->lp.solve();
+    if (this->status != optimization::simplex::status_t::OPTIMAL) {
+        return this->status;
+    }
+    this->lower_bound = this->lp.obj();
+    for (size_t round = 0; round < optimization::milp::cut_rounds; ++round) {
+        size_t j;
+        if (this->integral(this->lp.solution(), j)) {
+            break;
+        }
+        real_block G, h, C, d;
+        size_t gomory = this->lp.gomory(this->integer, 50, G, h), covers = this->cover(this->lp.solution(), C, d);
+        if (gomory + covers == 0) {
+            break;
+        }
+        if (gomory > 0) {
+            this->lp.add_inequation(G, h);
+        }
+        if (covers > 0) {
+            this->lp.add_inequation(C, d);
+        }
+        double before = this->lp.obj();
+        optimization::simplex::status_t st = this->lp.solve();
+        if (st == optimization::simplex::status_t::INFEASIBLE) {
+            this->status = st;
+            return st;
+        } else if (st != optimization::simplex::status_t::OPTIMAL) {
+            break;
+        }
+        this->lower_bound = std::max(this->lower_bound, this->lp.obj());
+        if (this->lp.obj() - before < 1e-6 * std::max(1.0, fabs(before))) {
+            break;
+        }
+    }
+
+    auto cmp = [](const node_t& a, const node_t& b) { return a.bound > b.bound; };
+    std::vector<node_t> heap;
+    node_t cur;
+    cur.bound = this->lower_bound;
+    cur.basis = std::make_shared<simplex::basis_t>(this->lp.get_basis());
+    bool have = true, limited = false, stopped = false;
+    size_t limit = this->node_limit > 0 ? std::min(this->node_limit, optimization::milp::max_nodes) : optimization::milp::max_nodes;
+    while (true) {
+        if (!have) {
+            if (heap.empty()) {
+                break;
+            }
+            std::pop_heap(heap.begin(), heap.end(), cmp);
+            cur = std::move(heap.back());
+            heap.pop_back();
+        }
+        double cutoff = this->fval - 1e-9 * std::max(1.0, fabs(this->fval));
+        if (cur.bound >= cutoff) {
+            have = false;
+            if (!heap.empty() && heap.front().bound >= cutoff) {
+                heap.clear();
+            }
+            continue;
+        }
+        this->lower_bound = heap.empty() ? cur.bound : std::min(cur.bound, heap.front().bound);
+        if (this->gap() <= optimization::milp::relative_gap || this->node_count >= limit) {
+            limited = this->gap() > optimization::milp::relative_gap;
+            break;
+        }
+        if (this->stop && this->stop()) {
+            stopped = true;
+            break;
+        }
+        node_t dive, other;
+        have = this->branch(cur, dive, other);
+        if (this->status == optimization::simplex::status_t::STOPPED) {
+            stopped = true;
+            break;
+        }
+        if (have) {
+            heap.emplace_back(std::move(other));
+            std::push_heap(heap.begin(), heap.end(), cmp);
+            cur = std::move(dive);
+        }
+        if (this->progress && this->node_count % optimization::milp::progress_interval == 0) {
+            this->progress(this->node_count, this->fval, this->lower_bound);
+        }
+    }
+    if (!stopped && !have && heap.empty() && std::isfinite(this->fval)) {
+        this->lower_bound = this->fval;
+    }
+    if (stopped) {
+        this->status = optimization::simplex::status_t::STOPPED;
+    } else if (std::isfinite(this->fval)) {
+        this->status = limited ? optimization::simplex::status_t::ITERATION_LIMIT : optimization::simplex::status_t::OPTIMAL;
+    } else {
+        this->status = limited ? optimization::simplex::status_t::ITERATION_LIMIT : optimization::simplex::status_t::INFEASIBLE;
+    }
+    if (this->progress) {
+        this->progress(this->node_count, this->fval, this->lower_bound);
+    }
+    return this->status;
+}
+
+const real_block& optimization::milp::solution() const
+{
+    return this->sol;
+}
+
+double optimization::milp::obj() const
+{
+    return this->fval;
+}
+
+double optimization::milp::bound() const
+{
+    return this->lower_bound;
+}
+
+double optimization::milp::gap() const
+{
+    if (!std::isfinite(this->fval)) {
+        return milp_inf;
+    }
+    return std::max(0.0, this->fval - this->lower_bound) / std::max(1.0, fabs(this->fval));
+}
+
+size_t optimization::milp::nodes() const
+{
+    return this->node_count;
+}
+}
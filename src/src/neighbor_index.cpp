@@ -0,0 +1,179 @@
+#include "optimization.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace anyprog {
+
+static const size_t neighbor_npos = static_cast<size_t>(-1);
+
+size_t optimization::neighbor_index::leaf_size = 8;
+
+optimization::neighbor_index::neighbor_index(const std::vector<tsp::point2d_t>& point, bool geographic)
+    : point(point)
+    , coordinate(3 * point.size())
+    , order(point.size())
+    , axis(point.size(), 0)
+    , geographic(geographic)
+{
+    size_t n = point.size();
+    for (size_t i = 0; i < n; ++i) {
+        this->locate(point[i], &this->coordinate[3 * i]);
+        this->order[i] = i;
+    }
+    this->build(0, n);
+    std::vector<double> sorted(3 * n);
+    for (size_t t = 0; t < n; ++t) {
+        std::copy_n(&this->coordinate[3 * this->order[t]], 3, &sorted[3 * t]);
+    }
+    this->coordinate.swap(sorted);
+}
+
+void optimization::neighbor_index::locate(const tsp::point2d_t& p, double* x) const
+{
+    if (this->geographic) {
+        double lat = p.first * M_PI / 180, lon = p.second * M_PI / 180;
+        x[0] = cos(lat) * cos(lon);
+        x[1] = cos(lat) * sin(lon);
+        x[2] = sin(lat);
+    } else {
+        x[0] = p.first;
+        x[1] = p.second;
+        x[2] = 0;
+    }
+}
+
+// Splits [begin, end) of `order` at its median along the widest axis; the median
+// slot keeps the splitting point and axis[mid] records the axis. Runs of at most
+// leaf_size points stay unsplit.
+void optimization::neighbor_index::build(size_t begin, size_t end)
+{
+    if (end - begin <= optimization::neighbor_index::leaf_size) {
+        return;
+    }
+    double lo[3], hi[3];
+    std::fill_n(lo, 3, HUGE_VAL);
+    std::fill_n(hi, 3, -HUGE_VAL);
+    for (size_t t = begin; t < end; ++t) {
+        const double* x = &this->coordinate[3 * this->order[t]];
+        for (size_t a = 0; a < 3; ++a) {
+            lo[a] = std::min(lo[a], x[a]);
+            hi[a] = std::max(hi[a], x[a]);
+        }
+    }
+    unsigned char a = 0;
+    for (unsigned char b = 1; b < 3; ++b) {
+        if (hi[b] - lo[b] > hi[a] - lo[a]) {
+            a = b;
+        }
+    }
+    size_t mid = begin + (end - begin) / 2;
+    std::nth_element(this->order.begin() + begin, this->order.begin() + mid, this->order.begin() + end, [&](size_t i, size_t j) {
+        return this->coordinate[3 * i + a] < this->coordinate[3 * j + a];
+    });
+    this->axis[mid] = a;
+    this->build(begin, mid);
+    this->build(mid + 1, end);
+}
+
+// Keeps the k nearest points seen so far in `heap`, a max-heap on squared chord
+// length, and visits the far side of a split only when it may still hold a closer one.
+void optimization::neighbor_index::search(const double* q, size_t begin, size_t end, size_t k, size_t skip, std::vector<std::pair<double, size_t>>& heap) const
+{
+    auto visit = [&](size_t t) {
+        if (this->order[t] == skip) {
+            return;
+        }
+        const double* x = &this->coordinate[3 * t];
+        double d = (x[0] - q[0]) * (x[0] - q[0]) + (x[1] - q[1]) * (x[1] - q[1]) + (x[2] - q[2]) * (x[2] - q[2]);
+        std::pair<double, size_t> item(d, this->order[t]);
+        if (heap.size() < k) {
+            heap.push_back(item);
+            std::push_heap(heap.begin(), heap.end());
+        } else if (item < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = item;
+            std::push_heap(heap.begin(), heap.end());
+        }
+    };
+    if (end - begin <= optimization::neighbor_index::leaf_size) {
+        for (size_t t = begin; t < end; ++t) {
+            visit(t);
+        }
+        return;
+    }
+    size_t mid = begin + (end - begin) / 2;
+    unsigned char a = this->axis[mid];
+    double diff = q[a] - this->coordinate[3 * mid + a];
+    visit(mid);
+    if (diff < 0) {
+        this->search(q, begin, mid, k, skip, heap);
+        if (heap.size() < k || diff * diff <= heap.front().first) {
+            this->search(q, mid + 1, end, k, skip, heap);
+        }
+    } else {
+        this->search(q, mid + 1, end, k, skip, heap);
+        if (heap.size() < k || diff * diff <= heap.front().first) {
+            this->search(q, begin, mid, k, skip, heap);
+        }
+    }
+}
+
+size_t optimization::neighbor_index::size() const
+{
+    return this->point.size();
+}
+
+std::vector<size_t> optimization::neighbor_index::nearest(const tsp::point2d_t& p, size_t k, size_t skip) const
+{
+    double q[3];
+    this->locate(p, q);
+    std::vector<std::pair<double, size_t>> heap;
+    this->search(q, 0, this->point.size(), k, skip, heap);
+    std::sort_heap(heap.begin(), heap.end());
+    std::vector<size_t> ret(heap.size());
+    for (size_t i = 0; i < heap.size(); ++i) {
+        ret[i] = heap[i].second;
+    }
+    return ret;
+}
+
+// Shared by both candidates(): column q gets the k nearest points of query[q] in row
+// order, leaving out point q itself when the index queries its own points.
+static optimization::assignment::sparse_block candidate_graph(const optimization::neighbor_index& index, const std::vector<optimization::tsp::point2d_t>& point, const std::vector<optimization::tsp::point2d_t>& query, size_t k, const optimization::tsp::point2d_distance_function_t& f, bool self, size_t threads)
+{
+    size_t m = query.size();
+    std::vector<std::vector<std::pair<size_t, double>>> column(m);
+    parallel::for_each_block(m, threads, [&](size_t begin, size_t end) {
+        for (size_t q = begin; q < end; ++q) {
+            for (const auto& j : index.nearest(query[q], k, self ? q : neighbor_npos)) {
+                column[q].push_back({ j, f(query[q], point[j]) });
+            }
+            std::sort(column[q].begin(), column[q].end());
+        }
+    });
+    optimization::assignment::sparse_block ret(point.size(), m);
+    Eigen::VectorXi count(m);
+    for (size_t q = 0; q < m; ++q) {
+        count[q] = column[q].size();
+    }
+    ret.reserve(count);
+    for (size_t q = 0; q < m; ++q) {
+        for (const auto& i : column[q]) {
+            ret.insert(i.first, q) = i.second;
+        }
+    }
+    ret.makeCompressed();
+    return ret;
+}
+
+optimization::assignment::sparse_block optimization::neighbor_index::candidates(size_t k, const tsp::point2d_distance_function_t& f, size_t threads) const
+{
+    return candidate_graph(*this, this->point, this->point, k, f, true, threads);
+}
+
+optimization::assignment::sparse_block optimization::neighbor_index::candidates(const std::vector<tsp::point2d_t>& query, size_t k, const tsp::point2d_distance_function_t& f, size_t threads) const
+{
+    return candidate_graph(*this, this->point, query, k, f, false, threads);
+}
+}
@@ -202,12 +202,6 @@ static nlopt_result crs_init(crs_data *d, int n, const double *x,
 
      /* generate initial points randomly, plus starting guess x */
      memcpy(d->ps + 1, x, sizeof(double) * n);
-     d->ps[0] = f(n, x, NULL, f_data);
-     ++ *(stop->nevals_p);
-     if (!rb_tree_insert(&d->t, d->ps)) return NLOPT_OUT_OF_MEMORY;
-     if (d->ps[0] < stop->minf_max) return NLOPT_MINF_MAX_REACHED;
-     if (nlopt_stop_evals(stop)) return NLOPT_MAXEVAL_REACHED;
-     if (nlopt_stop_time(stop)) return NLOPT_MAXTIME_REACHED;
      for (i = 1; i < d->N; ++i) {
 	  double *k = d->ps + i*(n+1);
 	  if (d->s) 
@@ -217,6 +211,22 @@ static nlopt_result crs_init(crs_data *d, int n, const double *x,
 	       for (j = 0; j < n; ++j) 
 		    k[1 + j] = nlopt_urand(lb[j], ub[j]);
 	  }
+     }
+     if (stop->prefetch) {
+	  const double **xk = (const double **) malloc(sizeof(double*) * d->N);
+	  if (!xk) return NLOPT_OUT_OF_MEMORY;
+	  for (i = 0; i < d->N; ++i) xk[i] = d->ps + i*(n+1) + 1;
+	  nlopt_stop_prefetch(stop, (unsigned) n, (unsigned) d->N, xk);
+	  free(xk);
+     }
+     d->ps[0] = f(n, x, NULL, f_data);
+     ++ *(stop->nevals_p);
+     if (!rb_tree_insert(&d->t, d->ps)) return NLOPT_OUT_OF_MEMORY;
+     if (d->ps[0] < stop->minf_max) return NLOPT_MINF_MAX_REACHED;
+     if (nlopt_stop_evals(stop)) return NLOPT_MAXEVAL_REACHED;
+     if (nlopt_stop_time(stop)) return NLOPT_MAXTIME_REACHED;
+     for (i = 1; i < d->N; ++i) {
+	  double *k = d->ps + i*(n+1);
 	  k[0] = f(n, k + 1, NULL, f_data);
 	  ++ *(stop->nevals_p);
 	  if (!rb_tree_insert(&d->t, k)) return NLOPT_OUT_OF_MEMORY;
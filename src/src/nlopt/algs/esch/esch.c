@@ -86,6 +86,7 @@ nlopt_result chevolutionarystrategy(
      Individual * esparents;			/* Parents population */
      Individual * esoffsprings;		/* Offsprings population */
      Individual * estotal;/* copy containing Parents and Offsprings pops */
+     const double ** esprefetch;	/* parameters of the next batch to evaluate */
      /* It is interesting to maintain the parents and offsprings
       * populations stablished and sorted; when the final iterations
       * is achieved, they are ranked and updated. */
@@ -102,8 +103,9 @@ nlopt_result chevolutionarystrategy(
      esparents    = (Individual*) malloc(sizeof(Individual) * np);
      esoffsprings = (Individual*) malloc(sizeof(Individual) * no);
      estotal 	 = (Individual*) malloc(sizeof(Individual) * (np+no));
-     if ((!esparents)||(!esoffsprings)||(!estotal)) {
-	  free(esparents); free(esoffsprings); free(estotal);
+     esprefetch   = (const double**) malloc(sizeof(double*) * (np+no));
+     if ((!esparents)||(!esoffsprings)||(!estotal)||(!esprefetch)) {
+	  free(esparents); free(esoffsprings); free(estotal); free(esprefetch);
 	  return NLOPT_OUT_OF_MEMORY;
      }
      for (id=0; id < np; id++) esparents[id].parameters = NULL;
@@ -161,6 +163,8 @@ nlopt_result chevolutionarystrategy(
      /**************************************
       * Parents fitness evaluation
       **************************************/
+     for (id=0; id < np; id++) esprefetch[id] = esparents[id].parameters;
+     nlopt_stop_prefetch(stop, nparameters, np, esprefetch);
      for (id=0; id < np; id++) {
 	  esparents[id].fitness =
 	       f(nparameters, esparents[id].parameters, NULL, data_f);
@@ -214,6 +218,8 @@ nlopt_result chevolutionarystrategy(
 	  /**************************************
 	   * Offsprings fitness evaluation
 	   **************************************/
+	  for (id=0; id < no; id++) esprefetch[id] = esoffsprings[id].parameters;
+	  nlopt_stop_prefetch(stop, nparameters, no, esprefetch);
 	  for (id=0; id < no; id++){
 	       /*esoffsprings[id].fitness = (double)fitness(esoffsprings[id].parameters, nparameters,fittype);*/
 	       esoffsprings[id].fitness = f(nparameters, esoffsprings[id].parameters, NULL, data_f);
@@ -258,5 +264,6 @@ done:
      if (esparents) 	free(esparents);
      if (esoffsprings) 	free(esoffsprings);
      if (estotal) 		free(estotal);
+     free(esprefetch);
      return ret;
 }
@@ -76,6 +76,7 @@ nlopt_result isres_minimize(int n, nlopt_func f, void *f_data,
      double *penalty; /* population array of penalty vals */
      double *x0;
      int *irank = 0;
+     const double **xk = 0; /* population array of pointers into xs */
      int k, i, j, c;
      int mp = m + p;
      double minf_penalty = HUGE_VAL, minf_gpenalty = HUGE_VAL;
@@ -118,6 +119,9 @@ nlopt_result isres_minimize(int n, nlopt_func f, void *f_data,
 
      irank = (int*) malloc(sizeof(int) * population);
      if (!irank) { ret = NLOPT_OUT_OF_MEMORY; goto done; }
+     xk = (const double **) malloc(sizeof(double*) * population);
+     if (!xk) { ret = NLOPT_OUT_OF_MEMORY; goto done; }
+     for (k = 0; k < population; ++k) xk[k] = xs + k*n;
 
      for (k = 0; k < population; ++k) {
 	  for (j = 0; j < n; ++j) {
@@ -131,6 +135,7 @@ nlopt_result isres_minimize(int n, nlopt_func f, void *f_data,
 	  int all_feasible = 1;
 
 	  /* evaluate f and constraint violations for whole population */
+	  nlopt_stop_prefetch(stop, n, population, xk);
 	  for (k = 0; k < population; ++k) {
 	       int feasible = 1;
 	       double gpenalty;
@@ -281,6 +286,7 @@ nlopt_result isres_minimize(int n, nlopt_func f, void *f_data,
      }
 
 done:
+     if (xk) free(xk);
      if (irank) free(irank);
      if (sigmas) free(sigmas);
      if (results) free(results);
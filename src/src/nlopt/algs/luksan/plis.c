@@ -111,7 +111,7 @@ static void plis_(int *nf, int *nb, double *x, int *
 		  double *minf_est, double *gmax,
 		  double *f, int *mit, int *mfv, int *iest, int *mf,
 		  int *iterm, stat_common *stat_1,
-		  nlopt_func objgrad, void *objgrad_data)
+		  nlopt_func objgrad, void *objgrad_data, int *kw)
 {
     /* System generated locals */
     int i__1;
@@ -143,6 +143,7 @@ static void plis_(int *nf, int *nb, double *x, int *
     int iters, irest, inits, kters, maxst;
     double snorm;
     int mtesx, ntesx;
+    int paired;
     ps1l01_state state;
 
     (void) tolb;
@@ -236,6 +237,15 @@ static void plis_(int *nf, int *nb, double *x, int *
     kit = -(ires1 * *nf + ires2);
     fo = *minf_est;
 
+/*     SEEDED HISTORY: THE FIRST DIRECTION USES THE KW PAIRS IN XO, GO */
+/*     AND UO, AND KW RETURNS THE PAIRS LEFT THERE (0 UNLESS PYFUT1 STOPS) */
+
+    paired = *kw > 0;
+    if (paired) {
+	kit = 1 - MIN2(*kw, *mf);
+    }
+    *kw = 0;
+
 /*     INITIAL OPERATIONS WITH SIMPLE BOUNDS */
 
     if (kbf > 0) {
@@ -268,6 +278,9 @@ L11120:
 	    &ntesx, &mtesx, &ntesf, &mtesf, &ites, &ires1, &ires2, &irest, &
 	    iters, iterm);
     if (*iterm != 0) {
+	if (paired) {
+	    *kw = MIN2(stat_1->nit + 1 - kit, *mf);
+	}
 	goto L11190;
     }
     if (nlopt_stop_time(stop)) { *iterm = 100; goto L11190; }
@@ -325,6 +338,7 @@ L12620:
 	if (kit < stat_1->nit) {
 	    ++stat_1->nres;
 	    kit = stat_1->nit;
+	    paired = 1;
 	} else {
 	     *iterm = -10;
 	    if (iters < 0) {
@@ -434,6 +448,9 @@ nlopt_result luksan_plis(int n, nlopt_func f, void *f_data,
      int mfv = stop->maxeval;
      stat_common stat;
      int iterm;
+     int kw = 0;
+     unsigned warm_size = 0;
+     const double *warm;
 
      ix = (int*) malloc(sizeof(int) * n);
      if (!ix) return NLOPT_OUT_OF_MEMORY;
@@ -474,6 +491,17 @@ nlopt_result luksan_plis(int n, nlopt_func f, void *f_data,
 	arrays to zero by default? */
      memset(xo, 0, sizeof(double) * MAX2(n,n*mf));
 
+     /* a saved history holds its pairs newest first: the xo columns, the go
+	columns, then uo */
+     warm = nlopt_stop_warm(stop, NLOPT_LD_LBFGS, 0, &warm_size);
+     if (warm && mf > 0 && warm_size % (unsigned) (2 * n + 1) == 0) {
+	  int k = (int) (warm_size / (unsigned) (2 * n + 1));
+	  kw = MIN2(k, mf);
+	  memcpy(xo, warm, sizeof(double) * n * kw);
+	  memcpy(go, warm + n * k, sizeof(double) * n * kw);
+	  memcpy(uo, warm + 2 * n * k, sizeof(double) * kw);
+     }
+
      plis_(&n, &nb, x, ix, xl, xu,
 	   gf, s, xo, go, uo, vo,
 	   &xmax,
@@ -491,7 +519,16 @@ nlopt_result luksan_plis(int n, nlopt_func f, void *f_data,
 	   &iest,
 	   &mf,
 	   &iterm, &stat,
-	   f, f_data);
+	   f, f_data, &kw);
+
+     if (stop->warm) {
+	  double *saved = nlopt_stop_warm_save(stop, NLOPT_LD_LBFGS, 0, (unsigned) (kw * (2 * n + 1)));
+	  if (saved) {
+	       memcpy(saved, xo, sizeof(double) * n * kw);
+	       memcpy(saved + n * kw, go, sizeof(double) * n * kw);
+	       memcpy(saved + 2 * n * kw, uo, sizeof(double) * kw);
+	  }
+     }
 
      free(work);
      free(ix);
@@ -159,6 +159,8 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
      int feasible;
      double infeasibility;
      unsigned mfc;
+     unsigned warm_size = 0;
+     const double *warm;
 
      m = nlopt_count_constraints(mfc = m, fc);
      if (nlopt_get_dimension(dual_opt) != m) {
@@ -208,6 +210,19 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
 	  dual_ub[i] = HUGE_VAL;
      }
 
+     /* seeded run: the asymptote distances sigma, the penalties rho and rhoc and the
+	dual variables y the last run ended with */
+     warm = nlopt_stop_warm(stop, NLOPT_LD_MMA, m, &warm_size);
+     if (warm && warm_size == n + 1 + 2 * m) {
+	  for (j = 0; j < n; ++j)
+	       if (sigma[j] != 0 && warm[j] > 0) sigma[j] = warm[j];
+	  rho = MAX(warm[n], MMA_RHOMIN);
+	  for (i = 0; i < m; ++i) {
+	       rhoc[i] = MAX(warm[n + 1 + i], MMA_RHOMIN);
+	       y[i] = MAX(warm[n + 1 + m + i], 0.0);
+	  }
+     }
+
      dd.fval = fcur = *minf = f(n, x, dfdx, f_data);
      ++ *(stop->nevals_p);
      memcpy(xcur, x, sizeof(double) * n);
@@ -397,6 +412,15 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
      }
 
  done:
+     if (stop->warm) {
+	  double *saved = nlopt_stop_warm_save(stop, NLOPT_LD_MMA, m, n + 1 + 2 * m);
+	  if (saved) {
+	       memcpy(saved, sigma, sizeof(double) * n);
+	       saved[n] = rho;
+	       memcpy(saved + n + 1, rhoc, sizeof(double) * m);
+	       memcpy(saved + n + 1 + m, y, sizeof(double) * m);
+	  }
+     }
      free(sigma);
      return ret;
 }
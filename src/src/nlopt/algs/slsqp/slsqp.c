@@ -1776,6 +1776,7 @@ typedef struct {
     int iexact;
     int incons, ireset, itermx;
     double *x0;
+    const double *warm; /* saved factors of B, then penalty weights mu, or NULL */
 } slsqpb_state;
 
 #define SS(var) state->var = var
@@ -1902,6 +1903,10 @@ L110:
 	j = j + n1 - i__;
 /* L120: */
     }
+    if (ireset == 1 && state->warm) { /* seeded run: the B and mu of the last one */
+	dcopy___(&n2, state->warm, 1, &l[1], 1);
+	dcopy___(m, state->warm + n2, 1, &mu[1], 1);
+    }
 /*   MAIN ITERATION : SEARCH DIRECTION, STEPLENGTH, LDL'-UPDATE */
 L130:
     ++(*iter);
@@ -2442,7 +2447,7 @@ nlopt_result nlopt_slsqp(unsigned n, nlopt_func f, void *f_data,
 			 double *x, double *minf,
 			 nlopt_stopping *stop)
 {
-     slsqpb_state state = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,NULL};
+     slsqpb_state state = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,NULL,NULL};
      unsigned mtot = nlopt_count_constraints(m, fc);
      unsigned ptot = nlopt_count_constraints(p, h);
      double *work, *cgrad, *c, *grad, *w, 
@@ -2458,6 +2463,8 @@ nlopt_result nlopt_slsqp(unsigned n, nlopt_func f, void *f_data,
      double infeasibility = HUGE_VAL, infeasibility_cur = HUGE_VAL;
      unsigned max_cdim;
      int want_grad = 1;
+     int started = 0; /* whether slsqp has set up B */
+     unsigned nl = (n + 1) * n / 2, warm_size = 0;
      
      max_cdim = MAX2(nlopt_max_constraint_dim(m, fc),
 		    nlopt_max_constraint_dim(p, h));
@@ -2483,6 +2490,9 @@ nlopt_result nlopt_slsqp(unsigned n, nlopt_func f, void *f_data,
      memcpy(xprev, x, sizeof(double) * n);
      fprev = fcur = *minf = HUGE_VAL;
      feasible = feasible_cur = 0;
+     state.warm = nlopt_stop_warm(stop, NLOPT_LD_SLSQP, U(mpi), &warm_size);
+     if (warm_size != nl + 2 * U(mpi))
+	  state.warm = NULL;
 
      goto eval_f_and_grad; /* eval before calling slsqp the first time */
 
@@ -2493,6 +2503,7 @@ nlopt_result nlopt_slsqp(unsigned n, nlopt_func f, void *f_data,
 		&acc, &iter, &mode,
 		w, &len_w, jw, &len_jw,
 		&state);
+	  started = 1;
 
 	  switch (mode) {
 	  case -1:  /* objective & gradient evaluation */
@@ -2633,6 +2644,17 @@ done:
 	  }
      }
 
+     /* save B (as its LDL' factors at w + la), mu (at w) and the QP multipliers (at
+	w + la + nl + 1 + n, equality constraints first) for the next run */
+     if (started) {
+	  double *saved = nlopt_stop_warm_save(stop, NLOPT_LD_SLSQP, U(mpi), nl + 2 * U(mpi));
+	  if (saved) {
+	       memcpy(saved, w + mpi1, sizeof(double) * nl);
+	       memcpy(saved + nl, w, sizeof(double) * U(mpi));
+	       memcpy(saved + nl + mpi, w + mpi1 + nl + 1 + n, sizeof(double) * U(mpi));
+	  }
+     }
+
      free(work);
      return ret;
 }
@@ -39,6 +39,9 @@ extern "C" {
         nlopt_func f;
         void *f_data;           /* objective function to minimize */
         nlopt_precond pre;      /* optional preconditioner for f (NULL if none) */
+        nlopt_prefetch prefetch;        /* optional batch hint for f (NULL if none) */
+        void *prefetch_data;
+        nlopt_warm_state *warm_state;   /* optional state seeded and saved by the run (NULL if none) */
         int maximize;           /* nonzero if we are maximizing, not minimizing */
 
         double *lb, *ub;        /* lower and upper bounds (length n) */
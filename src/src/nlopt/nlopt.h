@@ -69,6 +69,10 @@ typedef void (*nlopt_mfunc) (unsigned m, double *result, unsigned n, const doubl
    (The meaning of "preconditioning" is algorithm-dependent.) */
 typedef void (*nlopt_precond) (unsigned n, const double *x, const double *v, double *vpre, void *data);
 
+/* announces the k points of dimension n an algorithm is about to evaluate one by one,
+   in that order, so that the caller may compute them all at once beforehand */
+typedef void (*nlopt_prefetch) (unsigned n, unsigned k, const double *const *x, void *data);
+
 typedef enum {
     /* Naming conventions:
 
@@ -153,6 +157,19 @@ typedef enum {
     NLOPT_NUM_ALGORITHMS        /* not an algorithm, just the number of them */
 } nlopt_algorithm;
 
+/* solver state carried from one run to the next: the quasi-Newton matrix and the
+   multipliers of SLSQP, the limited-memory history of LBFGS, the asymptotes, penalties
+   and dual variables of MMA.  A run seeds itself from
+   a state that the same algorithm saved for the same n and m, and then saves its own
+   final state over it; other algorithms leave it alone.  The layout of data is private
+   to the algorithm that saved it; release it with nlopt_warm_state_clear. */
+typedef struct {
+    nlopt_algorithm algorithm;  /* the algorithm that saved the state */
+    unsigned n, m;              /* dimension and constraint count it was saved for */
+    unsigned size;              /* doubles in data, 0 when nothing is saved */
+    double *data;
+} nlopt_warm_state;
+
 NLOPT_EXTERN(const char *) nlopt_algorithm_name(nlopt_algorithm a);
 
 /* nlopt_algorithm enum <-> string conversion */
@@ -209,6 +226,9 @@ NLOPT_EXTERN(nlopt_result) nlopt_set_min_objective(nlopt_opt opt, nlopt_func f,
 NLOPT_EXTERN(nlopt_result) nlopt_set_max_objective(nlopt_opt opt, nlopt_func f, void *f_data);
 
 NLOPT_EXTERN(nlopt_result) nlopt_set_precond_min_objective(nlopt_opt opt, nlopt_func f, nlopt_precond pre, void *f_data);
+NLOPT_EXTERN(nlopt_result) nlopt_set_prefetch(nlopt_opt opt, nlopt_prefetch prefetch, void *data);
+NLOPT_EXTERN(nlopt_result) nlopt_set_warm_state(nlopt_opt opt, nlopt_warm_state *state);
+NLOPT_EXTERN(void) nlopt_warm_state_clear(nlopt_warm_state *state);
 NLOPT_EXTERN(nlopt_result) nlopt_set_precond_max_objective(nlopt_opt opt, nlopt_func f, nlopt_precond pre, void *f_data);
 
 NLOPT_EXTERN(nlopt_algorithm) nlopt_get_algorithm(const nlopt_opt opt);
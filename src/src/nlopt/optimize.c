@@ -278,6 +278,8 @@ static nlopt_opt elimdim_create(nlopt_opt opt)
 
     opt0->f = elimdim_func;
     opt0->f_data = elimdim_makedata(opt->f, NULL, opt->f_data, opt->n, x, opt->lb, opt->ub, grad);
+    opt0->prefetch = NULL;      /* its points live in the reduced space */
+    opt0->warm_state = NULL;    /* and so would its state */
     if (!opt0->f_data)
         goto bad;
 
@@ -427,6 +429,9 @@ static nlopt_result nlopt_optimize_(nlopt_opt opt, double *x, double *minf)
     stop.start = nlopt_seconds();
     stop.force_stop = &(opt->force_stop);
     stop.stop_msg = &(opt->errmsg);
+    stop.prefetch = opt->prefetch;
+    stop.prefetch_data = opt->prefetch_data;
+    stop.warm = opt->warm_state;
 
     switch (algorithm) {
     case NLOPT_GN_DIRECT:
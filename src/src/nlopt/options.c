@@ -77,6 +77,9 @@ nlopt_opt NLOPT_STDCALL nlopt_create(nlopt_algorithm algorithm, unsigned n)
         opt->f = NULL;
         opt->f_data = NULL;
         opt->pre = NULL;
+        opt->prefetch = NULL;
+        opt->prefetch_data = NULL;
+        opt->warm_state = NULL;
         opt->maximize = 0;
         opt->munge_on_destroy = opt->munge_on_copy = NULL;
 
@@ -262,6 +265,36 @@ nlopt_result NLOPT_STDCALL nlopt_set_min_objective(nlopt_opt opt, nlopt_func f,
     return nlopt_set_precond_min_objective(opt, f, NULL, f_data);
 }
 
+nlopt_result NLOPT_STDCALL nlopt_set_prefetch(nlopt_opt opt, nlopt_prefetch prefetch, void *data)
+{
+    if (opt) {
+        nlopt_unset_errmsg(opt);
+        opt->prefetch = prefetch;
+        opt->prefetch_data = data;
+        return NLOPT_SUCCESS;
+    }
+    return NLOPT_INVALID_ARGS;
+}
+
+nlopt_result NLOPT_STDCALL nlopt_set_warm_state(nlopt_opt opt, nlopt_warm_state *state)
+{
+    if (opt) {
+        nlopt_unset_errmsg(opt);
+        opt->warm_state = state;
+        return NLOPT_SUCCESS;
+    }
+    return NLOPT_INVALID_ARGS;
+}
+
+void NLOPT_STDCALL nlopt_warm_state_clear(nlopt_warm_state *state)
+{
+    if (state) {
+        free(state->data);
+        state->data = NULL;
+        state->size = 0;
+    }
+}
+
 nlopt_result NLOPT_STDCALL nlopt_set_precond_max_objective(nlopt_opt opt, nlopt_func f, nlopt_precond pre, void *f_data)
 {
     if (opt) {
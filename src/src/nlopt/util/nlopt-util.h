@@ -86,6 +86,9 @@ extern "C" {
         double maxtime, start;
         int *force_stop;
         char **stop_msg;        /* pointer to msg string to update */
+        nlopt_prefetch prefetch;        /* batch hint for the objective (NULL if none) */
+        void *prefetch_data;
+        nlopt_warm_state *warm;         /* state to seed from and save to (NULL if none) */
     } nlopt_stopping;
     extern int nlopt_stop_f(const nlopt_stopping * stop, double f, double oldf);
     extern int nlopt_stop_ftol(const nlopt_stopping * stop, double f, double oldf);
@@ -93,6 +96,9 @@ extern "C" {
     extern int nlopt_stop_dx(const nlopt_stopping * stop, const double *x, const double *dx);
     extern int nlopt_stop_xs(const nlopt_stopping * stop, const double *xs, const double *oldxs, const double *scale_min, const double *scale_max);
     extern int nlopt_stop_evals(const nlopt_stopping * stop);
+    extern void nlopt_stop_prefetch(const nlopt_stopping * stop, unsigned n, unsigned k, const double *const *x);
+    extern const double *nlopt_stop_warm(const nlopt_stopping * stop, nlopt_algorithm a, unsigned m, unsigned *size);
+    extern double *nlopt_stop_warm_save(const nlopt_stopping * stop, nlopt_algorithm a, unsigned m, unsigned size);
     extern int nlopt_stop_time_(double start, double maxtime);
     extern int nlopt_stop_time(const nlopt_stopping * stop);
     extern int nlopt_stop_evalstime(const nlopt_stopping * stop);
@@ -22,6 +22,7 @@
 
 #include <math.h>
 #include <float.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -135,6 +136,49 @@ int nlopt_stop_evals(const nlopt_stopping * s)
     return (s->maxeval > 0 && *(s->nevals_p) >= s->maxeval);
 }
 
+/* hands the caller's prefetch hook the points about to be evaluated, at most as many
+   as the evaluation budget still allows */
+void nlopt_stop_prefetch(const nlopt_stopping * s, unsigned n, unsigned k, const double *const *x)
+{
+    if (s->prefetch) {
+        if (s->maxeval > 0 && *(s->nevals_p) + (int) k > s->maxeval)
+            k = *(s->nevals_p) < s->maxeval ? (unsigned) (s->maxeval - *(s->nevals_p)) : 0;
+        if (k > 0)
+            s->prefetch(n, k, x, s->prefetch_data);
+    }
+}
+
+/* the saved state of algorithm a for this dimension and m constraints, or NULL */
+const double *nlopt_stop_warm(const nlopt_stopping * s, nlopt_algorithm a, unsigned m, unsigned *size)
+{
+    const nlopt_warm_state *w = s->warm;
+    if (!w || w->algorithm != a || w->n != s->n || w->m != m || w->size == 0 || !w->data)
+        return NULL;
+    *size = w->size;
+    return w->data;
+}
+
+/* room for `size` doubles of state of algorithm a, or NULL without a state to save to;
+   size 0 (or no memory) leaves the state empty */
+double *nlopt_stop_warm_save(const nlopt_stopping * s, nlopt_algorithm a, unsigned m, unsigned size)
+{
+    nlopt_warm_state *w = s->warm;
+    double *data;
+    if (!w)
+        return NULL;
+    w->algorithm = a;
+    w->n = s->n;
+    w->m = m;
+    data = size > 0 ? (double *) realloc(w->data, sizeof(double) * size) : NULL;
+    if (!data) {
+        nlopt_warm_state_clear(w);
+        return NULL;
+    }
+    w->data = data;
+    w->size = size;
+    return data;
+}
+
 int nlopt_stop_time_(double start, double maxtime)
 {
     return (maxtime > 0 && nlopt_seconds() - start >= maxtime);
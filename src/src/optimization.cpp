@@ -1,8 +1,19 @@
 #include "optimization.hpp"
+#include "cache.hpp"
 #include "nlopt/nlopt.h"
+#include "parallel.hpp"
 #include "random.hpp"
+#include "trace.hpp"
 #include "util.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
 
 namespace anyprog {
 
@@ -11,63 +22,205 @@ bool optimization::enable_default_bound_step = true;
 double optimization::default_bound_step = 50;
 size_t optimization::default_population = 200;
 size_t optimization::max_reloop_iter = 3;
+size_t optimization::default_thread_number = 1;
+size_t optimization::max_branch_node = 10000;
+size_t optimization::max_idle_context = 64;
+double optimization::warm_start_step = 1e-3;
+
+// Statistics of one problem; the nlopt contexts count into their help_t records
+// without locking and add up here once their solve is over.
+class stats_recorder {
+public:
+    stats_recorder()
+        : lock()
+        , stats()
+        , begin(std::chrono::steady_clock::now())
+    {
+    }
+    virtual ~stats_recorder() = default;
+    std::mutex lock;
+    optimization::solve_stats stats;
+    std::chrono::steady_clock::time_point begin;
+};
+
+// Runs f, counting the call and, when seconds is given, adding its wall time.
+template <class F>
+static auto counted(size_t& calls, double* seconds, F f) -> decltype(f())
+{
+    ++calls;
+    if (!seconds) {
+        return f();
+    }
+    auto begin = std::chrono::steady_clock::now();
+    auto ret = f();
+    *seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return ret;
+}
 
 double optimization::instance_fun(unsigned n, const double* x, double* grad, void* my_func_data)
 {
-    real_block ret(n, 1);
-    for (size_t i = 0; i < n; ++i) {
-        ret(i, 0) = x[i];
+    optimization::help_t* help = (optimization::help_t*)(my_func_data);
+    if (help->cancel && help->cancel->is_cancelled()) {
+        nlopt_force_stop((nlopt_opt)help->handle);
     }
+    if (help->batch && !grad && help->batch_next < static_cast<size_t>(help->batch_point.cols()) && std::equal(x, x + n, help->batch_point.col(help->batch_next).data())) {
+        return help->batch_value(help->batch_next++);
+    }
+    real_vector_map g(grad, grad ? n : 0);
+    if (help->filter && *help->filter) {
+        std::copy(x, x + n, help->buffer.data());
+        (*help->filter)(help->buffer);
+        x = help->buffer.data();
+    }
+    const_real_vector_map p(x, n);
+    auto run = [&]() { return counted(help->calls, help->timed ? &help->seconds : 0, [&]() { return help->fun(p, g); }); };
+    if (help->cache && !grad && help->cache->dimension() == n) {
+        return help->cache->get(help->slot, x, run);
+    }
+    return run();
+}
+
+// Population algorithms announce a generation before evaluating it point by point;
+// the whole generation goes through the batch function here and instance_fun then
+// serves the announced points in order from batch_value.
+void optimization::instance_prefetch(unsigned n, unsigned k, const double* const* x, void* my_func_data)
+{
     optimization::help_t* help = (optimization::help_t*)(my_func_data);
-    if (*help->filter) {
-        (*help->filter)(ret);
+    help->batch_next = 0;
+    help->batch_point.resize(n, 0);
+    if (!help->batch || n != help->buffer.rows()) {
+        return;
+    }
+    real_block p(n, k);
+    for (size_t j = 0; j < k; ++j) {
+        p.col(j) = const_real_vector_map(x[j], n);
     }
-    if (grad && help->grad) {
-        real_block tmp = (*help->grad)(ret);
-        for (size_t i = 0; i < n; ++i) {
-            grad[i] = tmp(i, 0);
+    help->batch_point = p;
+    if (help->filter && *help->filter) {
+        for (size_t j = 0; j < k; ++j) {
+            help->buffer = p.col(j);
+            (*help->filter)(help->buffer);
+            p.col(j) = help->buffer;
         }
     }
-
-    return (*help->fun)(ret);
+    trace_span span(help->trace, "batch");
+    size_t batches = 0;
+    help->batch_value = counted(batches, help->timed ? &help->seconds : 0, [&]() { return (*help->batch)(p); });
+    help->calls += k;
+    if (static_cast<size_t>(help->batch_value.size()) != k) {
+        help->batch_point.resize(n, 0);
+    }
 }
 
 double optimization::instance_eq_fun(unsigned n, const double* x, double* grad, void* my_func_data)
 {
-    real_block ret(n, 1);
-    for (size_t i = 0; i < n; ++i) {
-        ret(i, 0) = x[i];
-    }
+    return optimization::instance_fun(n, x, grad, my_func_data);
+}
+
+double optimization::instance_ineq_fun(unsigned n, const double* x, double* grad, void* my_func_data)
+{
+    return optimization::instance_fun(n, x, grad, my_func_data);
+}
+
+void optimization::instance_linear_fun(unsigned m, double* result, unsigned n, const double* x, double* grad, void* my_func_data)
+{
     optimization::help_t* help = (optimization::help_t*)(my_func_data);
-    if (*help->filter) {
-        (*help->filter)(ret);
+    if (help->filter && *help->filter) {
+        std::copy(x, x + n, help->buffer.data());
+        (*help->filter)(help->buffer);
+        x = help->buffer.data();
     }
-    if (grad && help->grad) {
-        real_block tmp = (*help->grad)(ret);
-        for (size_t i = 0; i < n; ++i) {
-            grad[i] = tmp(i, 0);
-        }
+    const real_block& A = help->linear->first;
+    real_vector_map ret(result, m);
+    ret.noalias() = A * const_real_vector_map(x, n);
+    ret -= help->linear->second;
+    if (grad) {
+        Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(grad, m, n) = A;
     }
-    return (*help->fun)(ret);
 }
 
-double optimization::instance_ineq_fun(unsigned n, const double* x, double* grad, void* my_func_data)
+// Runs the fused function only when x differs from the last point or a jacobian is
+// wanted that the last run did not produce; NLopt asks for the objective and every
+// condition block at the same x, so all of them are served by one run.
+const optimization::fused_point_t& optimization::evaluate(optimization::fused_point_t& s, const double* x, size_t n, bool jacobian)
+{
+    if (s.ready && (!jacobian || s.with_jacobian) && std::equal(x, x + n, s.x.data())) {
+        return s;
+    }
+    s.x = const_real_vector_map(x, n);
+    size_t m = s.eq.rows(), p = s.ineq.rows();
+    if (jacobian) {
+        s.jacobian.setZero(1 + m + p, n);
+    }
+    s.value(0, 0) = counted(s.calls, s.timed ? &s.seconds : 0, [&]() { return (*s.fun)(s.x, s.eq, s.ineq, jacobian ? &s.jacobian : 0); });
+    s.value.block(1, 0, m, 1) = s.eq;
+    s.value.block(1 + m, 0, p, 1) = s.ineq;
+    s.ready = true;
+    s.with_jacobian = jacobian;
+    return s;
+}
+
+double optimization::instance_fused_fun(unsigned n, const double* x, double* grad, void* my_func_data)
 {
-    real_block ret(n, 1);
-    for (size_t i = 0; i < n; ++i) {
-        ret(i, 0) = x[i];
+    optimization::help_t* help = (optimization::help_t*)(my_func_data);
+    if (help->cancel && help->cancel->is_cancelled()) {
+        nlopt_force_stop((nlopt_opt)help->handle);
+    }
+    if (help->filter && *help->filter) {
+        std::copy(x, x + n, help->buffer.data());
+        (*help->filter)(help->buffer);
+        x = help->buffer.data();
     }
+    const optimization::fused_point_t& s = optimization::evaluate(*help->fused, x, n, grad != 0);
+    if (grad) {
+        real_vector_map(grad, n) = s.jacobian.row(0).transpose();
+    }
+    return s.value(0, 0);
+}
+
+void optimization::instance_fused_condition_fun(unsigned m, double* result, unsigned n, const double* x, double* grad, void* my_func_data)
+{
     optimization::help_t* help = (optimization::help_t*)(my_func_data);
-    if (*help->filter) {
-        (*help->filter)(ret);
+    if (help->filter && *help->filter) {
+        std::copy(x, x + n, help->buffer.data());
+        (*help->filter)(help->buffer);
+        x = help->buffer.data();
     }
-    if (grad && help->grad) {
-        real_block tmp = (*help->grad)(ret);
-        for (size_t i = 0; i < n; ++i) {
-            grad[i] = tmp(i, 0);
-        }
+    const optimization::fused_point_t& s = optimization::evaluate(*help->fused, x, n, grad != 0);
+    real_vector_map(result, m) = s.value.block(help->slot, 0, m, 1);
+    if (grad) {
+        Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(grad, m, n) = s.jacobian.middleRows(help->slot, m);
     }
-    return (*help->fun)(ret);
+}
+
+optimization::map_function_t optimization::make_map_function(const optimization::function_t& fun, const optimization::gradient_function_t* grad, size_t n)
+{
+    std::shared_ptr<real_block> buffer = std::make_shared<real_block>(n, 1);
+    return [&fun, grad, buffer](const const_real_vector_map& x, real_vector_map& g) {
+        real_block& p = *buffer;
+        p = x;
+        if (g.size() > 0 && grad && *grad) {
+            g = (*grad)(p);
+        }
+        return fun(p);
+    };
+}
+
+double optimization::evaluate(const optimization::map_function_t& fun, const real_block& x)
+{
+    const_real_vector_map p(x.data(), x.rows());
+    real_vector_map g(0, 0);
+    return fun(p, g);
+}
+
+optimization::map_function_t optimization::make_linear_function(const real_block& v)
+{
+    return [v](const const_real_vector_map& x, real_vector_map& g) {
+        if (g.size() > 0) {
+            g = v;
+        }
+        return v.col(0).dot(x);
+    };
 }
 
 real_block optimization::fminunc(const optimization::function_t& obj, const real_block& p, bool& ok, double eps, size_t max_iter)
@@ -133,16 +286,36 @@ optimization::optimization(const function_t& fun, const real_block& p)
     : solver(optimization::solver_t::NLOPT)
     , fval(0)
     , ok(false)
+    , gap(0)
     , point(p)
     , cb(fun)
+    , map_cb()
     , filter_cb()
     , grad_cb()
+    , fused_cb()
+    , fused_eq(0)
+    , fused_ineq(0)
+    , batch_cb()
     , eq_fun()
     , ineq_fun()
     , eq_grad_fun()
     , ineq_grad_fun()
     , range()
     , history()
+    , threads(optimization::default_thread_number)
+    , seed(std::chrono::system_clock::now().time_since_epoch().count())
+    , cache()
+    , workspace()
+    , warm_step()
+    , warm()
+    , recording(0)
+    , stats()
+    , trace()
+    , time_budget(0)
+    , deadline(std::chrono::steady_clock::time_point::max())
+    , budget_depth(0)
+    , cancel()
+    , progress_cb()
 {
     if (optimization::enable_default_bound_step) {
         double bound_step = fabs(optimization::default_bound_step);
@@ -156,14 +329,34 @@ optimization::optimization(const function_t& fun, const real_block& p, const std
     : solver(optimization::solver_t::NLOPT)
     , fval(0)
     , ok(false)
+    , gap(0)
     , point(p)
     , cb(fun)
+    , map_cb()
     , filter_cb()
     , grad_cb()
+    , fused_cb()
+    , fused_eq(0)
+    , fused_ineq(0)
+    , batch_cb()
     , eq_fun()
     , ineq_fun()
     , range(range)
     , history()
+    , threads(optimization::default_thread_number)
+    , seed(std::chrono::system_clock::now().time_since_epoch().count())
+    , cache()
+    , workspace()
+    , warm_step()
+    , warm()
+    , recording(0)
+    , stats()
+    , trace()
+    , time_budget(0)
+    , deadline(std::chrono::steady_clock::time_point::max())
+    , budget_depth(0)
+    , cancel()
+    , progress_cb()
 {
 }
 
@@ -171,53 +364,107 @@ optimization::optimization(const function_t& fun, const std::vector<optimization
     : solver(optimization::solver_t::NLOPT)
     , fval(0)
     , ok(false)
+    , gap(0)
     , point(range.size(), 1)
     , cb(fun)
+    , map_cb()
     , filter_cb()
     , grad_cb()
+    , fused_cb()
+    , fused_eq(0)
+    , fused_ineq(0)
+    , batch_cb()
     , eq_fun()
     , ineq_fun()
     , range(range)
     , history()
+    , threads(optimization::default_thread_number)
+    , seed(std::chrono::system_clock::now().time_since_epoch().count())
+    , cache()
+    , workspace()
+    , warm_step()
+    , warm()
+    , recording(0)
+    , stats()
+    , trace()
+    , time_budget(0)
+    , deadline(std::chrono::steady_clock::time_point::max())
+    , budget_depth(0)
+    , cancel()
+    , progress_cb()
 {
-    random rng(0, 1);
-    for (size_t i = 0; i < this->point.rows(); ++i) {
-        this->point(i, 0) = this->range[i].first + (this->range[i].second - this->range[i].first) * rng.generate();
-    }
+    random(0, 1, this->seed).fill(this->point, this->range);
 }
 
 optimization::optimization(const function_t& fun, const optimization::range_t& rge, size_t dim)
     : solver(optimization::solver_t::NLOPT)
     , fval(0)
     , ok(false)
+    , gap(0)
     , point(dim, 1)
     , cb(fun)
+    , map_cb()
     , filter_cb()
     , grad_cb()
+    , fused_cb()
+    , fused_eq(0)
+    , fused_ineq(0)
+    , batch_cb()
     , eq_fun()
     , ineq_fun()
     , range()
     , history()
+    , threads(optimization::default_thread_number)
+    , seed(std::chrono::system_clock::now().time_since_epoch().count())
+    , cache()
+    , workspace()
+    , warm_step()
+    , warm()
+    , recording(0)
+    , stats()
+    , trace()
+    , time_budget(0)
+    , deadline(std::chrono::steady_clock::time_point::max())
+    , budget_depth(0)
+    , cancel()
+    , progress_cb()
 {
-    random rng(0, 1);
-    for (size_t i = 0; i < this->point.rows(); ++i) {
-        this->range.push_back(rge);
-        this->point(i, 0) = rge.first + (rge.second - rge.first) * rng.generate();
-    }
+    this->range.assign(this->point.rows(), rge);
+    random(0, 1, this->seed).fill(this->point, rge.first, rge.second);
 }
 
 optimization::optimization(const real_block& v, const real_block& p)
-    : solver(optimization::solver_t::NLOPT)
+    : solver(optimization::solver_t::LP_SIMPLEX)
     , fval(0)
     , ok(false)
+    , gap(0)
     , point(p)
     , cb()
+    , map_cb()
     , filter_cb()
     , grad_cb()
+    , fused_cb()
+    , fused_eq(0)
+    , fused_ineq(0)
+    , batch_cb()
     , eq_fun()
     , ineq_fun()
     , range()
     , history()
+    , threads(optimization::default_thread_number)
+    , seed(std::chrono::system_clock::now().time_since_epoch().count())
+    , cache()
+    , workspace()
+    , warm_step()
+    , warm()
+    , recording(0)
+    , stats()
+    , trace()
+    , time_budget(0)
+    , deadline(std::chrono::steady_clock::time_point::max())
+    , budget_depth(0)
+    , cancel()
+    , progress_cb()
 {
     if (optimization::enable_default_bound_step) {
         double bound_step = fabs(optimization::default_bound_step);
@@ -225,131 +472,186 @@ optimization::optimization(const real_block& v, const real_block& p)
             this->range.push_back({ p(i, 0) - bound_step, p(i, 0) + bound_step });
         }
     }
-    this->cb = [&](const real_block& x) {
-        size_t m = x.rows();
-        double sum = 0.0;
-        for (size_t i = 0; i < m; ++i) {
-            sum += v(i, 0) * x(i, 0);
-        }
-        return sum;
-    };
+    this->map_cb = optimization::make_linear_function(v);
+    this->linear_obj = v;
 }
 optimization::optimization(const real_block& v, const std::vector<range_t>& range)
-    : solver(optimization::solver_t::NLOPT)
+    : solver(optimization::solver_t::LP_SIMPLEX)
     , fval(0)
     , ok(false)
+    , gap(0)
     , point(range.size(), 1)
     , cb()
+    , map_cb()
     , filter_cb()
     , grad_cb()
+    , fused_cb()
+    , fused_eq(0)
+    , fused_ineq(0)
+    , batch_cb()
     , eq_fun()
     , ineq_fun()
     , range(range)
     , history()
+    , threads(optimization::default_thread_number)
+    , seed(std::chrono::system_clock::now().time_since_epoch().count())
+    , cache()
+    , workspace()
+    , warm_step()
+    , warm()
+    , recording(0)
+    , stats()
+    , trace()
+    , time_budget(0)
+    , deadline(std::chrono::steady_clock::time_point::max())
+    , budget_depth(0)
+    , cancel()
+    , progress_cb()
 {
-    this->cb = [&](const real_block& x) {
-        size_t m = x.rows();
-        double sum = 0.0;
-        for (size_t i = 0; i < m; ++i) {
-            sum += v(i, 0) * x(i, 0);
-        }
-        return sum;
-    };
-    random rng(0, 1);
-    for (size_t i = 0; i < this->point.rows(); ++i) {
-        this->point(i, 0) = this->range[i].first + (this->range[i].second - this->range[i].first) * rng.generate();
-    }
+    this->map_cb = optimization::make_linear_function(v);
+    this->linear_obj = v;
+    random(0, 1, this->seed).fill(this->point, this->range);
 }
 
 optimization::optimization(const real_block& v, const optimization::range_t& rge)
-    : solver(optimization::solver_t::NLOPT)
+    : solver(optimization::solver_t::LP_SIMPLEX)
     , fval(0)
     , ok(false)
+    , gap(0)
     , point(v.rows(), 1)
     , cb()
+    , map_cb()
     , filter_cb()
     , grad_cb()
+    , fused_cb()
+    , fused_eq(0)
+    , fused_ineq(0)
+    , batch_cb()
     , eq_fun()
     , ineq_fun()
     , range()
     , history()
+    , threads(optimization::default_thread_number)
+    , seed(std::chrono::system_clock::now().time_since_epoch().count())
+    , cache()
+    , workspace()
+    , warm_step()
+    , warm()
+    , recording(0)
+    , stats()
+    , trace()
+    , time_budget(0)
+    , deadline(std::chrono::steady_clock::time_point::max())
+    , budget_depth(0)
+    , cancel()
+    , progress_cb()
 {
-    this->cb = [&](const real_block& x) {
-        size_t m = x.rows();
-        double sum = 0.0;
-        for (size_t i = 0; i < m; ++i) {
-            sum += v(i, 0) * x(i, 0);
-        }
-        return sum;
-    };
-    random rng(0, 1);
-    for (size_t i = 0; i < this->point.rows(); ++i) {
-        this->range.push_back(rge);
-        this->point(i, 0) = rge.first + (rge.second - rge.first) * rng.generate();
-    }
+    this->map_cb = optimization::make_linear_function(v);
+    this->linear_obj = v;
+    this->range.assign(this->point.rows(), rge);
+    random(0, 1, this->seed).fill(this->point, rge.first, rge.second);
 }
 optimization::optimization(const real_block& v, const real_block& p, const std::vector<range_t>& range)
-    : solver(optimization::solver_t::NLOPT)
+    : solver(optimization::solver_t::LP_SIMPLEX)
     , fval(0)
     , ok(false)
+    , gap(0)
     , point(p)
     , cb()
+    , map_cb()
     , filter_cb()
     , grad_cb()
+    , fused_cb()
+    , fused_eq(0)
+    , fused_ineq(0)
+    , batch_cb()
     , eq_fun()
     , ineq_fun()
     , range(range)
     , history()
+    , threads(optimization::default_thread_number)
+    , seed(std::chrono::system_clock::now().time_since_epoch().count())
+    , cache()
+    , workspace()
+    , warm_step()
+    , warm()
+    , recording(0)
+    , stats()
+    , trace()
+    , time_budget(0)
+    , deadline(std::chrono::steady_clock::time_point::max())
+    , budget_depth(0)
+    , cancel()
+    , progress_cb()
 {
-    this->cb = [&](const real_block& x) {
-        size_t m = x.rows();
-        double sum = 0.0;
-        for (size_t i = 0; i < m; ++i) {
-            sum += x(i, 0) * v(i, 0);
-        }
-        return sum;
-    };
+    this->map_cb = optimization::make_linear_function(v);
+    this->linear_obj = v;
+}
+
+optimization::optimization(const map_function_t& fun, const real_block& p)
+    : optimization(function_t(), p)
+{
+    this->map_cb = fun;
+}
+
+optimization::optimization(const map_function_t& fun, const std::vector<range_t>& range)
+    : optimization(function_t(), range)
+{
+    this->map_cb = fun;
+}
+
+optimization::optimization(const map_function_t& fun, const range_t& rge, size_t dim)
+    : optimization(function_t(), rge, dim)
+{
+    this->map_cb = fun;
+}
+
+optimization::optimization(const map_function_t& fun, const real_block& p, const std::vector<range_t>& range)
+    : optimization(function_t(), p, range)
+{
+    this->map_cb = fun;
 }
 
 optimization& optimization::set_equation_condition(const std::vector<equation_condition_function_t>& eq_cond)
 {
     this->eq_fun = eq_cond;
+    this->clear_cache();
+    this->reset_workspace();
     return *this;
 }
 optimization& optimization::set_inequation_condition(const std::vector<inequation_condition_function_t>& ineq_cond)
 {
     this->ineq_fun = ineq_cond;
+    this->clear_cache();
+    this->reset_workspace();
     return *this;
 }
 
 optimization& optimization::set_equation_condition(const real_block& A, const real_block& b)
 {
-    size_t m = A.rows();
-    for (size_t i = 0; i < m; ++i) {
-        this->eq_fun.emplace_back([&, i](const real_block& x) {
-            double v = 0;
-            size_t n = x.rows();
-            for (size_t j = 0; j < n; ++j) {
-                v += A(i, j) * x(j, 0);
-            }
-            return v - b(i, 0);
-        });
-    }
+    this->eq_linear.push_back({ A, b });
+    this->reset_workspace();
     return *this;
 }
 optimization& optimization::set_inequation_condition(const real_block& A, const real_block& b)
 {
-    size_t m = A.rows();
-    for (size_t i = 0; i < m; ++i) {
-        this->ineq_fun.emplace_back([&, i](const real_block& x) {
-            double v = 0;
-            size_t n = x.rows();
-            for (size_t j = 0; j < n; ++j) {
-                v += A(i, j) * x(j, 0);
-            }
-            return v - b(i, 0);
-        });
-    }
+    this->ineq_linear.push_back({ A, b });
+    this->reset_workspace();
+    return *this;
+}
+
+optimization& optimization::set_equation_condition(const std::vector<map_function_t>& eq_cond)
+{
+    this->map_eq_fun = eq_cond;
+    this->clear_cache();
+    this->reset_workspace();
+    return *this;
+}
+optimization& optimization::set_inequation_condition(const std::vector<map_function_t>& ineq_cond)
+{
+    this->map_ineq_fun = ineq_cond;
+    this->clear_cache();
+    this->reset_workspace();
     return *this;
 }
 
@@ -359,31 +661,304 @@ optimization& optimization::set_solver(optimization::solver_t s)
     return *this;
 }
 
+optimization& optimization::set_thread_number(size_t n)
+{
+    this->threads = parallel::thread_number(n);
+    return *this;
+}
+
+optimization& optimization::set_seed(unsigned long s)
+{
+    this->seed = s;
+    return *this;
+}
+
+optimization& optimization::set_evaluation_cache(size_t capacity)
+{
+    this->cache.table.reset();
+    this->cache.capacity = capacity;
+    if (capacity > 0) {
+        this->cache.table = std::make_shared<evaluation_cache>(this->point.rows(), capacity);
+    }
+    this->reset_workspace();
+    return *this;
+}
+
+// Linear data replaced in place keeps the registered rows as long as their number
+// stays; the simplex keeps its basis either way and repairs it when it no longer fits.
+optimization& optimization::update_equation_condition(size_t i, const real_block& A, const real_block& b)
+{
+    if (i >= this->eq_linear.size()) {
+        return this->set_equation_condition(A, b);
+    }
+    if (this->eq_linear[i].first.rows() != A.rows()) {
+        this->reset_workspace();
+    }
+    this->eq_linear[i] = { A, b };
+    return *this;
+}
+
+optimization& optimization::update_inequation_condition(size_t i, const real_block& A, const real_block& b)
+{
+    if (i >= this->ineq_linear.size()) {
+        return this->set_inequation_condition(A, b);
+    }
+    if (this->ineq_linear[i].first.rows() != A.rows()) {
+        this->reset_workspace();
+    }
+    this->ineq_linear[i] = { A, b };
+    return *this;
+}
+
+optimization& optimization::update_linear_objective(const real_block& v)
+{
+    this->map_cb = optimization::make_linear_function(v);
+    this->linear_obj = v;
+    this->clear_cache();
+    this->reset_workspace();
+    return *this;
+}
+
+// For callbacks that read data the caller changed in place: values cached for the
+// old data must not be served again.
+optimization& optimization::set_data_changed()
+{
+    this->clear_cache();
+    return *this;
+}
+
+optimization& optimization::set_enable_stats()
+{
+    this->stats = std::make_shared<stats_recorder>();
+    return *this;
+}
+
+optimization& optimization::set_enable_trace(size_t capacity)
+{
+    this->trace = std::make_shared<trace_recorder>(capacity);
+    return *this;
+}
+
+optimization& optimization::set_time_budget(double seconds)
+{
+    this->time_budget = seconds;
+    return *this;
+}
+
+optimization& optimization::set_cancel_token(const optimization::cancel_token& token)
+{
+    this->cancel = token;
+    return *this;
+}
+
+optimization& optimization::set_progress_function(const optimization::progress_function_t& fun)
+{
+    this->progress_cb = fun;
+    return *this;
+}
+
+optimization::cancel_token::cancel_token()
+    : flag(std::make_shared<std::atomic<bool>>(false))
+{
+}
+
+void optimization::cancel_token::cancel() const
+{
+    this->flag->store(true);
+}
+
+void optimization::cancel_token::reset() const
+{
+    this->flag->store(false);
+}
+
+bool optimization::cancel_token::is_cancelled() const
+{
+    return this->flag->load(std::memory_order_relaxed);
+}
+
+// The time budget runs from the outermost solve(), search() or resolve() call, so the
+// solve() a search or a failed resolve falls back to spends what is left of it.
+class optimization::budget_scope {
+public:
+    budget_scope(optimization& p)
+        : p(p)
+    {
+        if (this->p.budget_depth++ == 0) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            this->p.deadline = this->p.time_budget > 0 ? now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(this->p.time_budget)) : std::chrono::steady_clock::time_point::max();
+        }
+    }
+    virtual ~budget_scope()
+    {
+        if (--this->p.budget_depth == 0) {
+            this->p.deadline = std::chrono::steady_clock::time_point::max();
+        }
+    }
+    optimization& p;
+};
+
+bool optimization::stopping() const
+{
+    return this->cancel.is_cancelled() || std::chrono::steady_clock::now() >= this->deadline;
+}
+
+bool optimization::write_trace(const std::string& path) const
+{
+    return this->trace && this->trace->write(path);
+}
+
+optimization::solve_stats optimization::get_stats() const
+{
+    if (!this->stats) {
+        return optimization::solve_stats();
+    }
+    std::lock_guard<std::mutex> guard(this->stats->lock);
+    return this->stats->stats;
+}
+
+void optimization::report_incumbent(double value, const real_block& x) const
+{
+    if (this->progress_cb) {
+        this->progress_cb(value, x);
+    }
+    if (!this->stats) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(this->stats->lock);
+    std::vector<std::pair<double, double>>& best = this->stats->stats.best;
+    if (best.empty() || value < best.back().second) {
+        best.push_back({ std::chrono::duration<double>(std::chrono::steady_clock::now() - this->stats->begin).count(), value });
+    }
+}
+
+// Non-finite numbers have no JSON form and are written as null.
+static void write_json_number(std::ostringstream& out, double v)
+{
+    if (std::isfinite(v)) {
+        out << v;
+    } else {
+        out << "null";
+    }
+}
+
+std::string optimization::solve_stats::to_json() const
+{
+    std::ostringstream out;
+    out.precision(12);
+    out << "{\"result\":" << this->result << ",\"solves\":" << this->solves << ",\"failed\":" << this->failed
+        << ",\"evaluations\":" << this->evaluations << ",\"objective_calls\":" << this->objective_calls
+        << ",\"fused_calls\":" << this->fused_calls << ",\"condition_calls\":[";
+    for (size_t i = 0; i < this->condition_calls.size(); ++i) {
+        out << (i > 0 ? "," : "") << this->condition_calls[i];
+    }
+    out << "],\"rounds\":" << this->rounds << ",\"reloops\":" << this->reloops << ",\"solver_seconds\":";
+    write_json_number(out, this->solver_seconds);
+    out << ",\"callback_seconds\":";
+    write_json_number(out, this->callback_seconds);
+    out << ",\"best\":[";
+    for (size_t i = 0; i < this->best.size(); ++i) {
+        out << (i > 0 ? "," : "") << "[";
+        write_json_number(out, this->best[i].first);
+        out << ",";
+        write_json_number(out, this->best[i].second);
+        out << "]";
+    }
+    out << "],\"nodes\":" << this->nodes << ",\"bound\":";
+    write_json_number(out, this->bound);
+    out << ",\"gap\":";
+    write_json_number(out, this->gap);
+    out << "}";
+    return out.str();
+}
+
+double optimization::get_cache_hit_rate() const
+{
+    return this->cache.table ? this->cache.table->hit_rate() : 0;
+}
+
 bool optimization::is_ok() const
 {
     return this->ok;
 }
 
+double optimization::get_gap() const
+{
+    return this->gap;
+}
+
 double optimization::obj(const real_block& ret) const
 {
-    return this->cb(ret);
+    return this->cached(0, ret, [&](const real_block& p) {
+        return this->map_cb ? optimization::evaluate(this->map_cb, p) : this->cb(p);
+    });
+}
+
+// Slot 0 is the objective, then come eq_fun, map_eq_fun, ineq_fun and map_ineq_fun
+// in that order, the same numbering nlopt_solve gives its help_t records.
+double optimization::cached(size_t slot, const real_block& p, const function_t& f) const
+{
+    if (this->cache.table && static_cast<size_t>(p.size()) == this->cache.table->dimension()) {
+        return this->cache.table->get(slot, p.data(), [&]() { return f(p); });
+    }
+    return f(p);
+}
+
+void optimization::clear_cache()
+{
+    if (this->cache.table) {
+        this->cache.table->clear();
+    }
 }
-bool optimization::check(const real_block& p, double eps) const
+bool optimization::check(const real_block& p, double eps, optimization::fused_point_t* last) const
 {
+    if (this->fused_cb) {
+        optimization::fused_point_t local;
+        if (!last) {
+            this->prepare(local);
+            last = &local;
+        }
+        const real_block& v = optimization::evaluate(*last, p.data(), p.rows(), false).value;
+        if ((this->fused_eq > 0 && v.block(1, 0, this->fused_eq, 1).cwiseAbs().maxCoeff() > eps) || (this->fused_ineq > 0 && v.block(1 + this->fused_eq, 0, this->fused_ineq, 1).maxCoeff() > eps)) {
+            return false;
+        }
+    }
     bool eq_check = true, ineq_check = true;
-    size_t m = this->eq_fun.size();
+    size_t m = this->eq_fun.size(), slot = 1;
+    for (size_t i = 0; eq_check && i < m; ++i) {
+        eq_check = eq_check && fabs(this->cached(slot + i, p, this->eq_fun[i])) <= eps;
+    }
+    slot += m;
+    m = this->map_eq_fun.size();
     for (size_t i = 0; eq_check && i < m; ++i) {
-        eq_check = eq_check && fabs(this->eq_fun[i](p)) <= eps;
+        eq_check = eq_check && fabs(this->cached(slot + i, p, [&](const real_block& q) { return optimization::evaluate(this->map_eq_fun[i], q); })) <= eps;
+    }
+    slot += m;
+    for (size_t i = 0; eq_check && i < this->eq_linear.size(); ++i) {
+        const linear_condition_t& c = this->eq_linear[i];
+        eq_check = eq_check && (c.first * p - c.second).cwiseAbs().maxCoeff() <= eps;
     }
     if (eq_check) {
         double v = 0;
         m = this->ineq_fun.size();
         for (size_t i = 0; ineq_check && i < m; ++i) {
-            v = this->ineq_fun[i](p);
+            v = this->cached(slot + i, p, this->ineq_fun[i]);
             if (v > 0) {
                 ineq_check = ineq_check && v <= eps;
             }
         }
+        slot += m;
+        m = this->map_ineq_fun.size();
+        for (size_t i = 0; ineq_check && i < m; ++i) {
+            v = this->cached(slot + i, p, [&](const real_block& q) { return optimization::evaluate(this->map_ineq_fun[i], q); });
+            if (v > 0) {
+                ineq_check = ineq_check && v <= eps;
+            }
+        }
+        for (size_t i = 0; ineq_check && i < this->ineq_linear.size(); ++i) {
+            const linear_condition_t& c = this->ineq_linear[i];
+            ineq_check = ineq_check && (c.first * p - c.second).maxCoeff() <= eps;
+        }
     } else {
         return eq_check;
     }
@@ -393,95 +968,167 @@ bool optimization::check(const real_block& p, double eps) const
 optimization& optimization::set_filter_function(const optimization::filter_function_t& cb)
 {
     this->filter_cb = cb;
+    this->integer_index.clear();
     return *this;
 }
 
+optimization& optimization::set_fused_function(const optimization::fused_function_t& fun, size_t eq_number, size_t ineq_number)
+{
+    this->fused_cb = fun;
+    this->fused_eq = eq_number;
+    this->fused_ineq = ineq_number;
+    this->map_cb = optimization::map_function_t();
+    this->cb = [fun, eq_number, ineq_number](const real_block& x) {
+        real_block eq(eq_number, 1), ineq(ineq_number, 1);
+        return fun(x, eq, ineq, 0);
+    };
+    this->clear_cache();
+    this->reset_workspace();
+    return *this;
+}
+
+optimization& optimization::set_batch_function(const optimization::batch_function_t& fun)
+{
+    this->batch_cb = fun;
+    if (!this->cb && !this->map_cb && fun) {
+        this->cb = [fun](const real_block& x) {
+            return fun(x)(0);
+        };
+    }
+    this->reset_workspace();
+    return *this;
+}
+
+optimization& optimization::set_process_pool(const optimization::process_pool& pool)
+{
+    this->cb = pool.function();
+    this->map_cb = optimization::map_function_t();
+    this->batch_cb = pool.batch_function();
+    this->threads = std::max<size_t>(1, pool.size());
+    this->clear_cache();
+    this->reset_workspace();
+    return *this;
+}
+
+void optimization::prepare(optimization::fused_point_t& s) const
+{
+    s.fun = &this->fused_cb;
+    s.value.resize(1 + this->fused_eq + this->fused_ineq, 1);
+    s.eq.resize(this->fused_eq, 1);
+    s.ineq.resize(this->fused_ineq, 1);
+    s.ready = false;
+}
+
 optimization& optimization::set_gradient_function(const optimization::gradient_function_t& cb)
 {
     this->grad_cb = cb;
+    this->reset_workspace();
     return *this;
 }
 
 optimization& optimization::set_equation_gradient_function(const std::vector<optimization::gradient_function_t>& eq_grad)
 {
     this->eq_grad_fun = eq_grad;
+    this->reset_workspace();
     return *this;
 }
 optimization& optimization::set_inequation_gradient_function(const std::vector<optimization::gradient_function_t>& ineq_grad)
 {
     this->ineq_grad_fun = ineq_grad;
+    this->reset_workspace();
     return *this;
 }
 
 const real_block& optimization::search(size_t max_random_iter, size_t max_not_changed, double s, optimization::method m, double eps, size_t max_iter)
 {
-    if (!this->range.empty()) {
+    budget_scope budget(*this);
+    bool exact = (this->solver == optimization::solver_t::LP_SIMPLEX && this->is_linear()) || (this->solver == optimization::solver_t::BRANCH_BOUND && !this->integer_index.empty());
+    if (!this->range.empty() && !exact) {
+        trace_span search_span(this->trace.get(), "search");
         size_t dim = this->range.size();
-        double obj_value, global_obj_value;
         if (this->filter_cb) {
             this->filter_cb(this->point);
         }
-        obj_value = this->cb(this->point);
-        global_obj_value = obj_value;
+        double global_obj_value = this->obj(this->point);
         real_block global_point = this->point;
-        size_t not_changed = 0, global_max_random_iter = 0, reloop_iter = 0;
-        std::vector<std::shared_ptr<random>> rng;
-        random rg(0.0 - eps, fabs(s) + eps);
-        std::vector<range_t> range_bk = this->range;
-        bool gcheck = this->check(global_point, eps), lcheck = false;
-    reloop:
-        for (size_t i = 0; i < dim; ++i) {
-            rng.emplace_back(std::make_shared<random>(this->range[i].first - eps, this->range[i].second + eps));
-        }
-    loop:
-        for (size_t i = 0; i < max_random_iter; ++i) {
-            for (size_t j = 0; j < dim; ++j) {
-                this->point(j, 0) = rng[j]->generate();
+        size_t not_changed = 0;
+        random sampler(0, 1, this->seed, 0), rg(0.0 - eps, fabs(s) + eps, this->seed, 1);
+        bool gcheck = this->check(global_point, eps);
+        real_block samples(dim, max_random_iter);
+        std::vector<real_block> points(max_random_iter);
+        std::vector<double> fvals(max_random_iter);
+        std::vector<char> oks(max_random_iter);
+        for (size_t reloop_iter = 0; reloop_iter <= optimization::max_reloop_iter; ++reloop_iter) {
+            trace_span reloop_span(this->trace.get(), "reloop");
+            if (this->stats && reloop_iter > 0) {
+                std::lock_guard<std::mutex> guard(this->stats->lock);
+                ++this->stats->stats.reloops;
             }
-            this->point = this->solve(m, eps, max_iter);
-            obj_value = this->fval;
-            lcheck = this->ok;
-            bool case1 = !gcheck && lcheck, case2 = lcheck && (global_obj_value - obj_value) >= eps;
-            if ((case1 || case2)) {
-                global_point = this->point;
-                global_obj_value = obj_value;
-                not_changed = 0;
-                gcheck = lcheck;
-                this->history.push_back({ global_obj_value, global_point });
-            } else if (++not_changed > max_not_changed) {
+            std::vector<range_t> range_bk = this->range, sample_range = this->range;
+            for (size_t global_max_random_iter = 0;;) {
+                trace_span round_span(this->trace.get(), "round");
+                if (this->stats) {
+                    std::lock_guard<std::mutex> guard(this->stats->lock);
+                    ++this->stats->stats.rounds;
+                }
+                for (auto& p : sample_range) {
+                    p.first -= eps;
+                    p.second += eps;
+                }
+                sampler.fill(samples, sample_range);
+                for (size_t i = 0; i < max_random_iter; ++i) {
+                    points[i] = samples.col(i);
+                }
                 not_changed = 0;
-                break;
-            }
-        }
+                parallel::ordered_for_each(
+                    max_random_iter, this->threads,
+                    [&](size_t i, size_t) {
+                        oks[i] = this->local_solve(points[i], fvals[i], m, eps, max_iter);
+                    },
+                    [&](size_t i) {
+                        bool lcheck = oks[i], case1 = !gcheck && lcheck, case2 = lcheck && (global_obj_value - fvals[i]) >= eps;
+                        if ((case1 || case2)) {
+                            global_point = points[i];
+                            global_obj_value = fvals[i];
+                            not_changed = 0;
+                            gcheck = lcheck;
+                            this->history.push_back({ global_obj_value, global_point });
+                            this->report_incumbent(global_obj_value, global_point);
+                            if (this->trace) {
+                                this->trace->counter("incumbent", global_obj_value);
+                                this->trace->counter("feasible", gcheck ? 1 : 0);
+                            }
+                        } else if (++not_changed > max_not_changed) {
+                            return false;
+                        }
+                        return !this->stopping();
+                    });
 
-        rng.clear();
-        not_changed = 0;
-        this->point = global_point;
-        this->ok = !this->history.empty();
-        for (size_t i = 0; i < dim; ++i) {
-            range_t& p = range_bk[i];
-            double c = p.second - p.first;
-            if (c >= eps) {
-                double best = this->point(i, 0);
-                if (best > 0.5 * c) {
-                    p.first += (best - p.first) * rg.generate();
-                } else {
-                    p.second -= (p.second - best) * rg.generate();
+                not_changed = 0;
+                this->point = global_point;
+                this->ok = !this->history.empty();
+                for (size_t i = 0; i < dim; ++i) {
+                    range_t& p = range_bk[i];
+                    double c = p.second - p.first;
+                    if (c >= eps) {
+                        double best = this->point(i, 0);
+                        if (best > 0.5 * c) {
+                            p.first += (best - p.first) * rg.generate();
+                        } else {
+                            p.second -= (p.second - best) * rg.generate();
+                        }
+                    } else {
+                        ++not_changed;
+                    }
+                }
+                sample_range = range_bk;
+                if (!((not_changed < dim - 1) && ++global_max_random_iter <= max_not_changed) || this->stopping()) {
+                    break;
                 }
-            } else {
-                ++not_changed;
             }
-            rng.emplace_back(std::make_shared<random>(p.first - eps, p.second + eps));
-        }
-        if ((not_changed < dim - 1) && ++global_max_random_iter <= max_not_changed) {
-            not_changed = 0;
-            goto loop;
-        }
-        if (!this->ok && ++reloop_iter <= optimization::max_reloop_iter) {
-            global_max_random_iter = 0;
-            not_changed = 0;
-            range_bk = this->range;
-            goto reloop;
+            if (this->ok || this->stopping()) {
+                break;
+            }
         }
         return this->point;
     }
@@ -588,89 +1235,717 @@ int optimization::select_nlopt_method(optimization::method m) const
     return method;
 }
 
-const real_block& optimization::nlopt_solve(optimization::method m, double eps, size_t max_iter)
+// What LD_SLSQP or LD_LBFGS saved at the end of the last solve() or resolve(): the
+// LDL' factors of the quasi-Newton matrix with the penalty weights and multipliers, or
+// the limited-memory history, and the active set read off the multipliers. A run
+// records into a copy that replaces the old state when it ends, so a state that
+// copies of the problem share is never written.
+class optimization::solver_state {
+public:
+    solver_state()
+        : state()
+        , active()
+    {
+    }
+    solver_state(const solver_state& other)
+        : state(other.state)
+        , active(other.active)
+    {
+        this->state.data = 0;
+        this->state.size = 0;
+        if (other.state.size > 0) {
+            this->state.data = static_cast<double*>(malloc(sizeof(double) * other.state.size));
+            if (this->state.data) {
+                std::copy(other.state.data, other.state.data + other.state.size, this->state.data);
+                this->state.size = other.state.size;
+            }
+        }
+    }
+    solver_state& operator=(const solver_state&) = delete;
+    virtual ~solver_state()
+    {
+        nlopt_warm_state_clear(&this->state);
+    }
+    nlopt_warm_state state;
+    std::vector<size_t> active;
+};
+
+const std::vector<size_t>& optimization::get_active_set() const
 {
-    size_t dim = this->point.rows();
-    nlopt_algorithm loc_method = (nlopt_algorithm)this->select_nlopt_method(optimization::default_local_method), method = (nlopt_algorithm)this->select_nlopt_method(m);
-    nlopt_opt opt_loc = nlopt_create(loc_method, dim);
-    nlopt_opt opt = nlopt_create(method, dim);
-    nlopt_set_local_optimizer(opt, opt_loc);
-    help_t obj;
-    obj.filter = &this->filter_cb;
-    obj.grad = &this->grad_cb;
-    function_t auto_obj = [&](const real_block& x) {
-        return this->cb(x);
-    };
-    obj.fun = &auto_obj;
-    nlopt_set_min_objective(opt, optimization::instance_fun, &obj);
-    nlopt_set_xtol_rel(opt, eps);
-    nlopt_set_ftol_abs(opt, eps);
+    static const std::vector<size_t> none;
+    return this->warm ? this->warm->active : none;
+}
+
+bool optimization::nlopt_solve(real_block& x, double& fval, optimization::method m, double eps, size_t max_iter) const
+{
+    return this->nlopt_solve(x, fval, this->range, this->filter_cb, m, eps, max_iter);
+}
+
+// An nlopt handle with the objective and every condition registered, together with
+// the help_t records its callbacks receive. A solve that takes it over only resets the
+// bounds, limits and per-call state; the subsidiary optimizer of MLSL and AUGLAG gets
+// its bounds, objective and conditions from nlopt on every run anyway.
+class optimization::nlopt_context {
+public:
+    nlopt_context(const optimization& p, optimization::method m, optimization::method loc, size_t dim, double eps, size_t revision)
+        : opt(0)
+        , opt_loc(0)
+        , method(m)
+        , local_method(loc)
+        , dim(dim)
+        , eps(eps)
+        , revision(revision)
+        , filter()
+        , obj()
+        , fused_eq()
+        , fused_ineq()
+        , eq_help()
+        , ineq_help()
+        , eq_linear_help(p.eq_linear.size())
+        , ineq_linear_help(p.ineq_linear.size())
+        , fused()
+        , lb(dim)
+        , ub(dim)
+    {
+        this->opt_loc = nlopt_create((nlopt_algorithm)p.select_nlopt_method(loc), dim);
+        this->opt = nlopt_create((nlopt_algorithm)p.select_nlopt_method(m), dim);
+        // MMA would solve its dual with the local method; it needs a gradient method
+        // there, so it keeps NLopt's default.
+        if (m != optimization::method::LD_MMA) {
+            nlopt_set_local_optimizer(this->opt, this->opt_loc);
+        }
+        this->obj.filter = &this->filter;
+        this->obj.cache = p.cache.table.get();
+        this->obj.buffer.resize(dim, 1);
+        this->obj.fun = p.map_cb ? p.map_cb : optimization::make_map_function(p.cb, &p.grad_cb, dim);
+        if (p.fused_cb) {
+            p.prepare(this->fused);
+            this->obj.fused = &this->fused;
+            nlopt_set_min_objective(this->opt, optimization::instance_fused_fun, &this->obj);
+        } else {
+            nlopt_set_min_objective(this->opt, optimization::instance_fun, &this->obj);
+            if (p.batch_cb) {
+                this->obj.batch = &p.batch_cb;
+                nlopt_set_prefetch(this->opt, optimization::instance_prefetch, &this->obj);
+            }
+        }
+        nlopt_set_xtol_rel(this->opt, eps);
+        nlopt_set_ftol_abs(this->opt, eps);
+
+        for (size_t i = 0; i < p.eq_fun.size(); ++i) {
+            help_t h = this->make_help(p);
+            h.slot = 1 + this->eq_help.size();
+            h.fun = optimization::make_map_function(p.eq_fun[i], p.eq_grad_fun.size() == p.eq_fun.size() ? &p.eq_grad_fun[i] : 0, dim);
+            this->eq_help.emplace_back(h);
+        }
+        for (size_t i = 0; i < p.map_eq_fun.size(); ++i) {
+            help_t h = this->make_help(p);
+            h.slot = 1 + this->eq_help.size();
+            h.fun = p.map_eq_fun[i];
+            this->eq_help.emplace_back(h);
+        }
+        for (size_t i = 0; i < this->eq_help.size(); ++i) {
+            nlopt_add_equality_constraint(this->opt, instance_eq_fun, &this->eq_help[i], eps);
+        }
+        if (p.fused_eq > 0 && p.fused_cb) {
+            this->fused_eq.filter = &this->filter;
+            this->fused_eq.buffer.resize(dim, 1);
+            this->fused_eq.fused = &this->fused;
+            this->fused_eq.slot = 1;
+            std::vector<double> tol(p.fused_eq, eps);
+            nlopt_add_equality_mconstraint(this->opt, tol.size(), instance_fused_condition_fun, &this->fused_eq, tol.data());
+        }
+        for (size_t i = 0; i < this->eq_linear_help.size(); ++i) {
+            help_t& h = this->eq_linear_help[i];
+            h.filter = &this->filter;
+            h.buffer.resize(dim, 1);
+            h.linear = &p.eq_linear[i];
+            std::vector<double> tol(h.linear->first.rows(), eps);
+            nlopt_add_equality_mconstraint(this->opt, tol.size(), instance_linear_fun, &h, tol.data());
+        }
+
+        for (size_t i = 0; i < p.ineq_fun.size(); ++i) {
+            help_t h = this->make_help(p);
+            h.slot = 1 + this->eq_help.size() + this->ineq_help.size();
+            h.fun = optimization::make_map_function(p.ineq_fun[i], p.ineq_grad_fun.size() == p.ineq_fun.size() ? &p.ineq_grad_fun[i] : 0, dim);
+            this->ineq_help.emplace_back(h);
+        }
+        for (size_t i = 0; i < p.map_ineq_fun.size(); ++i) {
+            help_t h = this->make_help(p);
+            h.slot = 1 + this->eq_help.size() + this->ineq_help.size();
+            h.fun = p.map_ineq_fun[i];
+            this->ineq_help.emplace_back(h);
+        }
+        for (size_t i = 0; i < this->ineq_help.size(); ++i) {
+            nlopt_add_inequality_constraint(this->opt, instance_ineq_fun, &this->ineq_help[i], eps);
+        }
+        for (size_t i = 0; i < this->ineq_linear_help.size(); ++i) {
+            help_t& h = this->ineq_linear_help[i];
+            h.filter = &this->filter;
+            h.buffer.resize(dim, 1);
+            h.linear = &p.ineq_linear[i];
+            std::vector<double> tol(h.linear->first.rows(), eps);
+            nlopt_add_inequality_mconstraint(this->opt, tol.size(), instance_linear_fun, &h, tol.data());
+        }
+        if (p.fused_ineq > 0 && p.fused_cb) {
+            this->fused_ineq.filter = &this->filter;
+            this->fused_ineq.buffer.resize(dim, 1);
+            this->fused_ineq.fused = &this->fused;
+            this->fused_ineq.slot = 1 + p.fused_eq;
+            std::vector<double> tol(p.fused_ineq, eps);
+            nlopt_add_inequality_mconstraint(this->opt, tol.size(), instance_fused_condition_fun, &this->fused_ineq, tol.data());
+        }
+    }
+    virtual ~nlopt_context()
+    {
+        nlopt_destroy(this->opt);
+        nlopt_destroy(this->opt_loc);
+    }
+    // Zeroes the counters of the records that run user callbacks and switches their
+    // timers; the linear and fused condition records only read what others computed.
+    void start(bool timed)
+    {
+        this->obj.calls = this->fused.calls = 0;
+        this->obj.seconds = this->fused.seconds = 0;
+        this->obj.timed = this->fused.timed = timed;
+        for (auto* v : { &this->eq_help, &this->ineq_help }) {
+            for (auto& h : *v) {
+                h.calls = 0;
+                h.seconds = 0;
+                h.timed = timed;
+            }
+        }
+    }
+    // Adds the counters of the solve that just ended; returns its callback seconds.
+    double collect(optimization::solve_stats& stats)
+    {
+        stats.objective_calls += this->obj.calls;
+        stats.fused_calls += this->fused.calls;
+        double seconds = this->obj.seconds + this->fused.seconds;
+        size_t m = this->eq_help.size() + this->ineq_help.size();
+        if (stats.condition_calls.size() < m) {
+            stats.condition_calls.resize(m, 0);
+        }
+        for (size_t i = 0; i < this->eq_help.size(); ++i) {
+            stats.condition_calls[i] += this->eq_help[i].calls;
+            seconds += this->eq_help[i].seconds;
+        }
+        for (size_t i = 0; i < this->ineq_help.size(); ++i) {
+            stats.condition_calls[this->eq_help.size() + i] += this->ineq_help[i].calls;
+            seconds += this->ineq_help[i].seconds;
+        }
+        return seconds;
+    }
+    help_t make_help(const optimization& p)
+    {
+        help_t h;
+        h.filter = &this->filter;
+        h.buffer.resize(this->dim, 1);
+        h.cache = p.cache.table.get();
+        return h;
+    }
+    nlopt_opt opt, opt_loc;
+    optimization::method method, local_method;
+    size_t dim;
+    double eps;
+    size_t revision;
+    filter_function_t filter;
+    help_t obj, fused_eq, fused_ineq;
+    std::vector<help_t> eq_help, ineq_help, eq_linear_help, ineq_linear_help;
+    fused_point_t fused;
+    std::vector<double> lb, ub;
+};
+
+// Idle contexts of one problem. Every setter that changes what a context registers
+// bumps the revision, and contexts of an older revision are dropped instead of reused.
+class optimization::nlopt_workspace {
+public:
+    nlopt_workspace()
+        : lock()
+        , idle()
+        , revision(0)
+    {
+    }
+    virtual ~nlopt_workspace() = default;
+    std::mutex lock;
+    std::vector<std::shared_ptr<optimization::nlopt_context>> idle;
+    size_t revision;
+};
+
+optimization::workspace_t::workspace_t()
+    : pool(std::make_shared<optimization::nlopt_workspace>())
+{
+}
+
+optimization::workspace_t::workspace_t(const optimization::workspace_t&)
+    : workspace_t()
+{
+}
+
+optimization::workspace_t& optimization::workspace_t::operator=(const optimization::workspace_t&)
+{
+    this->pool = std::make_shared<optimization::nlopt_workspace>();
+    return *this;
+}
+
+optimization::cache_t::cache_t()
+    : table()
+    , capacity(0)
+{
+}
+
+optimization::cache_t::cache_t(const optimization::cache_t& other)
+    : table()
+    , capacity(other.capacity)
+{
+    if (other.table) {
+        this->table = std::make_shared<evaluation_cache>(other.table->dimension(), other.capacity);
+    }
+}
+
+optimization::cache_t& optimization::cache_t::operator=(const optimization::cache_t& other)
+{
+    this->table.reset();
+    this->capacity = other.capacity;
+    if (other.table) {
+        this->table = std::make_shared<evaluation_cache>(other.table->dimension(), other.capacity);
+    }
+    return *this;
+}
+
+void optimization::reset_workspace()
+{
+    optimization::nlopt_workspace& ws = *this->workspace.pool;
+    std::lock_guard<std::mutex> guard(ws.lock);
+    ++ws.revision;
+    ws.idle.clear();
+}
+
+// NLopt keeps one generator per thread and seeds it from the clock unless told
+// otherwise. Each run seeds it from the problem seed and its start point, which the
+// seeded sampler of search() fixes per start, so stochastic methods repeat exactly
+// whatever thread a start lands on.
+static unsigned long nlopt_seed(unsigned long seed, const real_block& x)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (Eigen::Index i = 0; i < x.size(); ++i) {
+        uint64_t bits;
+        double v = x(i);
+        std::memcpy(&bits, &v, sizeof(bits));
+        h = (h ^ bits) * 1099511628211ULL;
+    }
+    return static_cast<unsigned long>(random(0, 4294967296.0, seed, h).generate());
+}
+
+bool optimization::nlopt_solve(real_block& x, double& fval, const std::vector<range_t>& range, const filter_function_t& filter_fun, optimization::method m, double eps, size_t max_iter) const
+{
+    size_t dim = x.rows();
+    double time_left = 0;
+    if (this->deadline != std::chrono::steady_clock::time_point::max()) {
+        time_left = std::chrono::duration<double>(this->deadline - std::chrono::steady_clock::now()).count();
+        if (time_left <= 0) {
+            return false;
+        }
+    }
+    if (this->cancel.is_cancelled()) {
+        return false;
+    }
+    optimization::method loc = optimization::default_local_method;
+    optimization::nlopt_workspace& ws = *this->workspace.pool;
+    std::shared_ptr<nlopt_context> context;
+    size_t revision;
+    {
+        std::lock_guard<std::mutex> guard(ws.lock);
+        revision = ws.revision;
+        for (auto i = ws.idle.begin(); i != ws.idle.end(); ++i) {
+            if ((*i)->method == m && (*i)->local_method == loc && (*i)->dim == dim && (*i)->eps == eps) {
+                context = *i;
+                ws.idle.erase(i);
+                break;
+            }
+        }
+    }
+    if (!context) {
+        context = std::make_shared<nlopt_context>(*this, m, loc, dim, eps, revision);
+    }
+    nlopt_context& c = *context;
+    nlopt_opt opt = c.opt;
+    c.filter = filter_fun;
+    c.obj.batch_next = 0;
+    c.obj.batch_point.resize(dim, 0);
+    if (this->fused_cb) {
+        this->prepare(c.fused);
+    }
     nlopt_set_maxeval(opt, max_iter);
+    nlopt_set_maxtime(opt, time_left);
     nlopt_set_population(opt, optimization::default_population);
-    double lb[dim], ub[dim];
-    if (!this->range.empty()) {
+    nlopt_set_initial_step(opt, static_cast<size_t>(this->warm_step.size()) == dim ? this->warm_step.data() : 0);
+    nlopt_set_warm_state(opt, this->recording ? &this->recording->state : 0);
+    if (!range.empty()) {
         for (size_t i = 0; i < dim; ++i) {
-            range_t& cur_range = this->range[i];
-            lb[i] = cur_range.first;
-            ub[i] = cur_range.second;
+            const range_t& cur_range = range[i];
+            c.lb[i] = cur_range.first;
+            c.ub[i] = cur_range.second;
         }
-        nlopt_set_lower_bounds(opt, lb);
-        nlopt_set_upper_bounds(opt, ub);
+        nlopt_set_lower_bounds(opt, c.lb.data());
+        nlopt_set_upper_bounds(opt, c.ub.data());
+    } else {
+        nlopt_set_lower_bounds1(opt, -HUGE_VAL);
+        nlopt_set_upper_bounds1(opt, HUGE_VAL);
     }
 
-    std::vector<help_t> eq_help, ineq_help;
-    for (size_t i = 0; i < this->eq_fun.size(); ++i) {
-        help_t h;
-        h.filter = &this->filter_cb;
-        h.fun = &this->eq_fun[i];
-        if (this->eq_grad_fun.size() == this->eq_fun.size()) {
-            h.grad = &this->eq_grad_fun[i];
+    double ret[dim];
+    for (size_t i = 0; i < dim; ++i) {
+        ret[i] = x(i, 0);
+    }
+
+    stats_recorder* recorder = this->stats.get();
+    c.start(recorder != 0);
+    c.obj.trace = this->trace.get();
+    c.obj.cancel = &this->cancel;
+    c.obj.handle = opt;
+    auto begin = std::chrono::steady_clock::now();
+    nlopt_result result;
+    {
+        trace_span span(c.obj.trace, "local solve");
+        nlopt_srand(nlopt_seed(this->seed, x));
+        result = nlopt_optimize(opt, ret, &fval);
+    }
+    if (this->recording) {
+        // SLSQP saves the multipliers last, the equality rows first; an inequation row
+        // is active when its multiplier is positive.
+        const nlopt_warm_state& w = this->recording->state;
+        std::vector<size_t>& active = this->recording->active;
+        active.clear();
+        if (w.algorithm == NLOPT_LD_SLSQP && w.size >= w.m) {
+            size_t eq = c.eq_help.size() + (this->fused_cb ? this->fused_eq : 0);
+            for (const auto& i : this->eq_linear) {
+                eq += i.first.rows();
+            }
+            const double* multiplier = w.data + w.size - w.m;
+            for (size_t i = eq; i < w.m; ++i) {
+                if (multiplier[i] > 0) {
+                    active.push_back(i - eq);
+                }
+            }
         }
-        eq_help.emplace_back(h);
     }
-    for (size_t i = 0; i < eq_help.size(); ++i) {
-        nlopt_add_equality_constraint(opt, instance_eq_fun, &eq_help[i], eps);
+    if (recorder) {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::lock_guard<std::mutex> guard(recorder->lock);
+        optimization::solve_stats& st = recorder->stats;
+        double callback = c.collect(st);
+        st.result = result;
+        ++st.solves;
+        st.failed += result < 0 ? 1 : 0;
+        st.evaluations += nlopt_get_numevals(opt);
+        st.callback_seconds += callback;
+        st.solver_seconds += std::max(0.0, elapsed - callback);
     }
-
-    for (size_t i = 0; i < this->ineq_fun.size(); ++i) {
-        help_t h;
-        h.filter = &this->filter_cb;
-        h.fun = &this->ineq_fun[i];
-        if (this->ineq_grad_fun.size() == this->ineq_fun.size()) {
-            h.grad = &this->ineq_grad_fun[i];
+    // A stop forced by cancellation still leaves the best point found so far in ret.
+    bool ok = false;
+    if (result >= 0 || (result == NLOPT_FORCED_STOP && std::isfinite(fval))) {
+        ok = true;
+        for (size_t i = 0; i < dim; ++i) {
+            x(i, 0) = ret[i];
         }
-        ineq_help.emplace_back(h);
     }
-    for (size_t i = 0; i < ineq_help.size(); ++i) {
-        nlopt_add_inequality_constraint(opt, instance_ineq_fun, &ineq_help[i], eps);
+    if (filter_fun) {
+        filter_fun(x);
+    }
+    ok = ok && this->check(x, eps, this->fused_cb ? &c.fused : 0);
+    std::lock_guard<std::mutex> guard(ws.lock);
+    if (c.revision == ws.revision && ws.idle.size() < optimization::max_idle_context) {
+        ws.idle.push_back(context);
     }
+    return ok;
+}
 
-    double ret[dim];
-    for (size_t i = 0; i < dim; ++i) {
-        ret[i] = this->point(i, 0);
+bool optimization::is_linear() const
+{
+    return this->linear_obj.size() > 0 && (!this->filter_cb || !this->integer_index.empty()) && this->eq_fun.empty() && this->ineq_fun.empty() && this->map_eq_fun.empty() && this->map_ineq_fun.empty() && !this->fused_cb;
+}
+
+// Counts an LP or MILP solve in the stats under the nlopt_result it corresponds to;
+// a stop is a forced stop when the cancel token was raised and a time limit otherwise.
+static void record_linear(stats_recorder* recorder, optimization::simplex::status_t status, bool cancelled)
+{
+    if (!recorder) {
+        return;
     }
+    nlopt_result result = NLOPT_SUCCESS;
+    switch (status) {
+    case optimization::simplex::status_t::OPTIMAL:
+        break;
+    case optimization::simplex::status_t::ITERATION_LIMIT:
+        result = NLOPT_MAXEVAL_REACHED;
+        break;
+    case optimization::simplex::status_t::STOPPED:
+        result = cancelled ? NLOPT_FORCED_STOP : NLOPT_MAXTIME_REACHED;
+        break;
+    default:
+        result = NLOPT_FAILURE;
+        break;
+    }
+    std::lock_guard<std::mutex> guard(recorder->lock);
+    recorder->stats.result = result;
+    ++recorder->stats.solves;
+    recorder->stats.failed += result < 0 ? 1 : 0;
+}
+
+// The time budget and cancel token stop the pivots through the simplex stop function;
+// a stopped run still returns its point when that point passes check().
+bool optimization::simplex_solve(real_block& x, double& fval, double eps, size_t max_iter)
+{
+    optimization::simplex lp(this->linear_obj, this->range);
+    for (const auto& i : this->eq_linear) {
+        lp.add_equation(i.first, i.second);
+    }
+    for (const auto& i : this->ineq_linear) {
+        lp.add_inequation(i.first, i.second);
+    }
+    lp.set_basis(this->lp_basis);
+    lp.set_stop_function([this]() { return this->stopping(); });
+    optimization::simplex::status_t status = lp.solve();
+    record_linear(this->stats.get(), status, this->cancel.is_cancelled());
+    if (status != optimization::simplex::status_t::OPTIMAL && status != optimization::simplex::status_t::STOPPED) {
+        return false;
+    }
+    this->lp_basis = lp.get_basis();
+    x = lp.solution();
+    fval = lp.obj();
+    return this->check(x, eps);
+}
+
+bool optimization::milp_solve(real_block& x, double& fval, double eps, size_t max_iter)
+{
+    optimization::milp bb(this->linear_obj, this->range, this->integer_index);
+    for (const auto& i : this->eq_linear) {
+        bb.add_equation(i.first, i.second);
+    }
+    for (const auto& i : this->ineq_linear) {
+        bb.add_inequation(i.first, i.second);
+    }
+    // max_iter caps the nodes. Each new incumbent goes to report_incumbent() as it is
+    // found, and the stats follow the node count, bound and gap as the tree grows.
+    bb.set_node_limit(max_iter);
+    bb.set_stop_function([this]() { return this->stopping(); });
+    double reported = std::numeric_limits<double>::infinity();
+    bb.set_progress_function([&](size_t nodes, double incumbent, double bound) {
+        if (incumbent < reported) {
+            reported = incumbent;
+            this->report_incumbent(incumbent, bb.solution());
+        }
+        if (this->stats) {
+            std::lock_guard<std::mutex> guard(this->stats->lock);
+            this->stats->stats.nodes = nodes;
+            this->stats->stats.bound = bound;
+            this->stats->stats.gap = bb.gap();
+        }
+    });
+    // A run stopped by the time budget or the cancel token keeps its incumbent.
+    optimization::simplex::status_t status = bb.solve();
+    record_linear(this->stats.get(), status, this->cancel.is_cancelled());
+    bool solved = status != optimization::simplex::status_t::INFEASIBLE && std::isfinite(bb.obj());
+    this->gap = bb.gap();
+    if (!solved) {
+        return false;
+    }
+    x = bb.solution();
+    fval = bb.obj();
+    return this->check(x, eps);
+}
 
-    if (nlopt_optimize(opt, ret, &this->fval) >= 0) {
-        this->ok = true;
+// Nonlinear branch and bound over the columns in integer_index. Every node solves the
+// continuous relaxation on its own bounds with nlopt_solve (no rounding filter, so the
+// local method sees a smooth problem), warm started from the parent's relaxed point,
+// and branches on the most fractional integer column. Nodes run on a work-stealing
+// pool; the incumbent value is shared atomically so every worker prunes against the
+// best point found so far. The relaxation value is a true lower bound only when the
+// relaxation is convex; otherwise the search is an exhaustive but heuristic dive.
+// Nodes beyond max_branch_node are left open, and the lowest of their bounds sets the
+// gap reported by get_gap().
+bool optimization::minlp_solve(real_block& x, double& fval, optimization::method m, double eps, size_t max_iter)
+{
+    class node_t {
+    public:
+        std::vector<range_t> range;
+        real_block start;
+        double bound;
+    };
+    const double inf = std::numeric_limits<double>::infinity();
+    size_t dim = x.rows();
+    this->gap = inf;
+    node_t root;
+    root.range = this->range;
+    if (root.range.size() != dim) {
+        root.range.assign(dim, { -inf, inf });
+    }
+    for (const auto& j : this->integer_index) {
+        range_t& b = root.range[j];
+        b = { std::ceil(b.first - eps), std::floor(b.second + eps) };
+        if (b.first > b.second) {
+            return false;
+        }
+    }
+    root.start = x;
+    root.bound = -inf;
+
+    std::atomic<double> incumbent(inf);
+    std::atomic<double> open(inf);
+    std::atomic<size_t> nodes(0);
+    std::mutex lock;
+    real_block best;
+    filter_function_t relaxed;
+    auto cutoff = [&]() {
+        double f = incumbent.load();
+        return f - eps * std::max(1.0, fabs(f));
+    };
+    parallel::work_stealing(std::vector<node_t>{ root }, this->threads, [&](node_t& cur, size_t, std::vector<node_t>& children) {
+        if (cur.bound >= cutoff()) {
+            return;
+        }
+        if (nodes.fetch_add(1) >= optimization::max_branch_node) {
+            double low = open.load();
+            while (cur.bound < low && !open.compare_exchange_weak(low, cur.bound)) {
+            }
+            return;
+        }
+        real_block p = cur.start;
         for (size_t i = 0; i < dim; ++i) {
-            this->point(i, 0) = ret[i];
+            p(i, 0) = std::min(std::max(p(i, 0), cur.range[i].first), cur.range[i].second);
         }
+        double f;
+        if (!this->nlopt_solve(p, f, cur.range, relaxed, m, eps, max_iter) || f >= cutoff()) {
+            return;
+        }
+        size_t j = dim;
+        double worst = eps;
+        for (const auto& i : this->integer_index) {
+            double d = fabs(p(i, 0) - std::round(p(i, 0)));
+            if (d > worst) {
+                worst = d;
+                j = i;
+            }
+        }
+        if (j == dim) {
+            for (const auto& i : this->integer_index) {
+                p(i, 0) = std::round(p(i, 0)) + 0.0;
+            }
+            f = this->obj(p);
+            if (this->check(p, eps)) {
+                std::lock_guard<std::mutex> guard(lock);
+                if (f < incumbent.load()) {
+                    best = p;
+                    incumbent.store(f);
+                }
+            }
+            return;
+        }
+        double v = p(j, 0);
+        node_t down, up;
+        down.range = cur.range;
+        down.range[j].second = std::floor(v);
+        up.range = std::move(cur.range);
+        up.range[j].first = std::ceil(v);
+        down.start = up.start = p;
+        down.bound = up.bound = f;
+        if (v - std::floor(v) > 0.5) {
+            children.emplace_back(std::move(down));
+            children.emplace_back(std::move(up));
+        } else {
+            children.emplace_back(std::move(up));
+            children.emplace_back(std::move(down));
+        }
+    });
+    if (!std::isfinite(incumbent.load())) {
+        return false;
     }
-    if (this->filter_cb) {
-        this->filter_cb(this->point);
+    x = best;
+    fval = incumbent.load();
+    if (open.load() < cutoff()) {
+        this->gap = std::isfinite(open.load()) ? (fval - open.load()) / std::max(1.0, fabs(fval)) : inf;
+    } else {
+        this->gap = 0;
     }
-    this->ok = this->ok && this->check(this->point, eps);
-    nlopt_destroy(opt);
-    nlopt_destroy(opt_loc);
-    return this->point;
+    return true;
 }
 
-const real_block& optimization::solve(optimization::method m, double eps, size_t max_iter)
+bool optimization::local_solve(real_block& x, double& fval, optimization::method m, double eps, size_t max_iter) const
 {
     if (this->solver == optimization::solver_t::NLOPT) {
-        return this->nlopt_solve(m, eps, max_iter);
+        return this->nlopt_solve(x, fval, m, eps, max_iter);
+    }
+    return this->nlopt_solve(x, fval, m, eps, max_iter);
+}
+
+const real_block& optimization::solve(optimization::method m, double eps, size_t max_iter)
+{
+    budget_scope budget(*this);
+    trace_span span(this->trace.get(), "solve");
+    if (this->solver == optimization::solver_t::LP_SIMPLEX && this->is_linear()) {
+        if (this->integer_index.empty()) {
+            this->ok = this->simplex_solve(this->point, this->fval, eps, max_iter);
+        } else {
+            this->ok = this->milp_solve(this->point, this->fval, eps, max_iter);
+        }
+        if (this->ok) {
+            this->history.push_back({ this->fval, this->point });
+            if (this->integer_index.empty()) {
+                this->report_incumbent(this->fval, this->point);
+            }
+        }
+        return this->point;
+    }
+    if (this->solver == optimization::solver_t::BRANCH_BOUND && !this->integer_index.empty()) {
+        this->ok = this->minlp_solve(this->point, this->fval, m, eps, max_iter);
+        if (this->ok) {
+            this->history.push_back({ this->fval, this->point });
+            this->report_incumbent(this->fval, this->point);
+        }
+        return this->point;
+    }
+    std::shared_ptr<solver_state> next = std::make_shared<solver_state>();
+    this->recording = next.get();
+    this->ok = this->local_solve(this->point, this->fval, m, eps, max_iter);
+    this->recording = 0;
+    this->warm = next;
+    if (this->ok) {
+        this->report_incumbent(this->fval, this->point);
+    }
+    return this->point;
+}
+
+// The warm run starts at the last solution and seeds SLSQP, LBFGS and MMA with a copy
+// of the state the last run saved. The initial step is warm_start_step times the width of
+// each range (or of max(1, |x|) where it is unbounded), so the derivative-free methods
+// search near the solution instead of across the whole box.
+const real_block& optimization::resolve(optimization::method m, double eps, size_t max_iter)
+{
+    budget_scope budget(*this);
+    bool exact = (this->solver == optimization::solver_t::LP_SIMPLEX && this->is_linear()) || (this->solver == optimization::solver_t::BRANCH_BOUND && !this->integer_index.empty());
+    if (exact) {
+        return this->solve(m, eps, max_iter);
     }
-    return this->nlopt_solve(m, eps, max_iter);
+    size_t dim = this->point.rows();
+    real_block start = this->point;
+    this->warm_step.resize(dim, 1);
+    for (size_t i = 0; i < dim; ++i) {
+        double width = this->range.empty() ? HUGE_VAL : this->range[i].second - this->range[i].first;
+        this->warm_step(i) = optimization::warm_start_step * (std::isfinite(width) && width > 0 ? width : std::max(1.0, fabs(start(i))));
+    }
+    std::shared_ptr<solver_state> next = this->warm ? std::make_shared<solver_state>(*this->warm) : std::make_shared<solver_state>();
+    this->recording = next.get();
+    this->ok = this->local_solve(this->point, this->fval, m, eps, max_iter);
+    this->recording = 0;
+    this->warm = next;
+    this->warm_step.resize(0, 1);
+    if (!this->ok) {
+        this->point = start;
+        return this->solve(m, eps, max_iter);
+    }
+    this->report_incumbent(this->fval, this->point);
+    return this->point;
 }
 
 const optimization::history_t& optimization::get_history() const
@@ -681,10 +1956,14 @@ const optimization::history_t& optimization::get_history() const
 optimization& optimization::set_enable_integer_filter()
 {
     double c = 0.4999;
+    this->integer_index.clear();
     for (auto& i : this->range) {
         i.first -= c;
         i.second += c;
     }
+    for (size_t i = 0; i < static_cast<size_t>(this->point.rows()); ++i) {
+        this->integer_index.push_back(i);
+    }
 
     this->filter_cb = [&](real_block& x) {
         size_t m = x.rows();
@@ -697,6 +1976,10 @@ optimization& optimization::set_enable_integer_filter()
 optimization& optimization::set_enable_binary_filter()
 {
     double c = 0.4999;
+    this->integer_index.clear();
+    for (size_t i = 0; i < static_cast<size_t>(this->point.rows()); ++i) {
+        this->integer_index.push_back(i);
+    }
     if (this->range.empty()) {
         for (size_t i = 0; i < this->point.rows(); ++i) {
             this->range.push_back({ 0.0 - c, 1.0 + c });
@@ -720,12 +2003,15 @@ optimization& optimization::set_enable_binary_filter()
 optimization& optimization::set_enable_integer_filter(const std::vector<size_t>& v)
 {
     double c = 0.4999;
-    for (auto& i : this->range) {
-        i.first -= c;
-        i.second += c;
+    this->integer_index = v;
+    for (const auto& i : v) {
+        if (i < this->range.size()) {
+            this->range[i].first -= c;
+            this->range[i].second += c;
+        }
     }
 
-    this->filter_cb = [&](real_block& x) {
+    this->filter_cb = [v](real_block& x) {
         for (const auto& i : v) {
             x(i, 0) = round(x(i, 0));
         }
@@ -736,128 +2022,22 @@ optimization& optimization::set_enable_integer_filter(const std::vector<size_t>&
 optimization& optimization::set_enable_binary_filter(const std::vector<size_t>& v)
 {
     double c = 0.4999;
+    this->integer_index = v;
     if (this->range.empty()) {
-        for (size_t i = 0; i < this->point.rows(); ++i) {
-            this->range.push_back({ 0.0 - c, 1.0 + c });
-        }
-    } else {
-        for (auto& i : this->range) {
-            i.first -= c;
-            i.second += c;
+        this->range.assign(this->point.rows(), { 0.0, 1.0 });
+    }
+    for (const auto& i : v) {
+        if (i < this->range.size()) {
+            this->range[i].first -= c;
+            this->range[i].second += c;
         }
     }
 
-    this->filter_cb = [&](real_block& x) {
+    this->filter_cb = [v](real_block& x) {
         for (const auto& i : v) {
             x(i, 0) = round(x(i, 0));
         }
     };
     return *this;
 }
-
-optimization::assignment::assignment(const anyprog::real_block& c, double inf)
-    : bk(c)
-    , data(c)
-    , max_value(inf)
-    , sum(0)
-    , path()
-{
-    double best_value = this->max_value;
-    std::vector<std::pair<size_t, size_t>> best_path;
-    for (size_t i = 0; i < this->bk.rows(); ++i) {
-        this->find(i);
-        if (this->sum < best_value) {
-            best_value = this->sum;
-            best_path = this->path;
-        }
-        this->sum = 0;
-        this->data = this->bk;
-        this->path.clear();
-    }
-    this->path = best_path;
-    this->sum = best_value;
-}
-
-void optimization::assignment::find(size_t i)
-{
-    size_t dim = this->data.rows();
-    if (this->path.size() < dim) {
-        Eigen::MatrixXd::Index min_index;
-        this->data.row(i).minCoeff(&min_index);
-        this->sum += this->bk(i, min_index);
-        this->path.push_back({ i, min_index });
-        size_t next = (i + 1) % dim;
-        for (size_t j = 0; j < dim; ++j) {
-            this->data(j, min_index) = this->max_value;
-        }
-        this->find(next);
-    }
-}
-
-const std::vector<std::pair<size_t, size_t>>& optimization::assignment::solve() const
-{
-    return this->path;
-}
-double optimization::assignment::obj() const
-{
-    return this->sum;
-}
-
-optimization::tsp::tsp(const real_block& c, size_t start, double inf)
-    : start(start)
-    , bk(c)
-    , data(c)
-    , max_value(inf)
-    , sum(0)
-    , path()
-{
-    for (size_t i = 0; i < this->data.rows(); ++i) {
-        this->data(i, i) = this->max_value;
-    }
-    this->find(this->start);
-}
-
-void optimization::tsp::find(size_t i)
-{
-    size_t dim = this->data.rows();
-    if (this->path.size() < dim) {
-        this->path.push_back(i);
-        Eigen::MatrixXd::Index min_index;
-        this->data.row(i).minCoeff(&min_index);
-        this->sum += this->bk(i, min_index);
-        for (size_t j = 0; j < dim; ++j) {
-            if (this->path.end() != std::find(this->path.begin(), this->path.end(), j)) {
-                this->data(min_index, j) = this->max_value;
-            }
-        }
-        this->find(min_index);
-    } else {
-        this->path.push_back(this->start);
-    }
-}
-
-const std::vector<size_t>& optimization::tsp::solve() const
-{
-    return this->path;
-}
-double optimization::tsp::obj() const
-{
-    return this->sum;
-}
-
-real_block optimization::tsp::distance(const std::vector<optimization::tsp::point2d_t>& gps, const optimization::tsp::point2d_distance_function_t& f, double inf)
-{
-    size_t dim = gps.size();
-    anyprog::real_block dis(dim, dim);
-    for (size_t i = 0; i < dim; ++i) {
-        for (size_t j = 0; j < dim; ++j) {
-            if (i == j) {
-                dis(i, j) = inf;
-            } else {
-                dis(i, j) = f(gps[i], gps[j]);
-            }
-        }
-    }
-    return dis;
-}
 }
@@ -0,0 +1,166 @@
+#ifndef ANYPROG_PARALLEL_HPP
+#define ANYPROG_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace anyprog {
+namespace parallel {
+
+    inline size_t thread_number(size_t n)
+    {
+        if (n == 0) {
+            n = std::thread::hardware_concurrency();
+        }
+        return n == 0 ? 1 : n;
+    }
+
+    // Runs work(i, worker) for every i in [0, n) on up to `threads` threads while the
+    // calling thread hands finished indices to reduce(i) strictly in index order.
+    // Once reduce returns false no further index is started, so the reduction sees
+    // exactly the sequence a single thread would, whatever the thread count.
+    template <typename W, typename R>
+    void ordered_for_each(size_t n, size_t threads, const W& work, const R& reduce)
+    {
+        size_t pool_size = std::min(thread_number(threads), n);
+        if (pool_size <= 1) {
+            for (size_t i = 0; i < n; ++i) {
+                work(i, 0);
+                if (!reduce(i)) {
+                    break;
+                }
+            }
+            return;
+        }
+        std::atomic<size_t> next(0), limit(n);
+        std::unique_ptr<std::atomic<bool>[]> ready(new std::atomic<bool>[n]);
+        for (size_t i = 0; i < n; ++i) {
+            ready[i].store(false, std::memory_order_relaxed);
+        }
+        auto claim = [&](size_t worker) {
+            size_t i = next.fetch_add(1);
+            if (i >= limit.load()) {
+                return false;
+            }
+            work(i, worker);
+            ready[i].store(true, std::memory_order_release);
+            return true;
+        };
+        std::vector<std::thread> pool;
+        for (size_t w = 1; w < pool_size; ++w) {
+            pool.emplace_back([&, w]() {
+                while (claim(w)) {
+                }
+            });
+        }
+        for (size_t reduced = 0; reduced < limit.load();) {
+            if (ready[reduced].load(std::memory_order_acquire)) {
+                if (!reduce(reduced)) {
+                    limit.store(reduced + 1);
+                }
+                ++reduced;
+            } else if (!claim(0)) {
+                std::this_thread::yield();
+            }
+        }
+        for (auto& t : pool) {
+            t.join();
+        }
+    }
+
+    // Splits [0, n) into one contiguous block per thread and runs work(begin, end) on
+    // each block, the calling thread taking the first one.
+    template <typename W>
+    void for_each_block(size_t n, size_t threads, const W& work)
+    {
+        size_t pool_size = std::min(thread_number(threads), n);
+        if (pool_size <= 1) {
+            work(0, n);
+            return;
+        }
+        size_t step = (n + pool_size - 1) / pool_size;
+        std::vector<std::thread> pool;
+        for (size_t begin = step; begin < n; begin += step) {
+            pool.emplace_back(work, begin, std::min(n, begin + step));
+        }
+        work(0, step);
+        for (auto& t : pool) {
+            t.join();
+        }
+    }
+
+    // Processes a tree of tasks on up to `threads` threads. work(task, worker, children)
+    // appends any subtasks to children. They go on the back of that worker's own deque
+    // and are popped from there, so each worker runs depth first and takes the last
+    // appended child next. An idle worker steals from the front of another worker's
+    // deque, where the oldest and shallowest tasks sit. Returns after every task,
+    // including the roots, has been processed.
+    template <typename T, typename W>
+    void work_stealing(std::vector<T> roots, size_t threads, const W& work)
+    {
+        class queue_t {
+        public:
+            std::mutex lock;
+            std::deque<T> tasks;
+        };
+        size_t pool_size = thread_number(threads);
+        std::unique_ptr<queue_t[]> queue(new queue_t[pool_size]);
+        std::atomic<size_t> pending(roots.size());
+        for (size_t i = 0; i < roots.size(); ++i) {
+            queue[i % pool_size].tasks.push_back(std::move(roots[i]));
+        }
+        auto take = [&](size_t w, T& task) {
+            for (size_t k = 0; k < pool_size; ++k) {
+                queue_t& q = queue[(w + k) % pool_size];
+                std::lock_guard<std::mutex> guard(q.lock);
+                if (!q.tasks.empty()) {
+                    if (k == 0) {
+                        task = std::move(q.tasks.back());
+                        q.tasks.pop_back();
+                    } else {
+                        task = std::move(q.tasks.front());
+                        q.tasks.pop_front();
+                    }
+                    return true;
+                }
+            }
+            return false;
+        };
+        auto run = [&](size_t w) {
+            T task;
+            std::vector<T> children;
+            while (pending.load() > 0) {
+                if (!take(w, task)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                children.clear();
+                work(task, w, children);
+                if (!children.empty()) {
+                    pending.fetch_add(children.size());
+                    std::lock_guard<std::mutex> guard(queue[w].lock);
+                    for (auto& c : children) {
+                        queue[w].tasks.push_back(std::move(c));
+                    }
+                }
+                pending.fetch_sub(1);
+            }
+        };
+        std::vector<std::thread> pool;
+        for (size_t w = 1; w < pool_size; ++w) {
+            pool.emplace_back(run, w);
+        }
+        run(0);
+        for (auto& t : pool) {
+            t.join();
+        }
+    }
+}
+}
+
+#endif
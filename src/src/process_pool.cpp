@@ -0,0 +1,423 @@
+#include "optimization.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace anyprog {
+
+size_t optimization::process_pool::max_restarts = 16;
+double optimization::process_pool::timeout = 0;
+double optimization::process_pool::exit_timeout = 1;
+
+static const size_t process_pool_npos = static_cast<size_t>(-1);
+
+static bool process_pool_write(int fd, const void* data, size_t size)
+{
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Reads exactly `size` bytes; with a positive timeout it gives up once that many
+// seconds pass without the data being complete.
+static bool process_pool_read(int fd, void* data, size_t size, double timeout)
+{
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        if (timeout > 0) {
+            pollfd q = { fd, POLLIN, 0 };
+            int r = poll(&q, 1, static_cast<int>(std::ceil(timeout * 1000)));
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            if (r <= 0) {
+                return false;
+            }
+        }
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Parent-side descriptors of every pool in the process: control sockets and the
+// pool ends of worker sockets. A forked helper closes them all, so no process but
+// the pool holds the far end of another pool's worker. The lock is held across
+// every fork and every change, which keeps the list whole in the child.
+static std::mutex process_pool_fd_lock;
+static std::vector<int> process_pool_fd;
+
+static void process_pool_forget(int fd)
+{
+    std::lock_guard<std::mutex> guard(process_pool_fd_lock);
+    process_pool_fd.erase(std::remove(process_pool_fd.begin(), process_pool_fd.end(), fd), process_pool_fd.end());
+    close(fd);
+}
+
+// Sends a worker's pid with its pool end attached; fd -1 sends the pid alone.
+static bool process_pool_send(int fd, int64_t pid, int attached)
+{
+    char buffer[CMSG_SPACE(sizeof(int))] = {};
+    iovec v = { &pid, sizeof(pid) };
+    msghdr m = {};
+    m.msg_iov = &v;
+    m.msg_iovlen = 1;
+    if (attached >= 0) {
+        m.msg_control = buffer;
+        m.msg_controllen = sizeof(buffer);
+        cmsghdr* c = CMSG_FIRSTHDR(&m);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(c), &attached, sizeof(int));
+    }
+    ssize_t n;
+    do {
+        n = sendmsg(fd, &m, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == sizeof(pid);
+}
+
+static bool process_pool_receive(int fd, int64_t& pid, int& attached)
+{
+    char buffer[CMSG_SPACE(sizeof(int))] = {};
+    iovec v = { &pid, sizeof(pid) };
+    msghdr m = {};
+    m.msg_iov = &v;
+    m.msg_iovlen = 1;
+    m.msg_control = buffer;
+    m.msg_controllen = sizeof(buffer);
+    ssize_t n;
+    do {
+        n = recvmsg(fd, &m, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+    } while (n < 0 && errno == EINTR);
+    attached = -1;
+    cmsghdr* c = CMSG_FIRSTHDR(&m);
+    if (c && c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+        memcpy(&attached, CMSG_DATA(c), sizeof(int));
+    }
+    return n == sizeof(pid);
+}
+
+// Waits up to `seconds` for child p and kills it when it is still running then.
+static void process_pool_reap(pid_t p, double seconds)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    for (;;) {
+        pid_t r = waitpid(p, 0, WNOHANG);
+        if (r == p || (r < 0 && errno != EINTR)) {
+            return;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    kill(p, SIGKILL);
+    while (waitpid(p, 0, 0) < 0 && errno == EINTR) {
+    }
+}
+
+// Worker slots and their processes. The workers are children of a helper forked by
+// the constructor, which stays single threaded and runs no user code: the pool asks
+// it over the control socket to kill a worker and to fork a replacement, so neither
+// fork nor kill ever happens in the multithreaded pool process, and a pid the pool
+// names is never reaped, and so never reused, before the helper kills it. A slot is
+// idle, borrowed by one evaluating thread, or dead (socket -1) once the restart
+// budget is spent.
+class process_pool_state {
+public:
+    optimization::function_t fun;
+    std::mutex lock;
+    std::condition_variable idle;
+    std::vector<int> socket;
+    std::vector<pid_t> pid;
+    std::vector<char> busy;
+    size_t alive, restarts;
+    int control;
+    pid_t helper;
+
+    process_pool_state(const optimization::function_t& fun, size_t workers)
+        : fun(fun)
+        , socket(workers, -1)
+        , pid(workers, -1)
+        , busy(workers, 0)
+        , alive(0)
+        , restarts(0)
+        , control(-1)
+        , helper(-1)
+    {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+            return;
+        }
+        std::unique_lock<std::mutex> registry(process_pool_fd_lock);
+        pid_t p = fork();
+        if (p == 0) {
+            for (const auto& fd : process_pool_fd) {
+                close(fd);
+            }
+            close(sv[0]);
+            this->serve_helper(sv[1]);
+        }
+        close(sv[1]);
+        if (p < 0) {
+            close(sv[0]);
+            return;
+        }
+        process_pool_fd.push_back(sv[0]);
+        registry.unlock();
+        this->control = sv[0];
+        this->helper = p;
+        std::lock_guard<std::mutex> guard(this->lock);
+        for (size_t w = 0; w < workers; ++w) {
+            this->spawn(w, -1);
+        }
+    }
+
+    // Closing the worker sockets lets idle workers leave; closing the control socket
+    // makes the helper wait exit_timeout seconds for them and kill the rest.
+    virtual ~process_pool_state()
+    {
+        for (const auto& fd : this->socket) {
+            if (fd >= 0) {
+                process_pool_forget(fd);
+            }
+        }
+        if (this->control >= 0) {
+            process_pool_forget(this->control);
+            process_pool_reap(this->helper, 2 * optimization::process_pool::exit_timeout + 1);
+        }
+    }
+
+    // Has the helper kill worker `old` (when not -1) and fork the worker of slot w;
+    // called with the lock held. The registry lock covers the new descriptor from its
+    // arrival, so a pool constructed meanwhile never inherits it.
+    void spawn(size_t w, pid_t old)
+    {
+        if (this->control < 0) {
+            return;
+        }
+        int64_t request[2] = { old, 1 }, p;
+        int fd;
+        std::lock_guard<std::mutex> registry(process_pool_fd_lock);
+        if (!process_pool_write(this->control, request, sizeof(request)) || !process_pool_receive(this->control, p, fd) || p < 0 || fd < 0) {
+            return;
+        }
+        process_pool_fd.push_back(fd);
+        this->socket[w] = fd;
+        this->pid[w] = static_cast<pid_t>(p);
+        ++this->alive;
+    }
+
+    // Has the helper kill worker `old` without a replacement; called with the lock held.
+    void retire(pid_t old)
+    {
+        int64_t request[2] = { old, 0 };
+        if (this->control >= 0) {
+            process_pool_write(this->control, request, sizeof(request));
+        }
+    }
+
+    // The helper loop: a request is the pid to kill (or -1) and whether to fork a new
+    // worker, answered by its pid with the pool end attached. The helper leaves when
+    // the pool closes the control socket, after reaping or killing every worker.
+    [[noreturn]] void serve_helper(int fd)
+    {
+        std::vector<pid_t> child;
+        for (;;) {
+            int64_t request[2];
+            if (!process_pool_read(fd, request, sizeof(request), 0)) {
+                break;
+            }
+            pid_t old = static_cast<pid_t>(request[0]);
+            if (old > 0 && std::find(child.begin(), child.end(), old) != child.end()) {
+                kill(old, SIGKILL);
+                while (waitpid(old, 0, 0) < 0 && errno == EINTR) {
+                }
+                child.erase(std::find(child.begin(), child.end(), old));
+            }
+            if (!request[1]) {
+                continue;
+            }
+            int sv[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+                process_pool_send(fd, -1, -1);
+                continue;
+            }
+            pid_t p = fork();
+            if (p == 0) {
+                close(fd);
+                close(sv[0]);
+                this->serve(sv[1]);
+            }
+            close(sv[1]);
+            if (p > 0) {
+                child.push_back(p);
+            }
+            process_pool_send(fd, p, p > 0 ? sv[0] : -1);
+            close(sv[0]);
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(optimization::process_pool::exit_timeout);
+        for (const auto& p : child) {
+            process_pool_reap(p, std::max(0.0, std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count()));
+        }
+        _exit(0);
+    }
+
+    // The worker loop: a point is its dimension followed by its coordinates, the answer
+    // one double. The worker leaves when the pool closes its end.
+    [[noreturn]] void serve(int fd)
+    {
+        real_block x;
+        for (;;) {
+            uint64_t n;
+            if (!process_pool_read(fd, &n, sizeof(n), 0)) {
+                break;
+            }
+            x.resize(n, 1);
+            if (!process_pool_read(fd, x.data(), n * sizeof(double), 0)) {
+                break;
+            }
+            double v = this->fun(x);
+            if (!process_pool_write(fd, &v, sizeof(v))) {
+                break;
+            }
+        }
+        _exit(0);
+    }
+
+    size_t acquire()
+    {
+        std::unique_lock<std::mutex> guard(this->lock);
+        for (;;) {
+            if (this->alive == 0) {
+                return process_pool_npos;
+            }
+            for (size_t w = 0; w < this->socket.size(); ++w) {
+                if (this->socket[w] >= 0 && !this->busy[w]) {
+                    this->busy[w] = 1;
+                    return w;
+                }
+            }
+            this->idle.wait(guard);
+        }
+    }
+
+    // Hands slot w back, replacing its worker first when it failed.
+    void release(size_t w, bool failed)
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (failed) {
+            process_pool_forget(this->socket[w]);
+            this->socket[w] = -1;
+            --this->alive;
+            if (this->restarts < optimization::process_pool::max_restarts) {
+                ++this->restarts;
+                this->spawn(w, this->pid[w]);
+            } else {
+                this->retire(this->pid[w]);
+            }
+        }
+        this->busy[w] = 0;
+        this->idle.notify_all();
+    }
+
+    double evaluate(const real_block& x)
+    {
+        size_t w = this->acquire();
+        if (w == process_pool_npos) {
+            return HUGE_VAL;
+        }
+        int fd = this->socket[w];
+        uint64_t n = x.size();
+        double v;
+        bool ok = process_pool_write(fd, &n, sizeof(n)) && process_pool_write(fd, x.data(), n * sizeof(double)) && process_pool_read(fd, &v, sizeof(v), optimization::process_pool::timeout);
+        this->release(w, !ok);
+        return ok ? v : HUGE_VAL;
+    }
+};
+
+optimization::process_pool::process_pool(const function_t& fun, size_t workers)
+    : state(std::make_shared<process_pool_state>(fun, parallel::thread_number(workers)))
+{
+}
+
+size_t optimization::process_pool::size() const
+{
+    std::lock_guard<std::mutex> guard(this->state->lock);
+    return this->state->alive;
+}
+
+size_t optimization::process_pool::restarts() const
+{
+    std::lock_guard<std::mutex> guard(this->state->lock);
+    return this->state->restarts;
+}
+
+double optimization::process_pool::evaluate(const real_block& x) const
+{
+    return this->state->evaluate(x);
+}
+
+real_block optimization::process_pool::evaluate_batch(const real_block& x) const
+{
+    size_t k = x.cols();
+    real_block ret(k, 1);
+    parallel::ordered_for_each(
+        k, this->state->socket.size(),
+        [&](size_t j, size_t) {
+            ret(j) = this->state->evaluate(x.col(j));
+        },
+        [](size_t) {
+            return true;
+        });
+    return ret;
+}
+
+optimization::function_t optimization::process_pool::function() const
+{
+    std::shared_ptr<process_pool_state> s = this->state;
+    return [s](const real_block& x) {
+        return s->evaluate(x);
+    };
+}
+
+optimization::batch_function_t optimization::process_pool::batch_function() const
+{
+    process_pool pool = *this;
+    return [pool](const real_block& x) {
+        return pool.evaluate_batch(x);
+    };
+}
+}
@@ -1,19 +1,121 @@
 #include "random.hpp"
+#include <atomic>
 
 namespace anyprog {
+
+static uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t clock_seed()
+{
+    static std::atomic<uint64_t> sequence(0);
+    return splitmix64(std::chrono::system_clock::now().time_since_epoch().count() ^ splitmix64(sequence.fetch_add(1)));
+}
+
+// One Philox4x32-10 block: counter (ctr, stream) under key, turned into two doubles in [0,1).
+// Blocks do not depend on each other, which lets fill() run as a straight vectorizable loop.
+static inline void philox(uint64_t ctr, uint64_t stream, uint64_t key, double& a, double& b)
+{
+    uint32_t c0 = (uint32_t)ctr, c1 = (uint32_t)(ctr >> 32), c2 = (uint32_t)stream, c3 = (uint32_t)(stream >> 32);
+    uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+    for (int r = 0; r < 10; ++r) {
+        uint64_t p0 = (uint64_t)0xD2511F53U * c0, p1 = (uint64_t)0xCD9E8D57U * c2;
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0, n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += 0x9E3779B9U;
+        k1 += 0xBB67AE85U;
+    }
+    const double scale = 1.0 / 9007199254740992.0;
+    a = ((((uint64_t)c0 << 32) | c1) >> 11) * scale;
+    b = ((((uint64_t)c2 << 32) | c3) >> 11) * scale;
+}
+
 random::random()
-    : engine(std::chrono::system_clock::now().time_since_epoch().count())
-    , distribution(0, 1)
+    : random(0, 1)
 {
 }
 random::random(double l, double u)
-    : engine(std::chrono::system_clock::now().time_since_epoch().count())
-    , distribution(l, u)
+    : key(clock_seed())
+    , stream(0)
+    , counter(0)
+    , lower(l)
+    , upper(u)
+    , buffer(0)
+    , buffered(false)
+{
+}
+random::random(double l, double u, unsigned long seed)
+    : random(l, u, seed, 0)
+{
+}
+random::random(double l, double u, unsigned long seed, unsigned long stream)
+    : key(splitmix64(seed))
+    , stream(stream)
+    , counter(0)
+    , lower(l)
+    , upper(u)
+    , buffer(0)
+    , buffered(false)
 {
 }
 
 double random::generate()
 {
-    return this->distribution(this->engine);
+    if (this->buffered) {
+        this->buffered = false;
+        return this->lower + (this->upper - this->lower) * this->buffer;
+    }
+    double a;
+    philox(this->counter++, this->stream, this->key, a, this->buffer);
+    this->buffered = true;
+    return this->lower + (this->upper - this->lower) * a;
+}
+
+random random::substream(unsigned long id) const
+{
+    random ret(*this);
+    ret.stream = splitmix64(this->stream ^ splitmix64(id));
+    ret.counter = 0;
+    ret.buffered = false;
+    return ret;
+}
+
+void random::fill(real_block& x)
+{
+    size_t n = x.size(), pairs = n / 2;
+    double* p = x.data();
+    for (size_t i = 0; i < pairs; ++i) {
+        philox(this->counter + i, this->stream, this->key, p[2 * i], p[2 * i + 1]);
+    }
+    if (n % 2) {
+        double unused;
+        philox(this->counter + pairs, this->stream, this->key, p[n - 1], unused);
+    }
+    this->counter += (n + 1) / 2;
+    this->buffered = false;
+}
+
+void random::fill(real_block& x, double l, double u)
+{
+    this->fill(x);
+    x = (x.array() * (u - l) + l).matrix();
+}
+
+void random::fill(real_block& x, const std::vector<std::pair<double, double>>& range)
+{
+    this->fill(x);
+    size_t m = x.rows();
+    for (size_t i = 0; i < m; ++i) {
+        const std::pair<double, double>& r = range[i];
+        x.row(i) = (x.row(i).array() * (r.second - r.first) + r.first).matrix();
+    }
+}
 }
-}
\ No newline at end of file
@@ -0,0 +1,1272 @@
+#include "optimization.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace anyprog {
+
+static const double simplex_inf = std::numeric_limits<double>::infinity();
+static const double primal_tol = 1e-9, dual_tol = 1e-9, pivot_tol = 1e-9;
+static const double markowitz_tol = 0.1, drop_tol = 1e-14, dense_tol = 0.3;
+
+size_t optimization::simplex::refactor_interval = 100;
+size_t optimization::simplex::stop_interval = 100;
+
+optimization::simplex::factor_t::factor_t()
+    : m(0)
+    , updates(0)
+    , l_pivot()
+    , l_start()
+    , l_index()
+    , r_pivot()
+    , r_start()
+    , r_index()
+    , l_value()
+    , r_value()
+    , diag()
+    , urow()
+    , ucol()
+    , order()
+    , pcol()
+    , prow()
+    , work()
+    , spike()
+{
+}
+
+// Markowitz elimination on the basis columns: column singletons first, then row
+// singletons, then the entry with the lowest (r - 1)(c - 1) in the sparsest few
+// columns among those of magnitude at least markowitz_tol of their column maximum.
+// Positions left without a pivot are reported in `singular` with a free row each.
+bool optimization::simplex::factor_t::build(const sparse_block& A, const std::vector<size_t>& basis, std::vector<std::pair<size_t, size_t>>& singular)
+{
+    int n = basis.size();
+    this->m = n;
+    this->updates = 0;
+    this->l_pivot.clear();
+    this->l_start.assign(1, 0);
+    this->l_index.clear();
+    this->l_value.clear();
+    this->r_pivot.clear();
+    this->r_start.assign(1, 0);
+    this->r_index.clear();
+    this->r_value.clear();
+    this->diag.assign(n, 0);
+    this->urow.assign(n, {});
+    this->ucol.assign(n, {});
+    this->order.clear();
+    this->pcol.assign(n, -1);
+    this->prow.assign(n, -1);
+    this->spike.assign(n, 0);
+
+    std::vector<std::vector<std::pair<int, double>>> col(n);
+    std::vector<std::vector<int>> row(n);
+    for (int k = 0; k < n; ++k) {
+        for (sparse_block::InnerIterator it(A, basis[k]); it; ++it) {
+            if (it.value() != 0) {
+                col[k].emplace_back(it.row(), it.value());
+                row[it.row()].push_back(k);
+            }
+        }
+    }
+
+    // Columns are nodes [0, n) and rows nodes [n, 2n) of doubly linked count buckets.
+    std::vector<int> head(2 * (n + 1), -1), next(2 * n, -1), prev(2 * n, -1), count(2 * n, 0), mark(n, -1);
+    auto bucket = [&](int id) { return (id < n ? 0 : n + 1) + count[id]; };
+    auto link = [&](int id) {
+        int h = bucket(id);
+        prev[id] = -1;
+        next[id] = head[h];
+        if (head[h] >= 0) {
+            prev[head[h]] = id;
+        }
+        head[h] = id;
+    };
+    auto unlink = [&](int id) {
+        if (prev[id] >= 0) {
+            next[prev[id]] = next[id];
+        } else {
+            head[bucket(id)] = next[id];
+        }
+        if (next[id] >= 0) {
+            prev[next[id]] = prev[id];
+        }
+    };
+    auto column_max = [&](int k) {
+        double ret = 0;
+        for (const auto& e : col[k]) {
+            ret = std::max(ret, fabs(e.second));
+        }
+        return ret;
+    };
+    size_t active = 0;
+    for (int k = 0; k < n; ++k) {
+        count[k] = col[k].size();
+        link(k);
+        count[n + k] = row[k].size();
+        link(n + k);
+        active += col[k].size();
+    }
+
+    for (int step = 0; step < n; ++step) {
+        double left = n - step;
+        if (left >= 32 && active >= dense_tol * left * left) {
+            this->eliminate_dense(col);
+            break;
+        }
+        int p = -1, q = -1, seen = 0;
+        double best = simplex_inf, piv = 0;
+        for (int c = 1; c <= n; ++c) {
+            if (q >= 0 && (seen >= 4 || best <= double(c - 1) * (c - 1))) {
+                break;
+            }
+            for (int k = head[c]; k >= 0 && !(q >= 0 && (seen >= 4 || best == 0)); k = next[k]) {
+                double tol = std::max(markowitz_tol * column_max(k), pivot_tol);
+                bool found = false;
+                for (const auto& e : col[k]) {
+                    double cost = double(count[n + e.first] - 1) * (c - 1);
+                    if (fabs(e.second) < tol) {
+                        continue;
+                    }
+                    found = true;
+                    if (cost < best) {
+                        best = cost;
+                        p = e.first;
+                        q = k;
+                        piv = e.second;
+                    }
+                }
+                seen += found;
+            }
+            for (int id = c == 1 ? head[n + 2] : -1; id >= 0 && q < 0; id = next[id]) {
+                int k = row[id - n].front();
+                for (const auto& e : col[k]) {
+                    if (e.first == id - n && fabs(e.second) >= std::max(markowitz_tol * column_max(k), pivot_tol)) {
+                        best = 0;
+                        p = e.first;
+                        q = k;
+                        piv = e.second;
+                    }
+                }
+            }
+        }
+        if (q < 0) {
+            break;
+        }
+
+        // The pivot row goes to U, the pivot column below it to an L eta, and the
+        // outer product of the two updates the active submatrix.
+        unlink(q);
+        unlink(n + p);
+        auto& u = this->urow[p];
+        for (int k : row[p]) {
+            if (k == q) {
+                continue;
+            }
+            auto& ck = col[k];
+            for (size_t e = 0; e < ck.size(); ++e) {
+                if (ck[e].first == p) {
+                    u.emplace_back(k, ck[e].second);
+                    ck[e] = ck.back();
+                    ck.pop_back();
+                    --active;
+                    break;
+                }
+            }
+            unlink(k);
+        }
+        row[p].clear();
+        size_t first = this->l_index.size();
+        for (const auto& e : col[q]) {
+            if (e.first == p) {
+                continue;
+            }
+            this->l_index.push_back(e.first);
+            this->l_value.push_back(e.second / piv);
+            auto& ri = row[e.first];
+            ri.erase(std::find(ri.begin(), ri.end(), q));
+            unlink(n + e.first);
+        }
+        active -= col[q].size();
+        col[q].clear();
+        if (this->l_index.size() > first) {
+            this->l_pivot.push_back(p);
+            this->l_start.push_back(this->l_index.size());
+        }
+        for (const auto& ue : u) {
+            auto& ck = col[ue.first];
+            active -= ck.size();
+            for (size_t e = 0; e < ck.size(); ++e) {
+                mark[ck[e].first] = e;
+            }
+            for (size_t e = first; e < this->l_index.size(); ++e) {
+                int i = this->l_index[e];
+                double v = -this->l_value[e] * ue.second;
+                if (mark[i] >= 0) {
+                    ck[mark[i]].second += v;
+                } else {
+                    mark[i] = ck.size();
+                    ck.emplace_back(i, v);
+                    row[i].push_back(ue.first);
+                }
+            }
+            for (size_t e = 0; e < ck.size();) {
+                mark[ck[e].first] = -1;
+                if (fabs(ck[e].second) <= drop_tol) {
+                    auto& ri = row[ck[e].first];
+                    ri.erase(std::find(ri.begin(), ri.end(), ue.first));
+                    ck[e] = ck.back();
+                    ck.pop_back();
+                } else {
+                    ++e;
+                }
+            }
+            active += ck.size();
+            count[ue.first] = ck.size();
+            link(ue.first);
+        }
+        for (size_t e = first; e < this->l_index.size(); ++e) {
+            int i = this->l_index[e];
+            count[n + i] = row[i].size();
+            link(n + i);
+        }
+        this->diag[p] = piv;
+        this->pcol[p] = q;
+        this->prow[q] = p;
+        this->order.push_back(p);
+    }
+
+    if (static_cast<int>(this->order.size()) < n) {
+        singular.clear();
+        for (int k = 0, i = 0; k < n; ++k) {
+            if (this->prow[k] < 0) {
+                while (this->pcol[i] >= 0) {
+                    ++i;
+                }
+                singular.push_back({ k, i++ });
+            }
+        }
+        return false;
+    }
+    for (int p = 0; p < n; ++p) {
+        for (const auto& e : this->urow[p]) {
+            this->ucol[e.first].emplace_back(p, e.second);
+        }
+    }
+    return true;
+}
+
+// Once the active submatrix is dense_tol full, the rest is eliminated as a dense block
+// with partial pivoting down each column, which is far cheaper per entry than the lists.
+void optimization::simplex::factor_t::eliminate_dense(const std::vector<std::vector<std::pair<int, double>>>& col)
+{
+    std::vector<int> rows, cols, local(this->m, -1);
+    for (size_t i = 0; i < this->m; ++i) {
+        if (this->pcol[i] < 0) {
+            local[i] = rows.size();
+            rows.push_back(i);
+        }
+        if (this->prow[i] < 0) {
+            cols.push_back(i);
+        }
+    }
+    size_t r = rows.size(), c = cols.size(), s = 0;
+    Eigen::MatrixXd D = Eigen::MatrixXd::Zero(r, c);
+    for (size_t j = 0; j < c; ++j) {
+        for (const auto& e : col[cols[j]]) {
+            D(local[e.first], j) = e.second;
+        }
+    }
+    for (size_t j = 0; j < c && s < r; ++j) {
+        Eigen::Index best;
+        if (D.col(j).segment(s, r - s).cwiseAbs().maxCoeff(&best) < pivot_tol) {
+            continue;
+        }
+        best += s;
+        D.row(s).swap(D.row(best));
+        std::swap(rows[s], rows[best]);
+        int p = rows[s];
+        double piv = D(s, j);
+        size_t first = this->l_index.size();
+        D.col(j).segment(s + 1, r - s - 1) /= piv;
+        for (size_t i = s + 1; i < r; ++i) {
+            if (D(i, j) != 0) {
+                this->l_index.push_back(rows[i]);
+                this->l_value.push_back(D(i, j));
+            }
+        }
+        if (this->l_index.size() > first) {
+            this->l_pivot.push_back(p);
+            this->l_start.push_back(this->l_index.size());
+        }
+        for (size_t k = j + 1; k < c; ++k) {
+            double u = D(s, k);
+            if (fabs(u) > drop_tol) {
+                this->urow[p].emplace_back(cols[k], u);
+                D.col(k).segment(s + 1, r - s - 1) -= u * D.col(j).segment(s + 1, r - s - 1);
+            }
+        }
+        this->diag[p] = piv;
+        this->pcol[p] = cols[j];
+        this->prow[cols[j]] = p;
+        this->order.push_back(p);
+        ++s;
+    }
+}
+
+// Rows in, basis positions out. With save the vector is kept after L and R as the
+// spike the next update() puts in U.
+void optimization::simplex::factor_t::ftran(Eigen::VectorXd& v, bool save) const
+{
+    for (size_t t = 0; t < this->l_pivot.size(); ++t) {
+        double x = v(this->l_pivot[t]);
+        if (x != 0) {
+            for (int e = this->l_start[t]; e < this->l_start[t + 1]; ++e) {
+                v(this->l_index[e]) -= this->l_value[e] * x;
+            }
+        }
+    }
+    for (size_t t = 0; t < this->r_pivot.size(); ++t) {
+        double x = v(this->r_pivot[t]);
+        for (int e = this->r_start[t]; e < this->r_start[t + 1]; ++e) {
+            x -= this->r_value[e] * v(this->r_index[e]);
+        }
+        v(this->r_pivot[t]) = x;
+    }
+    if (save) {
+        this->spike.assign(v.data(), v.data() + this->m);
+    }
+    this->work.resize(this->m);
+    for (size_t t = this->m; t-- > 0;) {
+        int p = this->order[t];
+        double x = v(p);
+        this->work[this->pcol[p]] = x;
+        if (x != 0) {
+            x /= this->diag[p];
+            this->work[this->pcol[p]] = x;
+            for (const auto& e : this->ucol[this->pcol[p]]) {
+                v(e.first) -= e.second * x;
+            }
+        }
+    }
+    v = Eigen::Map<const Eigen::VectorXd>(this->work.data(), this->m);
+}
+
+// Basis positions in, rows out.
+void optimization::simplex::factor_t::btran(Eigen::VectorXd& v) const
+{
+    this->work.resize(this->m);
+    for (size_t t = 0; t < this->m; ++t) {
+        int p = this->order[t];
+        double x = v(this->pcol[p]);
+        this->work[p] = x;
+        if (x != 0) {
+            x /= this->diag[p];
+            this->work[p] = x;
+            for (const auto& e : this->urow[p]) {
+                v(e.first) -= e.second * x;
+            }
+        }
+    }
+    v = Eigen::Map<const Eigen::VectorXd>(this->work.data(), this->m);
+    for (size_t t = this->r_pivot.size(); t-- > 0;) {
+        double x = v(this->r_pivot[t]);
+        if (x != 0) {
+            for (int e = this->r_start[t]; e < this->r_start[t + 1]; ++e) {
+                v(this->r_index[e]) -= this->r_value[e] * x;
+            }
+        }
+    }
+    for (size_t t = this->l_pivot.size(); t-- > 0;) {
+        double x = v(this->l_pivot[t]);
+        for (int e = this->l_start[t]; e < this->l_start[t + 1]; ++e) {
+            x -= this->l_value[e] * v(this->l_index[e]);
+        }
+        v(this->l_pivot[t]) = x;
+    }
+}
+
+// Forrest-Tomlin: the spike replaces U's column r, its pivot row moves to the end of
+// the order and is cleared left of the diagonal by the row eta recorded in R. The new
+// diagonal must equal alpha_r times the old one; a mismatch asks for a refactor.
+bool optimization::simplex::factor_t::update(size_t r, double alpha)
+{
+    int pt = this->prow[r];
+    for (const auto& e : this->ucol[r]) {
+        auto& ui = this->urow[e.first];
+        for (size_t n = 0; n < ui.size(); ++n) {
+            if (ui[n].first == static_cast<int>(r)) {
+                ui[n] = ui.back();
+                ui.pop_back();
+                break;
+            }
+        }
+    }
+    this->ucol[r].clear();
+    this->work.assign(this->m, 0);
+    for (const auto& e : this->urow[pt]) {
+        this->work[e.first] = e.second;
+        auto& uk = this->ucol[e.first];
+        for (size_t n = 0; n < uk.size(); ++n) {
+            if (uk[n].first == pt) {
+                uk[n] = uk.back();
+                uk.pop_back();
+                break;
+            }
+        }
+    }
+    this->urow[pt].clear();
+
+    auto t = std::find(this->order.begin(), this->order.end(), pt);
+    double s = this->spike[pt];
+    this->r_pivot.push_back(pt);
+    for (auto it = t + 1; it != this->order.end(); ++it) {
+        int p = *it;
+        double w = this->work[this->pcol[p]];
+        if (w == 0) {
+            continue;
+        }
+        this->work[this->pcol[p]] = 0;
+        double mult = w / this->diag[p];
+        this->r_index.push_back(p);
+        this->r_value.push_back(mult);
+        for (const auto& e : this->urow[p]) {
+            this->work[e.first] -= mult * e.second;
+        }
+        s -= mult * this->spike[p];
+    }
+    this->r_start.push_back(this->r_index.size());
+    this->order.erase(t);
+    this->order.push_back(pt);
+    ++this->updates;
+
+    double expect = alpha * this->diag[pt];
+    this->diag[pt] = s;
+    for (size_t i = 0; i < this->m; ++i) {
+        double v = this->spike[i];
+        if (static_cast<int>(i) != pt && fabs(v) > drop_tol) {
+            this->urow[i].emplace_back(r, v);
+            this->ucol[r].emplace_back(i, v);
+        }
+    }
+    return fabs(s) > pivot_tol && fabs(s - expect) <= 1e-7 * std::max(1.0, fabs(s));
+}
+
+optimization::simplex::simplex(const real_block& c, const std::vector<range_t>& range)
+    : rows(0)
+    , cols(c.rows())
+    , c(c)
+    , entries()
+    , rhs()
+    , equality()
+    , bound(range)
+    , A()
+    , AR()
+    , x()
+    , cost()
+    , weight()
+    , state()
+    , basis()
+    , lu()
+    , reduced()
+    , sol(c.rows(), 1)
+    , fval(0)
+    , iter(0)
+    , status(optimization::simplex::status_t::ITERATION_LIMIT)
+    , dirty(true)
+    , stop()
+{
+    if (this->bound.size() != this->cols) {
+        this->bound.assign(this->cols, { -simplex_inf, simplex_inf });
+    }
+    this->sol.setZero();
+}
+
+optimization::simplex& optimization::simplex::add_equation(const real_block& A, const real_block& b)
+{
+    for (size_t i = 0; i < static_cast<size_t>(A.rows()); ++i) {
+        for (size_t j = 0; j < static_cast<size_t>(A.cols()); ++j) {
+            if (A(i, j) != 0) {
+                this->entries.emplace_back(this->rows, j, A(i, j));
+            }
+        }
+        this->rhs.push_back(b(i, 0));
+        this->equality.push_back(1);
+        ++this->rows;
+    }
+    this->dirty = true;
+    return *this;
+}
+
+optimization::simplex& optimization::simplex::add_inequation(const real_block& A, const real_block& b)
+{
+    for (size_t i = 0; i < static_cast<size_t>(A.rows()); ++i) {
+        for (size_t j = 0; j < static_cast<size_t>(A.cols()); ++j) {
+            if (A(i, j) != 0) {
+                this->entries.emplace_back(this->rows, j, A(i, j));
+            }
+        }
+        this->rhs.push_back(b(i, 0));
+        this->equality.push_back(0);
+        ++this->rows;
+    }
+    this->dirty = true;
+    return *this;
+}
+
+optimization::simplex& optimization::simplex::add_equation(const sparse_block& A, const real_block& b)
+{
+    for (int j = 0; j < A.outerSize(); ++j) {
+        for (sparse_block::InnerIterator it(A, j); it; ++it) {
+            this->entries.emplace_back(this->rows + it.row(), j, it.value());
+        }
+    }
+    for (size_t i = 0; i < static_cast<size_t>(A.rows()); ++i) {
+        this->rhs.push_back(b(i, 0));
+        this->equality.push_back(1);
+    }
+    this->rows += A.rows();
+    this->dirty = true;
+    return *this;
+}
+
+optimization::simplex& optimization::simplex::add_inequation(const sparse_block& A, const real_block& b)
+{
+    for (int j = 0; j < A.outerSize(); ++j) {
+        for (sparse_block::InnerIterator it(A, j); it; ++it) {
+            this->entries.emplace_back(this->rows + it.row(), j, it.value());
+        }
+    }
+    for (size_t i = 0; i < static_cast<size_t>(A.rows()); ++i) {
+        this->rhs.push_back(b(i, 0));
+        this->equality.push_back(0);
+    }
+    this->rows += A.rows();
+    this->dirty = true;
+    return *this;
+}
+
+optimization::simplex& optimization::simplex::set_bound(size_t j, const range_t& r)
+{
+    this->bound[j] = r;
+    return *this;
+}
+
+optimization::simplex& optimization::simplex::set_basis(const optimization::simplex::basis_t& b)
+{
+    this->state = b;
+    return *this;
+}
+
+optimization::simplex& optimization::simplex::set_stop_function(const optimization::simplex::stop_function_t& f)
+{
+    this->stop = f;
+    return *this;
+}
+
+void optimization::simplex::build()
+{
+    if (!this->dirty) {
+        return;
+    }
+    this->dirty = false;
+    size_t total = this->cols + this->rows;
+    std::vector<Eigen::Triplet<double>> t(this->entries);
+    for (size_t i = 0; i < this->rows; ++i) {
+        t.emplace_back(i, this->cols + i, 1.0);
+    }
+    this->A.resize(this->rows, total);
+    this->A.setFromTriplets(t.begin(), t.end());
+    this->A.makeCompressed();
+    this->AR = this->A;
+    this->AR.makeCompressed();
+    this->bound.resize(total);
+    for (size_t i = 0; i < this->rows; ++i) {
+        this->bound[this->cols + i] = { 0, this->equality[i] ? 0 : simplex_inf };
+    }
+    this->cost.setZero(total);
+    this->cost.head(this->cols) = this->c.col(0);
+    this->x.setZero(total);
+}
+
+void optimization::simplex::cold_start()
+{
+    size_t total = this->cols + this->rows;
+    this->state.assign(total, optimization::simplex::state_t::AT_LOWER);
+    this->basis.resize(this->rows);
+    for (size_t i = 0; i < this->rows; ++i) {
+        this->basis[i] = this->cols + i;
+        this->state[this->cols + i] = optimization::simplex::state_t::BASIC;
+    }
+    for (size_t j = 0; j < this->cols; ++j) {
+        const range_t& b = this->bound[j];
+        if (std::isfinite(b.first) && (!std::isfinite(b.second) || this->cost(j) >= 0)) {
+            this->state[j] = optimization::simplex::state_t::AT_LOWER;
+        } else if (std::isfinite(b.second)) {
+            this->state[j] = optimization::simplex::state_t::AT_UPPER;
+        } else {
+            this->state[j] = optimization::simplex::state_t::AT_ZERO;
+        }
+    }
+}
+
+// A singular basis gets the slacks of its unpivoted rows in place of the columns that
+// had no pivot; those columns go to a finite bound.
+bool optimization::simplex::factor()
+{
+    std::vector<std::pair<size_t, size_t>> singular;
+    for (size_t attempt = 0; attempt < 4; ++attempt) {
+        if (this->lu.build(this->A, this->basis, singular)) {
+            return true;
+        }
+        for (const auto& s : singular) {
+            size_t k = this->basis[s.first];
+            const range_t& b = this->bound[k];
+            this->state[k] = std::isfinite(b.first) ? optimization::simplex::state_t::AT_LOWER : (std::isfinite(b.second) ? optimization::simplex::state_t::AT_UPPER : optimization::simplex::state_t::AT_ZERO);
+            this->basis[s.first] = this->cols + s.second;
+            this->state[this->cols + s.second] = optimization::simplex::state_t::BASIC;
+        }
+    }
+    return false;
+}
+
+bool optimization::simplex::refactor()
+{
+    if (!this->factor()) {
+        return false;
+    }
+    this->compute_primal();
+    this->compute_reduced();
+    return true;
+}
+
+void optimization::simplex::ftran(Eigen::VectorXd& v, bool save) const
+{
+    this->lu.ftran(v, save);
+}
+
+void optimization::simplex::btran(Eigen::VectorXd& v) const
+{
+    this->lu.btran(v);
+}
+
+// alpha = A' rho, row by row over the nonzeros of rho when it is sparse. With pattern
+// the columns alpha may be nonzero on are listed too, so pivot row loops skip the rest;
+// alpha and pattern then come from the previous call and only that pattern is cleared.
+void optimization::simplex::row_product(const Eigen::VectorXd& rho, Eigen::VectorXd& alpha, std::vector<size_t>* pattern) const
+{
+    size_t total = this->cols + this->rows, nnz = 0;
+    for (size_t i = 0; i < this->rows; ++i) {
+        nnz += rho(i) != 0;
+    }
+    if (pattern && static_cast<size_t>(alpha.size()) == total) {
+        for (size_t j : *pattern) {
+            alpha(j) = 0;
+        }
+    } else {
+        alpha.setZero(total);
+    }
+    if (pattern) {
+        pattern->clear();
+    }
+    if (10 * nnz > this->rows) {
+        alpha = this->A.transpose() * rho;
+        for (size_t j = 0; pattern && j < total; ++j) {
+            if (alpha(j) != 0) {
+                pattern->push_back(j);
+            }
+        }
+        return;
+    }
+    for (size_t i = 0; i < this->rows; ++i) {
+        if (rho(i) != 0) {
+            for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(this->AR, i); it; ++it) {
+                if (pattern && alpha(it.col()) == 0) {
+                    pattern->push_back(it.col());
+                }
+                alpha(it.col()) += rho(i) * it.value();
+            }
+        }
+    }
+    if (pattern) {
+        std::sort(pattern->begin(), pattern->end());
+        pattern->erase(std::unique(pattern->begin(), pattern->end()), pattern->end());
+    }
+}
+
+void optimization::simplex::compute_primal()
+{
+    size_t total = this->cols + this->rows;
+    Eigen::VectorXd r = Eigen::Map<const Eigen::VectorXd>(this->rhs.data(), this->rows);
+    for (size_t j = 0; j < total; ++j) {
+        switch (this->state[j]) {
+        case optimization::simplex::state_t::BASIC:
+            continue;
+        case optimization::simplex::state_t::AT_LOWER:
+            this->x(j) = this->bound[j].first;
+            break;
+        case optimization::simplex::state_t::AT_UPPER:
+            this->x(j) = this->bound[j].second;
+            break;
+        default:
+            this->x(j) = 0;
+            break;
+        }
+        if (this->x(j) != 0) {
+            for (sparse_block::InnerIterator it(this->A, j); it; ++it) {
+                r(it.row()) -= it.value() * this->x(j);
+            }
+        }
+    }
+    this->ftran(r);
+    for (size_t i = 0; i < this->rows; ++i) {
+        this->x(this->basis[i]) = r(i);
+    }
+}
+
+void optimization::simplex::compute_reduced()
+{
+    Eigen::VectorXd y(this->rows);
+    for (size_t i = 0; i < this->rows; ++i) {
+        y(i) = this->cost(this->basis[i]);
+    }
+    this->btran(y);
+    this->row_product(y, this->reduced);
+    this->reduced = this->cost - this->reduced;
+}
+
+double optimization::simplex::infeasibility() const
+{
+    double ret = 0;
+    for (size_t i = 0; i < this->rows; ++i) {
+        size_t k = this->basis[i];
+        ret = std::max(ret, std::max(this->bound[k].first - this->x(k), this->x(k) - this->bound[k].second));
+    }
+    return ret;
+}
+
+bool optimization::simplex::make_dual_feasible()
+{
+    size_t total = this->cols + this->rows;
+    this->compute_reduced();
+    bool flipped = false;
+    for (size_t j = 0; j < total; ++j) {
+        int s = this->state[j];
+        const range_t& b = this->bound[j];
+        if (s == optimization::simplex::state_t::BASIC || b.first == b.second) {
+            continue;
+        }
+        double d = this->reduced(j);
+        bool boxed = std::isfinite(b.first) && std::isfinite(b.second);
+        if ((s == optimization::simplex::state_t::AT_LOWER && d < -dual_tol) || (s == optimization::simplex::state_t::AT_UPPER && d > dual_tol)) {
+            if (!boxed) {
+                return false;
+            }
+            this->state[j] = s == optimization::simplex::state_t::AT_LOWER ? optimization::simplex::state_t::AT_UPPER : optimization::simplex::state_t::AT_LOWER;
+            flipped = true;
+        } else if (s == optimization::simplex::state_t::AT_ZERO && fabs(d) > dual_tol) {
+            return false;
+        }
+    }
+    if (flipped) {
+        this->compute_primal();
+    }
+    return true;
+}
+
+// Devex pricing over a rotating segment of the columns: the best d_j^2 / w_j in the
+// segment enters unless the segment has no candidate, in which case the scan goes on.
+// Phase 2 keeps the reduced costs up to date through the pivot row and recomputes
+// them before it declares a basis optimal.
+bool optimization::simplex::stopped() const
+{
+    size_t interval = std::max<size_t>(1, optimization::simplex::stop_interval);
+    return this->stop && (this->iter + 1) % interval == 0 && this->stop();
+}
+
+optimization::simplex::status_t optimization::simplex::primal(bool phase1, size_t limit)
+{
+    size_t total = this->cols + this->rows, degenerate = 0, start = 0;
+    size_t segment = std::min(total, std::max<size_t>(1000, total / 10));
+    Eigen::VectorXd y(this->rows), d(this->rows), rho(this->rows), alpha;
+    std::vector<size_t> pattern;
+    bool fresh = true;
+    this->weight.setOnes(total);
+    if (!phase1) {
+        this->compute_reduced();
+    }
+    for (; this->iter < limit; ++this->iter) {
+        if (this->stopped()) {
+            return optimization::simplex::status_t::STOPPED;
+        }
+        if (this->lu.updates >= optimization::simplex::refactor_interval) {
+            if (!this->refactor()) {
+                return optimization::simplex::status_t::ITERATION_LIMIT;
+            }
+            fresh = true;
+        }
+        if (phase1) {
+            bool feasible = true;
+            for (size_t i = 0; i < this->rows; ++i) {
+                size_t k = this->basis[i];
+                y(i) = this->x(k) < this->bound[k].first - primal_tol ? -1 : (this->x(k) > this->bound[k].second + primal_tol ? 1 : 0);
+                feasible = feasible && y(i) == 0;
+            }
+            if (feasible) {
+                return optimization::simplex::status_t::OPTIMAL;
+            }
+            this->btran(y);
+            this->row_product(y, this->reduced);
+            this->reduced = -this->reduced;
+        }
+
+        size_t q = total;
+        double best = 0, dir = 0;
+        bool bland = degenerate > 50;
+        for (size_t n = 0; n < total; ++n) {
+            size_t j = bland ? n : (start + n) % total;
+            if (q < total && n >= segment) {
+                start = j;
+                break;
+            }
+            int s = this->state[j];
+            if (s == optimization::simplex::state_t::BASIC || this->bound[j].first == this->bound[j].second) {
+                continue;
+            }
+            double dj = this->reduced(j), sign = 0;
+            if (dj < -dual_tol && s != optimization::simplex::state_t::AT_UPPER) {
+                sign = 1;
+            } else if (dj > dual_tol && s != optimization::simplex::state_t::AT_LOWER) {
+                sign = -1;
+            }
+            if (sign != 0 && dj * dj > best * this->weight(j)) {
+                best = dj * dj / this->weight(j);
+                q = j;
+                dir = sign;
+                if (bland) {
+                    break;
+                }
+            }
+        }
+        if (q == total) {
+            if (!fresh) {
+                this->compute_reduced();
+                fresh = true;
+                continue;
+            }
+            return phase1 ? optimization::simplex::status_t::INFEASIBLE : optimization::simplex::status_t::OPTIMAL;
+        }
+
+        d.setZero();
+        for (sparse_block::InnerIterator it(this->A, q); it; ++it) {
+            d(it.row()) = it.value();
+        }
+        this->ftran(d, true);
+
+        double t = this->bound[q].second - this->bound[q].first;
+        size_t r = this->rows;
+        int leave = optimization::simplex::state_t::AT_LOWER;
+        for (size_t i = 0; i < this->rows; ++i) {
+            if (fabs(d(i)) < pivot_tol) {
+                continue;
+            }
+            size_t k = this->basis[i];
+            double a = -dir * d(i), xb = this->x(k), lb = this->bound[k].first, ub = this->bound[k].second, step = simplex_inf;
+            int s = optimization::simplex::state_t::AT_LOWER;
+            if (phase1 && xb < lb - primal_tol) {
+                if (a > 0) {
+                    step = (lb - xb) / a;
+                }
+            } else if (phase1 && xb > ub + primal_tol) {
+                if (a < 0) {
+                    step = (xb - ub) / -a;
+                    s = optimization::simplex::state_t::AT_UPPER;
+                }
+            } else if (a < 0 && std::isfinite(lb)) {
+                step = std::max(0.0, (xb - lb) / -a);
+            } else if (a > 0 && std::isfinite(ub)) {
+                step = std::max(0.0, (ub - xb) / a);
+                s = optimization::simplex::state_t::AT_UPPER;
+            }
+            if (step < t - 1e-12 || (step <= t + 1e-12 && r < this->rows && fabs(d(i)) > fabs(d(r)))) {
+                t = step;
+                r = i;
+                leave = s;
+            }
+        }
+        if (!std::isfinite(t)) {
+            return optimization::simplex::status_t::UNBOUNDED;
+        }
+        if (r < this->rows) {
+            rho.setZero();
+            rho(r) = 1;
+            this->btran(rho);
+            this->row_product(rho, alpha, &pattern);
+            if (fabs(alpha(q) - d(r)) > 1e-7 * std::max(1.0, fabs(d(r))) && this->lu.updates > 0) {
+                if (!this->refactor()) {
+                    return optimization::simplex::status_t::ITERATION_LIMIT;
+                }
+                fresh = true;
+                continue;
+            }
+        }
+        degenerate = t <= primal_tol ? degenerate + 1 : 0;
+
+        this->x(q) += dir * t;
+        for (size_t i = 0; i < this->rows; ++i) {
+            this->x(this->basis[i]) -= dir * t * d(i);
+        }
+        if (r == this->rows) {
+            this->state[q] = dir > 0 ? optimization::simplex::state_t::AT_UPPER : optimization::simplex::state_t::AT_LOWER;
+            this->x(q) = dir > 0 ? this->bound[q].second : this->bound[q].first;
+            continue;
+        }
+        size_t k = this->basis[r];
+        double aq = d(r), wq = this->weight(q);
+        for (size_t j : pattern) {
+            if (this->state[j] != optimization::simplex::state_t::BASIC) {
+                this->weight(j) = std::max(this->weight(j), alpha(j) * alpha(j) / (aq * aq) * wq);
+            }
+        }
+        this->weight(k) = std::max(wq / (aq * aq), 1.0);
+        if (this->weight(k) > 1e6) {
+            this->weight.setOnes();
+        }
+        if (!phase1) {
+            double step = this->reduced(q) / aq;
+            for (size_t j : pattern) {
+                this->reduced(j) -= step * alpha(j);
+            }
+            this->reduced(q) = 0;
+            this->reduced(k) = -step;
+            fresh = false;
+        }
+        this->state[k] = leave;
+        this->x(k) = leave == optimization::simplex::state_t::AT_LOWER ? this->bound[k].first : this->bound[k].second;
+        this->basis[r] = q;
+        this->state[q] = optimization::simplex::state_t::BASIC;
+        if (!this->lu.update(r, aq)) {
+            if (!this->refactor()) {
+                return optimization::simplex::status_t::ITERATION_LIMIT;
+            }
+            fresh = true;
+        }
+    }
+    return optimization::simplex::status_t::ITERATION_LIMIT;
+}
+
+// Dual simplex with steepest-edge row choice (infeasibility^2 / ||e_r' B^-1||^2, the
+// weight of the chosen row recomputed exactly) and a bound-flipping ratio test: boxed
+// columns whose breakpoints leave the dual slope positive flip to their other bound
+// and the entering column is the largest |alpha| at the breakpoint where it turns.
+optimization::simplex::status_t optimization::simplex::dual(size_t limit)
+{
+    size_t total = this->cols + this->rows;
+    Eigen::VectorXd rho(this->rows), d(this->rows), tau(this->rows), delta(this->rows), alpha;
+    std::vector<std::pair<double, size_t>> candidates;
+    std::vector<size_t> pattern;
+    this->weight.setOnes(this->rows);
+    this->compute_reduced();
+    for (; this->iter < limit; ++this->iter) {
+        if (this->stopped()) {
+            return optimization::simplex::status_t::STOPPED;
+        }
+        if (this->lu.updates >= optimization::simplex::refactor_interval && !this->refactor()) {
+            return optimization::simplex::status_t::ITERATION_LIMIT;
+        }
+        size_t r = this->rows;
+        double best = 0;
+        for (size_t i = 0; i < this->rows; ++i) {
+            size_t k = this->basis[i];
+            double v = std::max(this->bound[k].first - this->x(k), this->x(k) - this->bound[k].second);
+            if (v > primal_tol && v * v > best * this->weight(i)) {
+                best = v * v / this->weight(i);
+                r = i;
+            }
+        }
+        if (r == this->rows) {
+            return optimization::simplex::status_t::OPTIMAL;
+        }
+        size_t k = this->basis[r];
+        bool increase = this->x(k) < this->bound[k].first;
+        double target = increase ? this->bound[k].first : this->bound[k].second;
+        rho.setZero();
+        rho(r) = 1;
+        this->btran(rho);
+        this->weight(r) = std::max(rho.squaredNorm(), 1e-4);
+        this->row_product(rho, alpha, &pattern);
+
+        candidates.clear();
+        for (size_t j : pattern) {
+            int s = this->state[j];
+            if (s == optimization::simplex::state_t::BASIC || this->bound[j].first == this->bound[j].second) {
+                continue;
+            }
+            double a = increase ? -alpha(j) : alpha(j);
+            if (fabs(a) < pivot_tol) {
+                continue;
+            }
+            if ((s == optimization::simplex::state_t::AT_LOWER && a > 0) || (s == optimization::simplex::state_t::AT_UPPER && a < 0)) {
+                candidates.push_back({ std::max(0.0, this->reduced(j) / a), j });
+            } else if (s == optimization::simplex::state_t::AT_ZERO) {
+                candidates.push_back({ fabs(this->reduced(j) / a), j });
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        size_t q = total, flips = 0;
+        double slope = fabs(this->x(k) - target);
+        while (flips < candidates.size()) {
+            size_t end = flips;
+            double drop = 0, big = 0;
+            for (; end < candidates.size() && candidates[end].first <= candidates[flips].first + 1e-9; ++end) {
+                size_t j = candidates[end].second;
+                drop += fabs(alpha(j)) * (this->bound[j].second - this->bound[j].first);
+                if (fabs(alpha(j)) > big) {
+                    big = fabs(alpha(j));
+                    q = j;
+                }
+            }
+            if (slope - drop <= 0) {
+                break;
+            }
+            slope -= drop;
+            flips = end;
+            q = total;
+        }
+        if (q == total) {
+            return optimization::simplex::status_t::INFEASIBLE;
+        }
+
+        d.setZero();
+        for (sparse_block::InnerIterator it(this->A, q); it; ++it) {
+            d(it.row()) = it.value();
+        }
+        this->ftran(d, true);
+        if (fabs(alpha(q) - d(r)) > 1e-7 * std::max(1.0, fabs(d(r))) && this->lu.updates > 0) {
+            if (!this->refactor()) {
+                return optimization::simplex::status_t::ITERATION_LIMIT;
+            }
+            continue;
+        }
+        if (flips > 0) {
+            delta.setZero();
+            for (size_t n = 0; n < flips; ++n) {
+                size_t j = candidates[n].second;
+                bool lower = this->state[j] == optimization::simplex::state_t::AT_LOWER;
+                double to = lower ? this->bound[j].second : this->bound[j].first, step = to - this->x(j);
+                this->state[j] = lower ? optimization::simplex::state_t::AT_UPPER : optimization::simplex::state_t::AT_LOWER;
+                this->x(j) = to;
+                for (sparse_block::InnerIterator it(this->A, j); it; ++it) {
+                    delta(it.row()) += it.value() * step;
+                }
+            }
+            this->ftran(delta);
+            for (size_t i = 0; i < this->rows; ++i) {
+                this->x(this->basis[i]) -= delta(i);
+            }
+        }
+
+        double ar = d(r), wr = this->weight(r), step = this->reduced(q) / alpha(q), move = (this->x(k) - target) / ar;
+        tau = rho;
+        this->ftran(tau);
+        for (size_t i = 0; i < this->rows; ++i) {
+            if (i != r && d(i) != 0) {
+                double kappa = d(i) / ar;
+                this->weight(i) = std::max(this->weight(i) - 2 * kappa * tau(i) + kappa * kappa * wr, 1e-4);
+            }
+        }
+        this->weight(r) = std::max(wr / (ar * ar), 1e-4);
+        for (size_t j : pattern) {
+            this->reduced(j) -= step * alpha(j);
+        }
+        this->reduced(q) = 0;
+        this->reduced(k) = -step;
+        this->x(q) += move;
+        for (size_t i = 0; i < this->rows; ++i) {
+            this->x(this->basis[i]) -= move * d(i);
+        }
+        this->state[k] = increase ? optimization::simplex::state_t::AT_LOWER : optimization::simplex::state_t::AT_UPPER;
+        this->x(k) = target;
+        this->basis[r] = q;
+        this->state[q] = optimization::simplex::state_t::BASIC;
+        if (!this->lu.update(r, ar) && !this->refactor()) {
+            return optimization::simplex::status_t::ITERATION_LIMIT;
+        }
+    }
+    return optimization::simplex::status_t::ITERATION_LIMIT;
+}
+
+optimization::simplex::status_t optimization::simplex::solve(size_t max_iter)
+{
+    size_t total = this->cols + this->rows;
+    this->build();
+    this->iter = 0;
+    size_t limit = max_iter > 0 ? max_iter : 100 * total + 10000;
+
+    // Rows added since the basis was saved come in with their slack basic.
+    if (this->state.size() >= this->cols && this->state.size() < total) {
+        this->state.resize(total, optimization::simplex::state_t::BASIC);
+    }
+    bool warm = this->state.size() == total;
+    if (warm) {
+        this->basis.clear();
+        for (size_t j = 0; j < total; ++j) {
+            int& s = this->state[j];
+            const range_t& b = this->bound[j];
+            if (s == optimization::simplex::state_t::BASIC) {
+                this->basis.push_back(j);
+            } else if (!std::isfinite(s == optimization::simplex::state_t::AT_UPPER ? b.second : b.first) || (s == optimization::simplex::state_t::AT_ZERO && std::isfinite(b.first))) {
+                s = std::isfinite(b.first) ? optimization::simplex::state_t::AT_LOWER : (std::isfinite(b.second) ? optimization::simplex::state_t::AT_UPPER : optimization::simplex::state_t::AT_ZERO);
+            }
+        }
+        warm = this->basis.size() == this->rows && this->factor();
+    }
+    if (!warm) {
+        this->cold_start();
+        this->factor();
+    }
+    this->compute_primal();
+
+    this->status = optimization::simplex::status_t::ITERATION_LIMIT;
+    for (size_t pass = 0; pass < 2; ++pass) {
+        if (this->infeasibility() > primal_tol && this->make_dual_feasible()) {
+            this->status = this->dual(limit);
+            if (this->status == optimization::simplex::status_t::INFEASIBLE || this->status == optimization::simplex::status_t::STOPPED) {
+                break;
+            }
+        }
+        this->status = this->primal(true, limit);
+        if (this->status == optimization::simplex::status_t::OPTIMAL) {
+            this->status = this->primal(false, limit);
+        }
+        if (this->status != optimization::simplex::status_t::OPTIMAL || !this->factor()) {
+            break;
+        }
+        this->compute_primal();
+        if (this->infeasibility() <= 1e3 * primal_tol) {
+            break;
+        }
+    }
+
+    if (this->status == optimization::simplex::status_t::OPTIMAL) {
+        this->compute_reduced();
+    }
+    this->sol = this->x.head(this->cols);
+    this->fval = this->c.col(0).dot(this->sol.col(0));
+    return this->status;
+}
+
+const real_block& optimization::simplex::solution() const
+{
+    return this->sol;
+}
+
+double optimization::simplex::obj() const
+{
+    return this->fval;
+}
+
+size_t optimization::simplex::iterations() const
+{
+    return this->iter;
+}
+
+const optimization::simplex::basis_t& optimization::simplex::get_basis() const
+{
+    return this->state;
+}
+
+double optimization::simplex::reduced_cost(size_t j) const
+{
+    return this->reduced(j);
+}
+
+const optimization::range_t& optimization::simplex::get_bound(size_t j) const
+{
+    return this->bound[j];
+}
+
+size_t optimization::simplex::gomory(const std::vector<char>& integer, size_t max_cuts, real_block& G, real_block& h) const
+{
+    std::vector<std::pair<double, size_t>> candidates;
+    for (size_t i = 0; i < this->rows; ++i) {
+        size_t k = this->basis[i];
+        if (k < this->cols && integer[k]) {
+            double f = this->x(k) - std::floor(this->x(k));
+            if (f > 0.01 && f < 0.99) {
+                candidates.push_back({ fabs(f - 0.5), i });
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    if (candidates.size() > max_cuts) {
+        candidates.resize(max_cuts);
+    }
+
+    G.setZero(candidates.size(), this->cols);
+    h.setZero(candidates.size(), 1);
+    size_t total = this->cols + this->rows, count = 0;
+    Eigen::VectorXd rho(this->rows), coef(this->cols), alpha;
+    for (const auto& cand : candidates) {
+        size_t i = cand.second;
+        double f0 = this->x(this->basis[i]) - std::floor(this->x(this->basis[i]));
+        rho.setZero();
+        rho(i) = 1;
+        this->btran(rho);
+        this->row_product(rho, alpha);
+
+        // sum g_j t_j >= 1 over the nonbasic distances t_j to the active bound,
+        // rewritten in the structural variables as coef' x >= 1 - shift.
+        coef.setZero();
+        double shift = 0;
+        bool valid = true;
+        for (size_t j = 0; valid && j < total; ++j) {
+            int s = this->state[j];
+            const range_t& b = this->bound[j];
+            if (s == optimization::simplex::state_t::BASIC || b.first == b.second || fabs(alpha(j)) < 1e-11) {
+                continue;
+            }
+            if (s == optimization::simplex::state_t::AT_ZERO) {
+                valid = false;
+                break;
+            }
+            double a = s == optimization::simplex::state_t::AT_LOWER ? alpha(j) : -alpha(j), g;
+            if (j < this->cols && integer[j]) {
+                double fj = a - std::floor(a);
+                g = fj <= f0 ? fj / f0 : (1 - fj) / (1 - f0);
+            } else {
+                g = a > 0 ? a / f0 : -a / (1 - f0);
+            }
+            if (g == 0) {
+                continue;
+            }
+            if (j < this->cols) {
+                if (s == optimization::simplex::state_t::AT_LOWER) {
+                    coef(j) += g;
+                    shift -= g * b.first;
+                } else {
+                    coef(j) -= g;
+                    shift += g * b.second;
+                }
+            } else {
+                size_t r = j - this->cols;
+                double sign = s == optimization::simplex::state_t::AT_LOWER ? 1 : -1, base = s == optimization::simplex::state_t::AT_LOWER ? b.first : b.second;
+                for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(this->AR, r); it && it.col() < static_cast<int>(this->cols); ++it) {
+                    coef(it.col()) -= sign * g * it.value();
+                }
+                shift += sign * g * (this->rhs[r] - base);
+            }
+        }
+        double big = coef.cwiseAbs().maxCoeff();
+        if (!valid || big == 0 || big > 1e8 || !std::isfinite(shift)) {
+            continue;
+        }
+        G.row(count) = -coef.transpose();
+        h(count, 0) = shift - 1;
+        ++count;
+    }
+    G.conservativeResize(count, this->cols);
+    h.conservativeResize(count, 1);
+    return count;
+}
+}
@@ -0,0 +1,105 @@
+#include "trace.hpp"
+#include <cmath>
+#include <fstream>
+
+namespace anyprog {
+
+static std::atomic<size_t> trace_serial(0);
+
+trace_recorder::trace_recorder(size_t capacity)
+    : capacity(capacity > 0 ? capacity : 1)
+    , serial(++trace_serial)
+    , origin(clock_t::now())
+    , lock()
+    , ring()
+{
+}
+
+// The ring of the calling thread. The thread remembers the last recorder it wrote
+// to by serial number, so a recorder at a reused address is never mistaken for it.
+trace_recorder::ring_t& trace_recorder::local()
+{
+    thread_local size_t last_serial = 0;
+    thread_local ring_t* last_ring = 0;
+    if (last_serial == this->serial) {
+        return *last_ring;
+    }
+    std::lock_guard<std::mutex> guard(this->lock);
+    std::thread::id id = std::this_thread::get_id();
+    ring_t* r = 0;
+    for (const auto& i : this->ring) {
+        if (i->owner == id) {
+            r = i.get();
+            break;
+        }
+    }
+    if (!r) {
+        this->ring.emplace_back(new ring_t());
+        r = this->ring.back().get();
+        r->event.resize(this->capacity);
+        r->next = 0;
+        r->owner = id;
+    }
+    last_serial = this->serial;
+    last_ring = r;
+    return *r;
+}
+
+void trace_recorder::push(const char* name, char phase, double begin, double length, double value)
+{
+    ring_t& r = this->local();
+    size_t n = r.next.load(std::memory_order_relaxed);
+    event_t& e = r.event[n % this->capacity];
+    e.name = name;
+    e.phase = phase;
+    e.begin = begin;
+    e.length = length;
+    e.value = value;
+    r.next.store(n + 1, std::memory_order_release);
+}
+
+void trace_recorder::span(const char* name, clock_t::time_point begin, clock_t::time_point end)
+{
+    std::chrono::duration<double, std::micro> from = begin - this->origin, length = end - begin;
+    this->push(name, 'X', from.count(), length.count(), 0);
+}
+
+void trace_recorder::counter(const char* name, double value)
+{
+    std::chrono::duration<double, std::micro> from = clock_t::now() - this->origin;
+    this->push(name, 'C', from.count(), 0, value);
+}
+
+// One trace-event object: spans are complete ("X") events, counters carry their value
+// in args, and every ring becomes a thread of process 1.
+bool trace_recorder::write(const std::string& path)
+{
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out.precision(15);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    std::lock_guard<std::mutex> guard(this->lock);
+    bool first = true;
+    for (size_t t = 0; t < this->ring.size(); ++t) {
+        const ring_t& r = *this->ring[t];
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t << ",\"args\":{\"name\":\"thread " << t << "\"}}";
+        first = false;
+        size_t end = r.next.load(std::memory_order_acquire), begin = end > this->capacity ? end - this->capacity : 0;
+        for (size_t i = begin; i < end; ++i) {
+            const event_t& e = r.event[i % this->capacity];
+            out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"" << e.phase << "\",\"pid\":1,\"tid\":" << t << ",\"ts\":" << e.begin;
+            if (e.phase == 'X') {
+                out << ",\"dur\":" << e.length << "}";
+            } else if (std::isfinite(e.value)) {
+                out << ",\"args\":{\"value\":" << e.value << "}}";
+            } else {
+                out << ",\"args\":{}}";
+            }
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+}
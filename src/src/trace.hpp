@@ -0,0 +1,75 @@
+#ifndef ANYPROG_TRACE_HPP
+#define ANYPROG_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace anyprog {
+
+// Timeline of spans and counters written in the Chrome trace-event format, which
+// Perfetto and chrome://tracing open. Every thread records into a ring of its own
+// without locking and the ring keeps its newest `capacity` events; a thread takes the
+// lock only to find its ring when it records for a recorder it did not use last.
+// Event names must be string literals. write() reads the rings unlocked, so call it
+// when no solve is running.
+class trace_recorder {
+public:
+    typedef std::chrono::steady_clock clock_t;
+
+private:
+    class event_t {
+    public:
+        const char* name;
+        char phase;
+        double begin, length, value;
+    };
+    class ring_t {
+    public:
+        std::vector<event_t> event;
+        std::atomic<size_t> next;
+        std::thread::id owner;
+    };
+    size_t capacity, serial;
+    clock_t::time_point origin;
+    std::mutex lock;
+    std::vector<std::unique_ptr<ring_t>> ring;
+    ring_t& local();
+    void push(const char*, char, double, double, double);
+
+public:
+    trace_recorder(size_t capacity);
+    virtual ~trace_recorder() = default;
+    void span(const char*, clock_t::time_point, clock_t::time_point);
+    void counter(const char*, double);
+    bool write(const std::string&);
+};
+
+// Records one span from construction to destruction; costs a null test without a recorder.
+class trace_span {
+private:
+    trace_recorder* trace;
+    const char* name;
+    trace_recorder::clock_t::time_point begin;
+
+public:
+    trace_span(trace_recorder* trace, const char* name)
+        : trace(trace)
+        , name(name)
+        , begin(trace ? trace_recorder::clock_t::now() : trace_recorder::clock_t::time_point())
+    {
+    }
+    virtual ~trace_span()
+    {
+        if (this->trace) {
+            this->trace->span(this->name, this->begin, trace_recorder::clock_t::now());
+        }
+    }
+};
+}
+
+#endif
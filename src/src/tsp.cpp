@@ -0,0 +1,725 @@
+#include "optimization.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+
+namespace anyprog {
+
+static const double tsp_gain = 1e-9;
+
+size_t optimization::tsp::neighbors = 10;
+size_t optimization::tsp::max_depth = 10;
+
+// A tour kept as an array of cities plus each city's position. Walking order is
+// read through next()/prev() under an orientation flag, so reversing a path can
+// always rewrite the shorter side of the cycle: reversing the complement and
+// flipping the flag leaves the same directed tour.
+template <typename M>
+class tsp_tour {
+private:
+    const M& d;
+    const std::vector<std::vector<size_t>>& near;
+    size_t n;
+    std::vector<size_t> order, pos;
+    bool reversed;
+
+public:
+    tsp_tour(const M& d, const std::vector<std::vector<size_t>>& near, const std::vector<size_t>& order)
+        : d(d)
+        , near(near)
+        , n(order.size())
+        , order(order)
+        , pos(order.size())
+        , reversed(false)
+    {
+        for (size_t i = 0; i < this->n; ++i) {
+            this->pos[this->order[i]] = i;
+        }
+    }
+
+    size_t next(size_t c) const
+    {
+        size_t p = this->pos[c];
+        return this->reversed ? this->order[p == 0 ? this->n - 1 : p - 1] : this->order[p + 1 == this->n ? 0 : p + 1];
+    }
+
+    size_t prev(size_t c) const
+    {
+        size_t p = this->pos[c];
+        return this->reversed ? this->order[p + 1 == this->n ? 0 : p + 1] : this->order[p == 0 ? this->n - 1 : p - 1];
+    }
+
+    // Reverses the path that runs from x forward to y.
+    void reverse_path(size_t x, size_t y)
+    {
+        size_t i = this->pos[x], j = this->pos[y];
+        if (this->reversed) {
+            std::swap(i, j);
+        }
+        size_t len = (j + this->n - i) % this->n + 1;
+        if (2 * len > this->n) {
+            size_t k = i;
+            i = (j + 1) % this->n;
+            j = (k + this->n - 1) % this->n;
+            len = this->n - len;
+            this->reversed = !this->reversed;
+        }
+        for (size_t k = 0; k < len / 2; ++k) {
+            size_t a = this->order[i], b = this->order[j];
+            this->order[i] = b;
+            this->order[j] = a;
+            this->pos[b] = i;
+            this->pos[a] = j;
+            i = i + 1 == this->n ? 0 : i + 1;
+            j = j == 0 ? this->n - 1 : j - 1;
+        }
+    }
+
+    void flip_view()
+    {
+        this->reversed = !this->reversed;
+    }
+
+    // Lin-Kernighan chain from t1 built out of 2-opt flips: break (t1, t2), join t2 to
+    // a candidate t3, break (t4, t3) with t4 = prev(t3) and continue from the new edge
+    // (t1, t4). The prefix of flips with the best closing gain is kept.
+    bool lin_kernighan(size_t t1, std::vector<size_t>& touched)
+    {
+        size_t t2 = this->next(t1);
+        double g = this->d(t1, t2), best = tsp_gain;
+        std::vector<std::pair<size_t, size_t>> flips;
+        std::vector<size_t> joined;
+        size_t keep = 0;
+        for (size_t depth = 0; depth < optimization::tsp::max_depth; ++depth) {
+            size_t t3 = this->n, t4 = this->n;
+            double score = -std::numeric_limits<double>::infinity();
+            for (const auto& c : this->near[t2]) {
+                double g1 = g - this->d(t2, c);
+                if (g1 <= 0) {
+                    break;
+                }
+                if (c == t1 || c == this->next(t2) || std::find(joined.begin(), joined.end(), c) != joined.end()) {
+                    continue;
+                }
+                size_t p = this->prev(c);
+                double s = this->d(p, c) - this->d(t2, c);
+                if (s > score) {
+                    score = s;
+                    t3 = c;
+                    t4 = p;
+                }
+            }
+            if (t3 == this->n) {
+                break;
+            }
+            g -= this->d(t2, t3);
+            this->reverse_path(t2, t4);
+            flips.push_back({ t4, t2 });
+            g += this->d(t4, t3);
+            joined.push_back(t3);
+            if (g - this->d(t4, t1) > best) {
+                best = g - this->d(t4, t1);
+                keep = flips.size();
+            }
+            t2 = t4;
+        }
+        while (flips.size() > keep) {
+            this->reverse_path(flips.back().first, flips.back().second);
+            flips.pop_back();
+        }
+        if (keep == 0) {
+            return false;
+        }
+        touched.push_back(t1);
+        for (const auto& i : flips) {
+            touched.push_back(i.first);
+            touched.push_back(i.second);
+        }
+        touched.insert(touched.end(), joined.begin(), joined.begin() + keep);
+        return true;
+    }
+
+    // Or-opt: moves the segment of one to three cities starting at s1 between a
+    // candidate neighbour c and e = next(c), optionally reversed. The move is carried
+    // out as two or three path reversals.
+    bool or_opt(size_t s1, bool symmetric, std::vector<size_t>& touched)
+    {
+        size_t s2 = s1;
+        for (size_t len = 1; len <= 3 && len + 2 <= this->n; ++len) {
+            if (len > 1) {
+                s2 = this->next(s2);
+            }
+            size_t p = this->prev(s1), q = this->next(s2);
+            double removed = this->d(p, s1) + this->d(s2, q) - this->d(p, q);
+            if (removed <= tsp_gain) {
+                continue;
+            }
+            auto inside = [&](size_t c) {
+                for (size_t k = 0, x = s1; k < len; ++k, x = this->next(x)) {
+                    if (x == c) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+            size_t bc = this->n, be = this->n;
+            bool flip = false;
+            double best = tsp_gain;
+            for (const auto& end : { s1, s2 }) {
+                for (const auto& x : this->near[end]) {
+                    for (size_t side = 0; side < 2; ++side) {
+                        size_t c = side == 0 ? x : this->prev(x), e = side == 0 ? this->next(x) : x;
+                        if (inside(c) || inside(e)) {
+                            continue;
+                        }
+                        double base = removed + this->d(c, e), forward = base - this->d(c, s1) - this->d(s2, e);
+                        if (forward > best) {
+                            best = forward;
+                            bc = c;
+                            be = e;
+                            flip = false;
+                        }
+                        if (symmetric || len == 1) {
+                            double backward = base - this->d(c, s2) - this->d(s1, e);
+                            if (backward > best) {
+                                best = backward;
+                                bc = c;
+                                be = e;
+                                flip = true;
+                            }
+                        }
+                    }
+                }
+            }
+            if (bc == this->n) {
+                continue;
+            }
+            this->reverse_path(s1, bc);
+            this->reverse_path(bc, q);
+            if (!flip && len > 1) {
+                this->reverse_path(s2, s1);
+            }
+            touched.insert(touched.end(), { p, q, s1, s2, bc, be });
+            return true;
+        }
+        return false;
+    }
+
+    void optimize(bool symmetric)
+    {
+        this->optimize(symmetric, std::vector<size_t>(this->order));
+    }
+
+    // Local search whose don't-look queue starts with the cities in `seed` only.
+    void optimize(bool symmetric, const std::vector<size_t>& seed)
+    {
+        std::deque<size_t> queue;
+        std::vector<char> active(this->n, 0);
+        for (const auto& c : seed) {
+            if (!active[c]) {
+                active[c] = 1;
+                queue.push_back(c);
+            }
+        }
+        std::vector<size_t> touched;
+        while (!queue.empty()) {
+            size_t t1 = queue.front();
+            queue.pop_front();
+            active[t1] = 0;
+            touched.clear();
+            bool improved = false;
+            if (symmetric) {
+                for (size_t dir = 0; dir < 2 && !improved; ++dir) {
+                    improved = (this->n >= 5 && this->lin_kernighan(t1, touched)) || this->or_opt(t1, true, touched);
+                    this->flip_view();
+                }
+            } else {
+                improved = this->or_opt(t1, false, touched);
+            }
+            if (improved) {
+                for (const auto& c : touched) {
+                    if (!active[c]) {
+                        active[c] = 1;
+                        queue.push_back(c);
+                    }
+                }
+            }
+        }
+    }
+
+    double length() const
+    {
+        double ret = 0;
+        for (size_t i = 0; i < this->n; ++i) {
+            ret += this->d(this->order[i], this->next(this->order[i]));
+        }
+        return ret;
+    }
+
+    std::vector<size_t> walk(size_t start) const
+    {
+        std::vector<size_t> ret;
+        ret.reserve(this->n + 1);
+        size_t c = start;
+        do {
+            ret.push_back(c);
+            c = this->next(c);
+        } while (c != start);
+        ret.push_back(start);
+        return ret;
+    }
+};
+
+template <typename M>
+static std::vector<size_t> nearest_neighbor_tour(const M& d, size_t first)
+{
+    size_t n = d.rows();
+    std::vector<size_t> ret(1, first);
+    std::vector<char> visited(n, 0);
+    visited[first] = 1;
+    for (size_t cur = first; ret.size() < n;) {
+        size_t best = n;
+        for (size_t j = 0; j < n; ++j) {
+            if (!visited[j] && (best == n || d(cur, j) < d(cur, best))) {
+                best = j;
+            }
+        }
+        visited[best] = 1;
+        ret.push_back(best);
+        cur = best;
+    }
+    return ret;
+}
+
+// The `neighbors` nearest cities of every city by a full scan of its row, which for
+// an asymmetric matrix ranks by the round trip c(i, j) + c(j, i).
+template <typename M>
+static std::vector<std::vector<size_t>> dense_candidates(const M& c, double inf, size_t threads, bool symmetric)
+{
+    size_t n = c.rows();
+    std::vector<std::vector<size_t>> near(n);
+    if (n == 0) {
+        return near;
+    }
+    size_t k = std::min(optimization::tsp::neighbors, n - 1);
+    parallel::for_each_block(n, threads, [&](size_t begin, size_t end) {
+        std::vector<std::pair<double, size_t>> row;
+        for (size_t i = begin; i < end; ++i) {
+            row.clear();
+            for (size_t j = 0; j < n; ++j) {
+                double v = symmetric ? c(i, j) : c(i, j) + c(j, i);
+                if (j != i && c(i, j) < inf) {
+                    row.push_back({ v, j });
+                }
+            }
+            size_t m = std::min(k, row.size());
+            std::partial_sort(row.begin(), row.begin() + m, row.end());
+            for (size_t t = 0; t < m; ++t) {
+                near[i].push_back(row[t].second);
+            }
+        }
+    });
+    return near;
+}
+
+// City pairs priced from a sparse candidate graph, looking in both columns, and by f
+// for pairs the graph does not hold.
+class tsp_candidate_block {
+private:
+    const optimization::assignment::sparse_block& g;
+    const std::vector<optimization::tsp::point2d_t>& point;
+    const optimization::tsp::point2d_distance_function_t& f;
+
+    bool find(size_t i, size_t j, double& v) const
+    {
+        const int *first = this->g.innerIndexPtr() + this->g.outerIndexPtr()[i], *last = this->g.innerIndexPtr() + this->g.outerIndexPtr()[i + 1];
+        const int* it = std::lower_bound(first, last, static_cast<int>(j));
+        if (it == last || *it != static_cast<int>(j)) {
+            return false;
+        }
+        v = this->g.valuePtr()[it - this->g.innerIndexPtr()];
+        return true;
+    }
+
+public:
+    tsp_candidate_block(const optimization::assignment::sparse_block& g, const std::vector<optimization::tsp::point2d_t>& point, const optimization::tsp::point2d_distance_function_t& f)
+        : g(g)
+        , point(point)
+        , f(f)
+    {
+    }
+    size_t rows() const { return this->point.size(); }
+    double operator()(size_t i, size_t j) const
+    {
+        double v;
+        if (this->find(i, j, v) || this->find(j, i, v)) {
+            return v;
+        }
+        return this->f(this->point[i], this->point[j]);
+    }
+};
+
+// Candidate lists read from the columns of a sparse graph, nearest first.
+static std::vector<std::vector<size_t>> graph_candidates(const optimization::assignment::sparse_block& g)
+{
+    std::vector<std::vector<size_t>> near(g.cols());
+    std::vector<std::pair<double, size_t>> column;
+    for (size_t i = 0; i < near.size(); ++i) {
+        column.clear();
+        for (optimization::assignment::sparse_block::InnerIterator it(g, i); it; ++it) {
+            if (static_cast<size_t>(it.row()) != i) {
+                column.push_back({ it.value(), it.row() });
+            }
+        }
+        std::sort(column.begin(), column.end());
+        for (const auto& j : column) {
+            near[i].push_back(j.second);
+        }
+    }
+    return near;
+}
+
+// Cities sorted by their index along a Hilbert curve laid over the bounding box of
+// the coordinates on a 2^16 x 2^16 grid.
+static std::vector<size_t> hilbert_order(const std::vector<optimization::tsp::point2d_t>& point)
+{
+    size_t n = point.size();
+    const double side = 65535;
+    double x0 = std::numeric_limits<double>::infinity(), x1 = -x0, y0 = x0, y1 = -x0;
+    for (const auto& p : point) {
+        x0 = std::min(x0, p.first);
+        x1 = std::max(x1, p.first);
+        y0 = std::min(y0, p.second);
+        y1 = std::max(y1, p.second);
+    }
+    double sx = x1 > x0 ? side / (x1 - x0) : 0, sy = y1 > y0 ? side / (y1 - y0) : 0;
+    std::vector<std::pair<uint64_t, size_t>> key(n);
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t x = static_cast<uint64_t>((point[i].first - x0) * sx), y = static_cast<uint64_t>((point[i].second - y0) * sy), d = 0;
+        for (uint64_t s = 1 << 15; s > 0; s >>= 1) {
+            uint64_t rx = (x & s) > 0, ry = (y & s) > 0;
+            d += s * s * ((3 * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = s - 1 - (x & (s - 1));
+                    y = s - 1 - (y & (s - 1));
+                }
+                std::swap(x, y);
+            }
+        }
+        key[i] = { d, i };
+    }
+    std::sort(key.begin(), key.end());
+    std::vector<size_t> ret(n);
+    for (size_t i = 0; i < n; ++i) {
+        ret[i] = key[i].second;
+    }
+    return ret;
+}
+
+// Nearest neighbour tour restricted to the candidate lists: from a city whose
+// candidates are all visited it moves on to the next unvisited city along `curve`
+// (rank[c] is the position of c on it), found through path-compressed skip links.
+static std::vector<size_t> candidate_tour(const std::vector<std::vector<size_t>>& near, const std::vector<size_t>& curve, const std::vector<size_t>& rank, size_t first)
+{
+    size_t n = curve.size();
+    std::vector<size_t> ret, skip(n + 1);
+    std::vector<char> visited(n, 0);
+    for (size_t s = 0; s <= n; ++s) {
+        skip[s] = s;
+    }
+    auto unvisited = [&](size_t s) {
+        size_t r = s;
+        while (skip[r] != r) {
+            r = skip[r];
+        }
+        while (skip[s] != r) {
+            size_t t = skip[s];
+            skip[s] = r;
+            s = t;
+        }
+        return r;
+    };
+    ret.reserve(n);
+    for (size_t cur = first; ret.size() < n;) {
+        visited[cur] = 1;
+        skip[rank[cur]] = rank[cur] + 1;
+        ret.push_back(cur);
+        if (ret.size() == n) {
+            break;
+        }
+        size_t next = n;
+        for (const auto& c : near[cur]) {
+            if (!visited[c]) {
+                next = c;
+                break;
+            }
+        }
+        if (next == n) {
+            size_t s = unvisited(rank[cur]);
+            next = curve[s == n ? unvisited(0) : s];
+        }
+        cur = next;
+    }
+    return ret;
+}
+
+optimization::tsp::tsp(const real_block& c, size_t start, double inf, size_t starts, size_t threads)
+    : start(start)
+    , sum(0)
+    , path()
+    , report()
+{
+    bool symmetric = c == c.transpose();
+    this->run(c, dense_candidates(c, inf, threads, symmetric), [&](size_t first) { return nearest_neighbor_tour(c, first); }, starts, threads, symmetric);
+}
+
+template <typename T>
+optimization::tsp::tsp(const packed_block<T>& c, size_t start, double inf, size_t starts, size_t threads)
+    : start(start)
+    , sum(0)
+    , path()
+    , report()
+{
+    this->run(c, dense_candidates(c, inf, threads, true), [&](size_t first) { return nearest_neighbor_tour(c, first); }, starts, threads, true);
+}
+
+template optimization::tsp::tsp(const packed_block<float>&, size_t, double, size_t, size_t);
+template optimization::tsp::tsp(const packed_block<double>&, size_t, double, size_t, size_t);
+
+optimization::tsp::tsp(const assignment::sparse_block& candidates, const std::vector<point2d_t>& point, const point2d_distance_function_t& f, size_t start, size_t starts, size_t threads)
+    : start(start)
+    , sum(0)
+    , path()
+    , report()
+{
+    size_t n = point.size();
+    tsp_candidate_block c(candidates, point, f);
+    std::vector<std::vector<size_t>> near = graph_candidates(candidates);
+    std::vector<size_t> curve = hilbert_order(point), rank(n);
+    for (size_t s = 0; s < n; ++s) {
+        rank[curve[s]] = s;
+    }
+    this->run(c, near, [&](size_t first) { return candidate_tour(near, curve, rank, first); }, starts, threads, true);
+}
+
+optimization::tsp::tsp(const std::vector<point2d_t>& point, const point2d_distance_function_t& f, size_t cluster_size, size_t start, size_t threads, bool geographic)
+    : start(start)
+    , sum(0)
+    , path()
+    , report()
+{
+    size_t n = point.size();
+    if (n == 0) {
+        return;
+    }
+    auto clock = std::chrono::steady_clock::now();
+    std::vector<size_t> curve = hilbert_order(point);
+    size_t m = (n + std::max<size_t>(cluster_size, 1) - 1) / std::max<size_t>(cluster_size, 1);
+    std::vector<std::vector<size_t>> cycle(m);
+    parallel::ordered_for_each(
+        m, threads,
+        [&](size_t b, size_t) {
+            std::vector<size_t>& city = cycle[b];
+            city.assign(curve.begin() + b * n / m, curve.begin() + (b + 1) * n / m);
+            std::vector<point2d_t> local(city.size());
+            for (size_t i = 0; i < city.size(); ++i) {
+                local[i] = point[city[i]];
+            }
+            neighbor_index index(local, geographic);
+            tsp sub(index.candidates(optimization::tsp::neighbors, f, 1), local, f, 0, 1, 1);
+            std::vector<size_t> tour(sub.solve().begin(), sub.solve().end() - 1);
+            for (auto& c : tour) {
+                c = city[c];
+            }
+            city.swap(tour);
+        },
+        [](size_t) { return true; });
+    auto now = std::chrono::steady_clock::now();
+    this->report.clusters = m;
+    this->report.route_seconds = std::chrono::duration<double>(now - clock).count();
+    clock = now;
+
+    std::vector<size_t> order, seed;
+    order.reserve(n);
+    for (size_t b = 0; b < m; ++b) {
+        const std::vector<size_t>& c = cycle[b];
+        size_t s = c.size(), cut = 0;
+        bool forward = true;
+        double best = std::numeric_limits<double>::infinity();
+        for (size_t t = 0; s > 1 && t < s; ++t) {
+            size_t x = c[t], y = c[(t + 1) % s];
+            double edge = f(point[x], point[y]);
+            if (order.empty()) {
+                if (-edge < best) {
+                    best = -edge;
+                    cut = t;
+                }
+                continue;
+            }
+            size_t e = order.back();
+            for (const auto& dir : { true, false }) {
+                double v = f(point[e], point[dir ? y : x]) - edge;
+                if (v < best) {
+                    best = v;
+                    cut = t;
+                    forward = dir;
+                }
+            }
+        }
+        if (!order.empty()) {
+            seed.push_back(order.back());
+        }
+        for (size_t k = 0; k < s; ++k) {
+            order.push_back(forward ? c[(cut + 1 + k) % s] : c[(cut + s - k) % s]);
+        }
+        seed.push_back(order[order.size() - s]);
+        seed.push_back(order.back());
+    }
+    assignment::sparse_block graph = neighbor_index(point, geographic).candidates(optimization::tsp::neighbors, f, threads);
+    tsp_candidate_block c(graph, point, f);
+    std::vector<std::vector<size_t>> near = graph_candidates(graph);
+    for (size_t k = 0, count = seed.size(); k < count; ++k) {
+        seed.insert(seed.end(), near[seed[k]].begin(), near[seed[k]].end());
+    }
+    tsp_tour<tsp_candidate_block> tour(c, near, order);
+    this->report.joined = tour.length();
+    tour.optimize(true, seed);
+    this->path = tour.walk(this->start);
+    this->sum = tour.length();
+    this->report.stitch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - clock).count();
+}
+
+template <typename M, typename I>
+void optimization::tsp::run(const M& c, const std::vector<std::vector<size_t>>& near, const I& initial, size_t starts, size_t threads, bool symmetric)
+{
+    size_t n = c.rows(), start = this->start;
+    if (n == 0) {
+        return;
+    }
+    if (n == 1) {
+        // A single city is a closed tour of length 0, whatever its diagonal holds.
+        this->path = { 0, 0 };
+        return;
+    }
+    starts = std::max<size_t>(starts, 1);
+    std::vector<std::vector<size_t>> tours(starts);
+    std::vector<double> lengths(starts);
+    double best = std::numeric_limits<double>::infinity();
+    parallel::ordered_for_each(
+        starts, threads,
+        [&](size_t i, size_t) {
+            tsp_tour<M> tour(c, near, initial((start + i * n / starts) % n));
+            tour.optimize(symmetric);
+            tours[i] = tour.walk(start);
+            lengths[i] = tour.length();
+        },
+        [&](size_t i) {
+            if (lengths[i] < best) {
+                best = lengths[i];
+                this->path.swap(tours[i]);
+            }
+            return true;
+        });
+    this->sum = best;
+}
+
+const std::vector<size_t>& optimization::tsp::solve() const
+{
+    return this->path;
+}
+
+double optimization::tsp::obj() const
+{
+    return this->sum;
+}
+
+const optimization::tsp::decomposition_t& optimization::tsp::decomposition() const
+{
+    return this->report;
+}
+
+// Hands out the rows of the upper triangle to `threads` threads; set(i, j, v) stores
+// the distance of each pair i < j.
+template <typename S>
+static void upper_triangle(const std::vector<optimization::tsp::point2d_t>& gps, const optimization::tsp::point2d_distance_function_t& f, size_t threads, const S& set)
+{
+    size_t dim = gps.size();
+    parallel::ordered_for_each(
+        dim, threads,
+        [&](size_t i, size_t) {
+            for (size_t j = i + 1; j < dim; ++j) {
+                set(i, j, f(gps[i], gps[j]));
+            }
+        },
+        [](size_t) { return true; });
+}
+
+real_block optimization::tsp::distance(const std::vector<optimization::tsp::point2d_t>& gps, const optimization::tsp::point2d_distance_function_t& f, double inf, size_t threads)
+{
+    size_t dim = gps.size();
+    anyprog::real_block dis(dim, dim);
+    upper_triangle(gps, f, threads, [&](size_t i, size_t j, double v) {
+        dis(i, j) = v;
+        dis(j, i) = v;
+    });
+    dis.diagonal().setConstant(inf);
+    return dis;
+}
+
+template <typename T>
+optimization::tsp::packed_block<T> optimization::tsp::packed_distance(const std::vector<optimization::tsp::point2d_t>& gps, const optimization::tsp::point2d_distance_function_t& f, double inf, size_t threads)
+{
+    size_t dim = gps.size();
+    packed_block<T> dis(dim);
+    upper_triangle(gps, f, threads, [&](size_t i, size_t j, double v) {
+        dis(i, j) = v;
+    });
+    for (size_t i = 0; i < dim; ++i) {
+        dis(i, i) = inf;
+    }
+    return dis;
+}
+
+template optimization::tsp::packed_block<float> optimization::tsp::packed_distance<float>(const std::vector<optimization::tsp::point2d_t>&, const optimization::tsp::point2d_distance_function_t&, double, size_t);
+template optimization::tsp::packed_block<double> optimization::tsp::packed_distance<double>(const std::vector<optimization::tsp::point2d_t>&, const optimization::tsp::point2d_distance_function_t&, double, size_t);
+
+void optimization::tsp::distance_tiles(const std::vector<optimization::tsp::point2d_t>& gps, const optimization::tsp::point2d_distance_function_t& f, const optimization::tsp::tile_function_t& out, size_t tile, double inf, size_t threads)
+{
+    tile = std::max<size_t>(1, tile);
+    size_t dim = gps.size(), count = (dim + tile - 1) / tile, wave_size = parallel::thread_number(threads);
+    std::vector<std::pair<size_t, size_t>> tiles;
+    for (size_t r = 0; r < count; ++r) {
+        for (size_t c = r; c < count; ++c) {
+            tiles.push_back({ r * tile, c * tile });
+        }
+    }
+    std::vector<real_block> wave(wave_size);
+    for (size_t first = 0; first < tiles.size(); first += wave_size) {
+        size_t last = std::min(tiles.size(), first + wave_size);
+        parallel::for_each_block(last - first, threads, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                size_t row = tiles[first + k].first, col = tiles[first + k].second;
+                size_t rows = std::min(tile, dim - row), cols = std::min(tile, dim - col);
+                real_block& block = wave[k];
+                block.resize(rows, cols);
+                for (size_t j = 0; j < cols; ++j) {
+                    for (size_t i = 0; i < rows; ++i) {
+                        size_t a = row + i, b = col + j;
+                        block(i, j) = a < b ? f(gps[a], gps[b]) : inf;
+                    }
+                }
+                if (row == col) {
+                    block.triangularView<Eigen::StrictlyLower>() = block.transpose().eval();
+                }
+            }
+        });
+        for (size_t k = first; k < last; ++k) {
+            out(tiles[k].first, tiles[k].second, wave[k - first]);
+        }
+    }
+}
+}
@@ -1,4 +1,5 @@
 #include "util.hpp"
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 
@@ -42,13 +43,13 @@ double gps_distance(double lat1, double lon1, double lat2, double lon2, double u
         sigma = atan2(sinSigma, cosSigma);
         double sinAlpha = cosU1 * cosU2 * sinLambda / sinSigma;
         cosSqAlpha = 1 - sinAlpha * sinAlpha;
-        cos2SigmaM = cosSigma - 2 * sinU1 * sinU2 / cosSqAlpha;
+        cos2SigmaM = cosSqAlpha != 0 ? cosSigma - 2 * sinU1 * sinU2 / cosSqAlpha : 0;
 
         double C = f / 16 * cosSqAlpha * (4 + f * (4 - 3 * cosSqAlpha));
         lambdaP = lambda;
         lambda = L + (1 - C) * f * sinAlpha * (sigma + C * sinSigma * (cos2SigmaM + C * cosSigma * (-1 + 2 * cos2SigmaM * cos2SigmaM)));
 
-    } while (abs(lambda - lambdaP) > 1e-12 && --iterLimit > 0);
+    } while (fabs(lambda - lambdaP) > 1e-12 && --iterLimit > 0);
 
     if (iterLimit == 0) {
         return 0;
@@ -65,4 +66,58 @@ double gps_distance(double lat1, double lon1, double lat2, double lon2, double u
     return s / u;
 }
 
-}
\ No newline at end of file
+// Spherical central angle by the haversine formula, on latitudes lat1 and lat2 in
+// radians and a longitude difference dlon in radians.
+static double gps_central_angle(double lat1, double lat2, double dlon)
+{
+    double sinLat = sin((lat2 - lat1) / 2), sinLon = sin(dlon / 2);
+    double h = sinLat * sinLat + cos(lat1) * cos(lat2) * sinLon * sinLon;
+    return 2 * asin(sqrt(std::min(1.0, h)));
+}
+
+static void gps_haversine(const double* lat1, const double* lon1, const double* lat2, const double* lon2,
+    double* out, size_t n, double u)
+{
+    const double r = 6371008.8 / u;
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = r * gps_central_angle(to_radians(lat1[i]), to_radians(lat2[i]), to_radians(lon2[i] - lon1[i]));
+    }
+}
+
+// Andoyer-Lambert: the central angle sigma between the reduced latitudes, corrected by
+// f / 2 (X + Y) with X and Y from the mean P and half difference Q of those latitudes.
+static void gps_andoyer(const double* lat1, const double* lon1, const double* lat2, const double* lon2,
+    double* out, size_t n, double u)
+{
+    const double a = 6378137 / u, f = 1 / 298.257223563;
+    for (size_t i = 0; i < n; ++i) {
+        double b1 = atan((1 - f) * tan(to_radians(lat1[i])));
+        double b2 = atan((1 - f) * tan(to_radians(lat2[i])));
+        double sigma = gps_central_angle(b1, b2, to_radians(lon2[i] - lon1[i]));
+        double sinP = sin((b1 + b2) / 2), cosP = cos((b1 + b2) / 2);
+        double sinQ = sin((b2 - b1) / 2), cosQ = cos((b2 - b1) / 2);
+        double sinHalf = sin(sigma / 2), cosHalf = cos(sigma / 2), sinSigma = sin(sigma);
+        double X = cosHalf != 0 ? (sigma - sinSigma) * sinP * sinP * cosQ * cosQ / (cosHalf * cosHalf) : 0;
+        double Y = sinHalf != 0 ? (sigma + sinSigma) * cosP * cosP * sinQ * sinQ / (sinHalf * sinHalf) : 0;
+        out[i] = a * (sigma - f / 2 * (X + Y));
+    }
+}
+
+void gps_distance(const double* lat1, const double* lon1, const double* lat2, const double* lon2,
+    double* out, size_t n, double u, gps_distance_method_t method)
+{
+    switch (method) {
+    case ANDOYER:
+        gps_andoyer(lat1, lon1, lat2, lon2, out, n, u);
+        break;
+    case HAVERSINE:
+        gps_haversine(lat1, lon1, lat2, lon2, out, n, u);
+        break;
+    default:
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = gps_distance(lat1[i], lon1[i], lat2[i], lon2[i], u);
+        }
+        break;
+    }
+}
+}
@@ -0,0 +1,598 @@
+#include "optimization.hpp"
+#include "parallel.hpp"
+#include "random.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+namespace anyprog {
+
+static const size_t vrp_npos = static_cast<size_t>(-1);
+static const double vrp_inf = std::numeric_limits<double>::infinity();
+
+size_t optimization::vrp::neighbors = 30;
+size_t optimization::vrp::segment = 100;
+size_t optimization::vrp::max_iterations = 1000000;
+
+// The problem data every worker reads: near[u] lists the stops nearest to u, and the
+// stranded stops cannot be served even by a vehicle of their own.
+class vrp_instance {
+public:
+    const real_block &c, &travel, &demand, &service;
+    const std::vector<optimization::range_t>& window;
+    double capacity, penalty;
+    size_t n, depot;
+    bool timed;
+    std::vector<std::vector<size_t>> near;
+    std::vector<char> stranded;
+
+    vrp_instance(const real_block& c, const real_block& travel, const real_block& demand, const real_block& service, const std::vector<optimization::range_t>& window, double capacity, size_t depot)
+        : c(c)
+        , travel(travel)
+        , demand(demand)
+        , service(service)
+        , window(window)
+        , capacity(capacity)
+        , penalty(0)
+        , n(c.rows())
+        , depot(depot)
+        , timed(!window.empty())
+        , near(c.rows())
+        , stranded(c.rows(), 0)
+    {
+    }
+
+    // The time a vehicle can leave stop a, or the depot at the start of a route.
+    double ready(size_t a, double early) const
+    {
+        return a == this->depot ? this->window[a].first : early + this->service(a);
+    }
+
+    // Load and time window feasibility of a whole route, by forward simulation.
+    bool feasible(const std::vector<size_t>& route) const
+    {
+        double load = 0;
+        for (const auto& u : route) {
+            load += this->demand(u);
+        }
+        if (load > this->capacity) {
+            return false;
+        }
+        if (!this->timed) {
+            return true;
+        }
+        size_t prev = this->depot;
+        double t = 0;
+        for (const auto& u : route) {
+            t = std::max(this->window[u].first, this->ready(prev, t) + this->travel(prev, u));
+            if (t > this->window[u].second) {
+                return false;
+            }
+            prev = u;
+        }
+        return this->ready(prev, t) + this->travel(prev, this->depot) <= this->window[this->depot].second;
+    }
+};
+
+// A solution as stop sequences per vehicle (depot left out), with each route's load
+// and cost and each stop's route, position, earliest service start and latest
+// service start that keeps the rest of its route feasible. Together they price and
+// check any single insertion or removal in O(1); a change rebuilds only its route.
+class vrp_solution {
+public:
+    const vrp_instance* p;
+    std::vector<std::vector<size_t>> route;
+    std::vector<double> load, cost, early, late;
+    std::vector<size_t> owner, place, bank;
+    double distance;
+
+    vrp_solution(const vrp_instance& p, size_t vehicles)
+        : p(&p)
+        , route(vehicles)
+        , load(vehicles, 0)
+        , cost(vehicles, 0)
+        , early(p.n, 0)
+        , late(p.n, 0)
+        , owner(p.n, vrp_npos)
+        , place(p.n, 0)
+        , bank()
+        , distance(0)
+    {
+    }
+
+    double value() const
+    {
+        return this->distance + this->p->penalty * this->bank.size();
+    }
+
+    void refresh(size_t r)
+    {
+        const vrp_instance& p = *this->p;
+        const std::vector<size_t>& s = this->route[r];
+        double l = 0, d = 0;
+        size_t prev = p.depot;
+        for (size_t k = 0; k < s.size(); ++k) {
+            size_t u = s[k];
+            this->owner[u] = r;
+            this->place[u] = k;
+            l += p.demand(u);
+            d += p.c(prev, u);
+            prev = u;
+        }
+        d += s.empty() ? 0 : p.c(prev, p.depot);
+        this->distance += d - this->cost[r];
+        this->cost[r] = d;
+        this->load[r] = l;
+        if (p.timed) {
+            double t = 0;
+            prev = p.depot;
+            for (const auto& u : s) {
+                t = std::max(p.window[u].first, p.ready(prev, t) + p.travel(prev, u));
+                this->early[u] = t;
+                prev = u;
+            }
+            size_t next = p.depot;
+            t = p.window[p.depot].second;
+            for (size_t k = s.size(); k-- > 0;) {
+                size_t u = s[k];
+                t = std::min(p.window[u].second, t - p.service(u) - p.travel(u, next));
+                this->late[u] = t;
+                next = u;
+            }
+        }
+    }
+
+    size_t predecessor(size_t r, size_t k) const
+    {
+        return k == 0 ? this->p->depot : this->route[r][k - 1];
+    }
+
+    size_t successor(size_t r, size_t k) const
+    {
+        return k == this->route[r].size() ? this->p->depot : this->route[r][k];
+    }
+
+    // Cost change of putting u into route r before position k, if that is feasible.
+    bool insertion(size_t u, size_t r, size_t k, double& delta) const
+    {
+        const vrp_instance& p = *this->p;
+        if (this->load[r] + p.demand(u) > p.capacity) {
+            return false;
+        }
+        size_t a = this->predecessor(r, k), b = this->successor(r, k);
+        if (p.timed) {
+            double t = std::max(p.window[u].first, p.ready(a, this->early[a]) + p.travel(a, u));
+            double deadline = b == p.depot ? p.window[p.depot].second : this->late[b];
+            if (t > p.window[u].second || t + p.service(u) + p.travel(u, b) > deadline) {
+                return false;
+            }
+        }
+        delta = p.c(a, u) + p.c(u, b) - p.c(a, b);
+        return true;
+    }
+
+    // Cost saved by taking the routed stop u out.
+    double removal(size_t u) const
+    {
+        const vrp_instance& p = *this->p;
+        size_t r = this->owner[u], k = this->place[u];
+        size_t a = this->predecessor(r, k), b = this->successor(r, k + 1);
+        return p.c(a, u) + p.c(u, b) - p.c(a, b);
+    }
+
+    void remove(size_t u)
+    {
+        size_t r = this->owner[u];
+        this->route[r].erase(this->route[r].begin() + this->place[u]);
+        this->owner[u] = vrp_npos;
+        this->bank.push_back(u);
+        this->refresh(r);
+    }
+
+    void insert(size_t u, size_t r, size_t k)
+    {
+        this->route[r].insert(this->route[r].begin() + k, u);
+        this->bank.erase(std::find(this->bank.begin(), this->bank.end(), u));
+        this->refresh(r);
+    }
+
+    // Calls visit(r, k) for the positions next to u's routed neighbours and for the
+    // start of the first empty route.
+    template <typename F>
+    void positions(size_t u, const F& visit) const
+    {
+        for (const auto& v : this->p->near[u]) {
+            if (this->owner[v] != vrp_npos) {
+                visit(this->owner[v], this->place[v]);
+                visit(this->owner[v], this->place[v] + 1);
+            }
+        }
+        for (size_t r = 0; r < this->route.size(); ++r) {
+            if (this->route[r].empty()) {
+                visit(r, 0);
+                break;
+            }
+        }
+    }
+
+    // The cheapest insertion of a waiting stop and, for regret, the cheapest one in
+    // a different route.
+    class offer_t {
+    public:
+        size_t u, r1, k1, r2;
+        double best1, best2;
+    };
+
+    void price(offer_t& o) const
+    {
+        o.best1 = o.best2 = vrp_inf;
+        o.r1 = o.k1 = o.r2 = vrp_npos;
+        this->positions(o.u, [&](size_t r, size_t k) {
+            double delta;
+            if (!this->insertion(o.u, r, k, delta)) {
+                return;
+            }
+            if (delta < o.best1) {
+                if (r != o.r1) {
+                    o.best2 = o.best1;
+                    o.r2 = o.r1;
+                }
+                o.best1 = delta;
+                o.r1 = r;
+                o.k1 = k;
+            } else if (r != o.r1 && delta < o.best2) {
+                o.best2 = delta;
+                o.r2 = r;
+            }
+        });
+    }
+
+    // Greedy insertion puts in the cheapest stop first, regret-2 the stop that would
+    // lose most by missing its best route; stops with no feasible place stay banked.
+    // After an insertion into route r only the offers that used r or may use the
+    // new positions there are priced again.
+    void repair(bool regret)
+    {
+        std::vector<offer_t> waiting(this->bank.size());
+        for (size_t i = 0; i < waiting.size(); ++i) {
+            waiting[i].u = this->bank[i];
+            this->price(waiting[i]);
+        }
+        while (!waiting.empty()) {
+            size_t pick = vrp_npos;
+            double score = vrp_inf;
+            for (size_t i = 0; i < waiting.size(); ++i) {
+                const offer_t& o = waiting[i];
+                if (o.r1 == vrp_npos) {
+                    continue;
+                }
+                double s = regret ? (o.best2 == vrp_inf ? -this->p->penalty : o.best1 - o.best2) : o.best1;
+                if (s < score) {
+                    score = s;
+                    pick = i;
+                }
+            }
+            if (pick == vrp_npos) {
+                break;
+            }
+            size_t r = waiting[pick].r1;
+            this->insert(waiting[pick].u, r, waiting[pick].k1);
+            waiting[pick] = waiting.back();
+            waiting.pop_back();
+            for (auto& o : waiting) {
+                bool stale = o.r1 == r || o.r2 == r;
+                for (size_t t = 0; !stale && t < this->p->near[o.u].size(); ++t) {
+                    stale = this->owner[this->p->near[o.u][t]] == r;
+                }
+                if (stale) {
+                    this->price(o);
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> routed() const
+    {
+        std::vector<size_t> ret;
+        for (const auto& s : this->route) {
+            ret.insert(ret.end(), s.begin(), s.end());
+        }
+        return ret;
+    }
+
+    void destroy(size_t op, random& rg)
+    {
+        std::vector<size_t> stops = this->routed();
+        if (stops.empty()) {
+            return;
+        }
+        size_t most = std::min<size_t>(60, std::max<size_t>(4, stops.size() / 5));
+        size_t q = std::min(stops.size(), 4 + static_cast<size_t>(rg.generate() * (most - 3)));
+        auto pick = [&](size_t size, double power) {
+            return std::min(size - 1, static_cast<size_t>(std::pow(rg.generate(), power) * size));
+        };
+        if (op == 0) {
+            for (size_t i = 0; i < q; ++i) {
+                std::swap(stops[i], stops[i + pick(stops.size() - i, 1)]);
+                this->remove(stops[i]);
+            }
+        } else if (op == 1) {
+            std::vector<std::pair<double, size_t>> gain;
+            for (const auto& u : stops) {
+                gain.push_back({ -this->removal(u), u });
+            }
+            std::sort(gain.begin(), gain.end());
+            for (size_t i = 0; i < q; ++i) {
+                size_t j = pick(gain.size(), 3);
+                this->remove(gain[j].second);
+                gain.erase(gain.begin() + j);
+            }
+        } else if (op == 2) {
+            std::vector<size_t> taken(1, stops[pick(stops.size(), 1)]);
+            this->remove(taken[0]);
+            while (taken.size() < q) {
+                std::vector<size_t> close;
+                for (const auto& v : this->p->near[taken[pick(taken.size(), 1)]]) {
+                    if (this->owner[v] != vrp_npos) {
+                        close.push_back(v);
+                    }
+                }
+                if (close.empty()) {
+                    stops = this->routed();
+                    if (stops.empty()) {
+                        break;
+                    }
+                    close.push_back(stops[pick(stops.size(), 1)]);
+                }
+                taken.push_back(close[pick(close.size(), 3)]);
+                this->remove(taken.back());
+            }
+        } else {
+            size_t r = this->owner[stops[pick(stops.size(), 1)]];
+            while (!this->route[r].empty()) {
+                this->remove(this->route[r].back());
+            }
+        }
+    }
+};
+
+// Clarke-Wright savings: every servable stop starts on a route of its own and the
+// routes ending at i and starting at j are joined in order of c(i, depot) +
+// c(depot, j) - c(i, j) over the candidate pairs, a symmetric matrix allowing either
+// route to be reversed first. Beyond `vehicles` routes, the ones with the least
+// load go to the bank and a greedy insertion places what it can.
+static vrp_solution vrp_savings(const vrp_instance& p, size_t vehicles, bool symmetric)
+{
+    size_t n = p.n, d = p.depot;
+    std::vector<std::vector<size_t>> chain(n);
+    std::vector<size_t> which(n, vrp_npos);
+    std::vector<double> weight(n, 0);
+    std::vector<std::pair<double, std::pair<size_t, size_t>>> saving;
+    for (size_t i = 0; i < n; ++i) {
+        if (i == d || p.stranded[i]) {
+            continue;
+        }
+        chain[i].push_back(i);
+        which[i] = i;
+        weight[i] = p.demand(i);
+        for (const auto& j : p.near[i]) {
+            double s = p.c(i, d) + p.c(d, j) - p.c(i, j);
+            if (s > 0 && !p.stranded[j]) {
+                saving.push_back({ -s, { i, j } });
+            }
+        }
+    }
+    std::sort(saving.begin(), saving.end());
+    for (const auto& item : saving) {
+        size_t i = item.second.first, j = item.second.second, a = which[i], b = which[j];
+        if (a == b || weight[a] + weight[b] > p.capacity) {
+            continue;
+        }
+        std::vector<size_t> &x = chain[a], &y = chain[b];
+        bool flip_x = symmetric && x.back() != i && x.front() == i, flip_y = symmetric && y.front() != j && y.back() == j;
+        if ((flip_x ? x.front() : x.back()) != i || (flip_y ? y.back() : y.front()) != j) {
+            continue;
+        }
+        std::vector<size_t> merged(x);
+        if (flip_x) {
+            std::reverse(merged.begin(), merged.end());
+        }
+        merged.insert(merged.end(), y.begin(), y.end());
+        if (flip_y) {
+            std::reverse(merged.end() - y.size(), merged.end());
+        }
+        if (p.timed && !p.feasible(merged)) {
+            continue;
+        }
+        for (const auto& u : y) {
+            which[u] = a;
+        }
+        x.swap(merged);
+        y.clear();
+        weight[a] += weight[b];
+    }
+    std::vector<std::pair<double, size_t>> order;
+    for (size_t i = 0; i < n; ++i) {
+        if (!chain[i].empty()) {
+            order.push_back({ -weight[i], i });
+        }
+    }
+    std::sort(order.begin(), order.end());
+    vrp_solution ret(p, vehicles);
+    for (size_t k = 0; k < order.size(); ++k) {
+        const std::vector<size_t>& s = chain[order[k].second];
+        if (k < vehicles) {
+            ret.route[k] = s;
+            ret.refresh(k);
+        } else {
+            ret.bank.insert(ret.bank.end(), s.begin(), s.end());
+        }
+    }
+    ret.repair(false);
+    return ret;
+}
+
+optimization::vrp::vrp(const real_block& c, const real_block& demand, double capacity, size_t vehicles, size_t depot)
+    : c(c)
+    , travel()
+    , demand(demand)
+    , service()
+    , window()
+    , capacity(capacity)
+    , vehicles(vehicles)
+    , depot(depot)
+    , sum(0)
+    , path()
+    , missed()
+{
+}
+
+optimization::vrp& optimization::vrp::set_time_windows(const real_block& travel, const std::vector<range_t>& window, const real_block& service)
+{
+    this->travel = travel;
+    this->window = window;
+    this->service = service;
+    return *this;
+}
+
+bool optimization::vrp::solve(double seconds, size_t threads)
+{
+    typedef std::chrono::steady_clock clock_t;
+    clock_t::time_point begin = clock_t::now();
+    size_t n = this->c.rows(), d = this->depot;
+    vrp_instance p(this->c, this->travel, this->demand, this->service, this->window, this->capacity, d);
+    p.penalty = 2 * this->c.cwiseAbs().maxCoeff() + 1;
+    size_t k = std::min(optimization::vrp::neighbors, n > 2 ? n - 2 : 0);
+    parallel::for_each_block(n, threads, [&](size_t first, size_t last) {
+        std::vector<std::pair<double, size_t>> row;
+        for (size_t i = first; i < last; ++i) {
+            if (i == d) {
+                continue;
+            }
+            row.clear();
+            for (size_t j = 0; j < n; ++j) {
+                if (j != i && j != d) {
+                    row.push_back({ std::min(this->c(i, j), this->c(j, i)), j });
+                }
+            }
+            std::partial_sort(row.begin(), row.begin() + k, row.end());
+            for (size_t t = 0; t < k; ++t) {
+                p.near[i].push_back(row[t].second);
+            }
+            p.stranded[i] = !p.feasible(std::vector<size_t>(1, i));
+        }
+    });
+
+    vrp_solution start = vrp_savings(p, this->vehicles, this->c == this->c.transpose());
+    std::mutex lock;
+    vrp_solution shared = start;
+    size_t workers = parallel::thread_number(threads);
+    double t0 = 0.05 * start.distance / std::log(2.0);
+    parallel::ordered_for_each(
+        workers, threads,
+        [&](size_t w, size_t) {
+            random rg(0, 1, 2019, w);
+            vrp_solution current = start, best = start;
+            const size_t destroys = 4, repairs = 2;
+            std::vector<double> weight(destroys + repairs, 1), score(destroys + repairs, 0), used(destroys + repairs, 0);
+            auto roulette = [&](size_t first, size_t count) {
+                double total = 0;
+                for (size_t i = first; i < first + count; ++i) {
+                    total += weight[i];
+                }
+                double x = rg.generate() * total;
+                for (size_t i = first; i < first + count; ++i) {
+                    x -= weight[i];
+                    if (x < 0) {
+                        return i;
+                    }
+                }
+                return first + count - 1;
+            };
+            for (size_t it = 0; it < optimization::vrp::max_iterations; ++it) {
+                double progress = std::chrono::duration<double>(clock_t::now() - begin).count() / seconds;
+                progress = std::max(progress, static_cast<double>(it) / optimization::vrp::max_iterations);
+                if (progress >= 1) {
+                    break;
+                }
+                size_t x = roulette(0, destroys), y = roulette(destroys, repairs);
+                vrp_solution next = current;
+                next.destroy(x, rg);
+                next.repair(y == destroys + 1);
+                double gain = 0;
+                if (next.value() < best.value() - 1e-9) {
+                    best = next;
+                    current = next;
+                    gain = 33;
+                } else if (next.value() < current.value() - 1e-9) {
+                    current = next;
+                    gain = 9;
+                } else if (rg.generate() < std::exp((current.value() - next.value()) / (t0 * std::pow(1e-3, progress)))) {
+                    current = next;
+                    gain = 13;
+                }
+                score[x] += gain;
+                score[y] += gain;
+                ++used[x];
+                ++used[y];
+                if ((it + 1) % optimization::vrp::segment == 0) {
+                    for (size_t i = 0; i < weight.size(); ++i) {
+                        if (used[i] > 0) {
+                            weight[i] = 0.9 * weight[i] + 0.1 * score[i] / used[i];
+                        }
+                        weight[i] = std::max(weight[i], 0.05);
+                        score[i] = used[i] = 0;
+                    }
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (best.value() < shared.value()) {
+                        shared = best;
+                    } else if (shared.value() < best.value() - 1e-9) {
+                        best = shared;
+                        current = shared;
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            if (best.value() < shared.value()) {
+                shared = best;
+            }
+        },
+        [](size_t) { return true; });
+
+    this->path.clear();
+    for (const auto& s : shared.route) {
+        if (!s.empty()) {
+            std::vector<size_t> r(1, d);
+            r.insert(r.end(), s.begin(), s.end());
+            r.push_back(d);
+            this->path.push_back(r);
+        }
+    }
+    this->missed = shared.bank;
+    for (size_t i = 0; i < n; ++i) {
+        if (p.stranded[i]) {
+            this->missed.push_back(i);
+        }
+    }
+    std::sort(this->missed.begin(), this->missed.end());
+    this->sum = shared.distance;
+    return this->missed.empty();
+}
+
+const std::vector<std::vector<size_t>>& optimization::vrp::routes() const
+{
+    return this->path;
+}
+
+const std::vector<size_t>& optimization::vrp::unserved() const
+{
+    return this->missed;
+}
+
+double optimization::vrp::obj() const
+{
+    return this->sum;
+}
+}
@@ -0,0 +1,63 @@
+#include "../help.hpp"
+
+// constrained/test1 with the objective and conditions written once over autodiff::var,
+// their gradients wired into the setters for LD_SLSQP.
+// The global minima: x* = (1,1,…,1,3,3,3,1), f(x*) = -15.
+
+int main(int argc, char** argv)
+{
+    typedef anyprog::autodiff::var_block var_block;
+    anyprog::autodiff::function_t obj = [](const var_block& x) {
+        return 5 * x.head(4).sum() - 5 * x.head(4).squaredNorm() - x.tail(x.rows() - 4).sum();
+    };
+    std::vector<anyprog::autodiff::function_t> ineq = {
+        [](const var_block& x) {
+            return 2 * x(0) + 2 * x(1) + x(9) + x(10) - 10;
+        },
+        [](const var_block& x) {
+            return 2 * x(0) + 2 * x(2) + x(9) + x(11) - 10;
+        },
+        [](const var_block& x) {
+            return 2 * x(1) + 2 * x(2) + x(10) + x(11) - 10;
+        },
+        [](const var_block& x) {
+            return -8 * x(0) + x(9);
+        },
+        [](const var_block& x) {
+            return -8 * x(1) + x(10);
+        },
+        [](const var_block& x) {
+            return -8 * x(2) + x(11);
+        },
+        [](const var_block& x) {
+            return -2 * x(3) - x(4) + x(9);
+        },
+        [](const var_block& x) {
+            return -2 * x(5) - x(6) + x(10);
+        },
+        [](const var_block& x) {
+            return -2 * x(7) - x(8) + x(11);
+        }
+    };
+
+    size_t dim = 13;
+    anyprog::real_block u(dim, 1);
+    u.fill(1);
+    u(9) = 100;
+    u(10) = 100;
+    u(11) = 100;
+
+    std::vector<anyprog::optimization::range_t> range;
+    for (size_t i = 0; i < dim; ++i) {
+        range.push_back({ 0, u(i) });
+    }
+
+    anyprog::optimization opt(anyprog::autodiff::value(obj), range);
+    opt.set_gradient_function(anyprog::autodiff::gradient(obj));
+    opt.set_inequation_condition(anyprog::autodiff::value(ineq));
+    opt.set_inequation_gradient_function(anyprog::autodiff::gradient(ineq));
+    auto ret = opt.search(10, 3, 0.382, anyprog::optimization::method::LD_SLSQP, 1e-8);
+    anyprog::print(opt.is_ok(), ret, anyprog::autodiff::value(obj));
+
+    return 0;
+}
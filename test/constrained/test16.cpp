@@ -0,0 +1,46 @@
+#include "../help.hpp"
+#include <chrono>
+
+// Many short local solves on one constrained problem: search() restarts LN_COBYLA from
+// 500 samples a round, each run capped at 50 evaluations, so registering the conditions would
+// cost as much as solving. The nlopt contexts stay with the problem between the runs;
+// a copy starts without them and must reach the same point.
+// min (x0 - 1)^2 + (x1 - 2)^2 + … subject to sum(x) <= 4, x0 * x1 >= 1 and four
+// linear rows x(i) - x(i + 1) <= 1.
+
+int main(int argc, char** argv)
+{
+    size_t dim = 6;
+    anyprog::optimization::function_t obj = [](const anyprog::real_block& x) {
+        double s = 0;
+        for (size_t i = 0; i < x.rows(); ++i) {
+            s += pow(x(i) - (i % 3 + 1), 2);
+        }
+        return s;
+    };
+    std::vector<anyprog::optimization::inequation_condition_function_t> ineq = {
+        [](const anyprog::real_block& x) {
+            return x.sum() - 4;
+        },
+        [](const anyprog::real_block& x) {
+            return 1 - x(0) * x(1);
+        }
+    };
+    anyprog::real_block A = anyprog::real_block::Zero(dim - 2, dim), b = anyprog::real_block::Ones(dim - 2, 1);
+    for (size_t i = 0; i + 2 < dim; ++i) {
+        A(i, i) = 1;
+        A(i, i + 1) = -1;
+    }
+
+    anyprog::optimization opt(obj, { -3, 3 }, dim);
+    opt.set_inequation_condition(ineq).set_inequation_condition(A, b).set_seed(2019);
+    anyprog::optimization copy = opt;
+    auto begin = std::chrono::steady_clock::now();
+    anyprog::real_block ret = opt.search(500, 100, 0.382, anyprog::optimization::method::LN_COBYLA, 1e-6, 50);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "search\tobject=\t" << opt.obj(ret) << "\tseconds=\t" << elapsed << "\n";
+
+    const anyprog::real_block& other = copy.search(500, 100, 0.382, anyprog::optimization::method::LN_COBYLA, 1e-6, 50);
+    std::cout << "copy\tobject=\t" << copy.obj(other) << "\tdistance=\t" << (other - ret).norm() << "\n";
+    return 0;
+}
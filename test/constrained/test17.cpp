@@ -0,0 +1,88 @@
+#include "../help.hpp"
+
+// A model re-solved every round after its data drifted a little: the targets the
+// objective reads and the budget of a linear inequation change in place. One problem
+// calls solve() each round, the other resolve(), which starts at the last solution:
+// COBYLA with a small step, SLSQP from the quasi-Newton matrix and multipliers of the
+// last run, MMA from its asymptotes and dual variables, LBFGS (without the budget)
+// from its history. Both must end at the same
+// optimum; the evaluations are counted and SLSQP prints the active set it kept.
+// min sum w(i) (x(i) - t(i))^2 + (x(0) * x(1) - 1)^2 subject to sum(x) <= budget.
+
+static void drift(anyprog::optimization::method m, const char* name, bool budgeted)
+{
+    size_t dim = 5, calls = 0;
+    std::vector<double> target = { 1, 2, 0.5, -1, 1.5 }, weight = { 1, 4, 16, 64, 256 };
+    double budget = 3;
+    anyprog::optimization::function_t obj = [&](const anyprog::real_block& x) {
+        ++calls;
+        double s = pow(x(0) * x(1) - 1, 2);
+        for (size_t i = 0; i < x.rows(); ++i) {
+            s += weight[i] * pow(x(i) - target[i], 2);
+        }
+        return s;
+    };
+    anyprog::optimization::gradient_function_t grad = [&](const anyprog::real_block& x) {
+        anyprog::real_block g(x.rows(), 1);
+        for (size_t i = 0; i < x.rows(); ++i) {
+            g(i) = 2 * weight[i] * (x(i) - target[i]);
+        }
+        g(0) += 2 * (x(0) * x(1) - 1) * x(1);
+        g(1) += 2 * (x(0) * x(1) - 1) * x(0);
+        return g;
+    };
+    anyprog::real_block A = anyprog::real_block::Ones(1, dim), b(1, 1);
+    b(0) = budget;
+
+    anyprog::real_block start = anyprog::real_block::Zero(dim, 1);
+    std::vector<anyprog::optimization::range_t> range(dim, { -5, 5 });
+    anyprog::optimization cold(obj, start, range), warm(obj, start, range);
+    cold.set_gradient_function(grad);
+    warm.set_gradient_function(grad);
+    if (budgeted) {
+        cold.set_inequation_condition(A, b);
+        warm.set_inequation_condition(A, b);
+    }
+    warm.solve(m, 1e-8, 5000);
+
+    size_t cold_calls = 0, warm_calls = 0;
+    double worst = 0;
+    for (size_t round = 1; round <= 20; ++round) {
+        for (size_t i = 0; i < dim; ++i) {
+            target[i] += 0.01 * sin(round + i);
+        }
+        b(0) = budget + 0.02 * cos(round);
+        if (budgeted) {
+            cold.update_inequation_condition(0, A, b);
+            warm.update_inequation_condition(0, A, b);
+        }
+        cold.set_data_changed();
+        warm.set_data_changed();
+
+        calls = 0;
+        const anyprog::real_block& p = cold.solve(m, 1e-8, 5000);
+        cold_calls += calls;
+        double f = cold.obj(p);
+        calls = 0;
+        const anyprog::real_block& q = warm.resolve(m, 1e-8, 5000);
+        warm_calls += calls;
+        worst = std::max(worst, fabs(warm.obj(q) - f));
+        if (round % 10 == 0) {
+            std::cout << name << " round " << round << "\tsolve=\t" << f << "\tresolve=\t" << warm.obj(q) << "\tok=\t" << cold.is_ok() << warm.is_ok() << "\n";
+        }
+    }
+    std::cout << name << " evaluations\tsolve=\t" << cold_calls << "\tresolve=\t" << warm_calls << "\tlargest gap=\t" << worst;
+    if (m == anyprog::optimization::method::LD_SLSQP) {
+        std::cout << "\tactive rows=\t" << warm.get_active_set().size();
+    }
+    std::cout << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    drift(anyprog::optimization::method::LN_COBYLA, "LN_COBYLA", true);
+    drift(anyprog::optimization::method::LD_SLSQP, "LD_SLSQP", true);
+    drift(anyprog::optimization::method::LD_MMA, "LD_MMA", true);
+    drift(anyprog::optimization::method::LD_LBFGS, "LD_LBFGS", false);
+    return 0;
+}
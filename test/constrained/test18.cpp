@@ -0,0 +1,34 @@
+#include "../help.hpp"
+#include <chrono>
+#include <thread>
+
+// Where the time of a search() goes: the objective sleeps 20 µs per call and the
+// conditions are cheap, so the statistics should put most of the seconds in the
+// callbacks and count every condition on its own. The JSON goes to standard output.
+// min sum (x(i) - 1)^2 subject to x(0)^2 + x(1)^2 = 1 and x(2) + x(3) <= 1.
+
+int main(int argc, char** argv)
+{
+    size_t dim = 4;
+    anyprog::optimization::function_t obj = [](const anyprog::real_block& x) {
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        return (x.array() - 1).square().sum();
+    };
+    std::vector<anyprog::optimization::equation_condition_function_t> eq = {
+        [](const anyprog::real_block& x) {
+            return x(0) * x(0) + x(1) * x(1) - 1;
+        }
+    };
+    std::vector<anyprog::optimization::inequation_condition_function_t> ineq = {
+        [](const anyprog::real_block& x) {
+            return x(2) + x(3) - 1;
+        }
+    };
+    anyprog::optimization opt(obj, { -2, 2 }, dim);
+    opt.set_equation_condition(eq).set_inequation_condition(ineq).set_seed(2019).set_thread_number(2).set_enable_stats();
+    auto ret = opt.search(20, 10, 0.382, anyprog::optimization::method::LN_COBYLA, 1e-6, 1000);
+    anyprog::optimization::solve_stats stats = opt.get_stats();
+    std::cout << "object=\t" << opt.obj(ret) << "\tsolves=\t" << stats.solves << "\tfailed=\t" << stats.failed << "\trounds=\t" << stats.rounds << "\treloops=\t" << stats.reloops << "\tevaluations=\t" << stats.evaluations << "\tobjective calls=\t" << stats.objective_calls << "\tcallback share=\t" << stats.callback_seconds / (stats.callback_seconds + stats.solver_seconds) << "\n";
+    std::cout << stats.to_json() << "\n";
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include "../help.hpp"
+
+// Linear conditions carry their own Jacobian, so gradient methods need no user gradient code.
+// The optimum: x* = (0, 15, 3), f(x*) = -78.
+
+int main(int argc, char** argv)
+{
+    anyprog::real_block obj(3, 1);
+    obj << -5, -4, -6;
+
+    anyprog::real_block A(3, 3), b(3, 1);
+    A << 1, -1, 1,
+        3, 2, 4,
+        3, 2, 0;
+    b << 20, 42, 30;
+
+    std::vector<anyprog::optimization::range_t> range = { { 0, 20 }, { 0, 20 }, { 0, 20 } };
+
+    anyprog::optimization opt(obj, range);
+    opt.set_solver(anyprog::optimization::solver_t::NLOPT);
+    opt.set_inequation_condition(A, b);
+    auto ret = opt.search(10, 3, 0.382, anyprog::optimization::method::LD_SLSQP, 1e-8);
+    anyprog::print(opt.is_ok(), ret, obj);
+
+    ret = opt.search(10, 3, 0.382, anyprog::optimization::method::LD_MMA, 1e-8);
+    anyprog::print(opt.is_ok(), ret, obj);
+    return 0;
+}
\ No newline at end of file
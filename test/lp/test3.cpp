@@ -0,0 +1,31 @@
+#include "../help.hpp"
+
+// A sparse 400 x 400 LP solved by the LP_SIMPLEX engine behind the linear-objective constructors.
+// The second solve() warm starts from the optimal basis of the first one and needs no pivots.
+
+int main(int argc, char** argv)
+{
+    size_t m = 400, n = 400;
+    anyprog::random rng(0, 1, 2019);
+    anyprog::real_block obj(n, 1), x0(n, 1), A = anyprog::real_block::Zero(m, n), b(m, 1);
+    rng.fill(obj, -1, 0);
+    rng.fill(x0, 0, 1);
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t k = 0; k < 8; ++k) {
+            A(i, size_t(rng.generate() * n) % n) = rng.generate();
+        }
+    }
+    b = A * x0;
+    b.array() += 0.5;
+
+    anyprog::optimization::range_t range = { 0, 10 };
+    anyprog::optimization opt(obj, range);
+    opt.set_inequation_condition(A, b);
+    for (size_t i = 0; i < 2; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        auto ret = opt.solve();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "ok=\t" << opt.is_ok() << "\tobject=\t" << obj.col(0).dot(ret.col(0)) << "\tmax violation=\t" << (A * ret - b).maxCoeff() << "\tseconds=\t" << elapsed << "\n";
+    }
+    return 0;
+}
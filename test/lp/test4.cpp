@@ -0,0 +1,47 @@
+#include "../help.hpp"
+#include <chrono>
+
+// Assignment: the dense Hungarian solver on a small job table, then a
+// 10000 x 10000 sparse dispatch problem through the auction solver,
+// cross-checked against the Hungarian solver on a 1000 x 1000 slice.
+int main(int argc, char** argv)
+{
+    anyprog::real_block c(4, 4);
+    c << 9, 2, 7, 8,
+        6, 4, 3, 7,
+        5, 8, 1, 8,
+        7, 6, 9, 4;
+    anyprog::optimization::assignment dense(c);
+    std::cout << "object=\t" << dense.obj() << "\n";
+    for (auto& i : dense.solve()) {
+        std::cout << i.first << " -> " << i.second << "\n";
+    }
+
+    typedef anyprog::optimization::assignment::sparse_block sparse_block;
+    anyprog::random rg(0, 1, 2019);
+    for (size_t n : { 1000, 10000 }) {
+        std::vector<Eigen::Triplet<double>> entries;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t k = 0; k < 16; ++k) {
+                entries.push_back({ (int)i, (int)(rg.generate() * n), std::floor(rg.generate() * 1000) });
+            }
+        }
+        sparse_block s(n, n);
+        s.setFromTriplets(entries.begin(), entries.end(), [](double a, double b) { return std::min(a, b); });
+        auto start = std::chrono::steady_clock::now();
+        anyprog::optimization::assignment auction(s, 0, 4);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << n << "x" << n << "\tobject=\t" << auction.obj() << "\tmatched=\t" << auction.solve().size() << "\tseconds=\t" << elapsed << "\n";
+        if (n == 1000) {
+            anyprog::real_block d = anyprog::real_block::Constant(n, n, 1e10);
+            for (int k = 0; k < s.outerSize(); ++k) {
+                for (sparse_block::InnerIterator it(s, k); it; ++it) {
+                    d(it.row(), it.col()) = it.value();
+                }
+            }
+            anyprog::optimization::assignment hungarian(d);
+            std::cout << "same as hungarian=\t" << (hungarian.obj() == auction.obj() ? "true" : "false") << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "../help.hpp"
+
+// Min-cost flow on side x side grids, fed to optimization::simplex through the sparse
+// add_equation overload: one conservation row per node and an arc each way between
+// neighbours, capacity 20. The last grid has 10^4 rows and about 4 x 10^4 columns.
+
+int main(int argc, char** argv)
+{
+    for (size_t side : { 30, 60, 100 }) {
+        size_t m = side * side;
+        anyprog::random rng(0, 1, 2019);
+        std::vector<Eigen::Triplet<double>> t;
+        std::vector<double> cost;
+        for (size_t i = 0; i < side; ++i) {
+            for (size_t j = 0; j < side; ++j) {
+                size_t u = i * side + j;
+                for (size_t v : { i + 1 < side ? u + side : m, j + 1 < side ? u + 1 : m }) {
+                    if (v == m) {
+                        continue;
+                    }
+                    for (size_t dir = 0; dir < 2; ++dir) {
+                        t.emplace_back(dir ? v : u, cost.size(), 1.0);
+                        t.emplace_back(dir ? u : v, cost.size(), -1.0);
+                        cost.push_back(1 + 9 * rng.generate());
+                    }
+                }
+            }
+        }
+        size_t n = cost.size();
+        Eigen::SparseMatrix<double> A(m, n);
+        A.setFromTriplets(t.begin(), t.end());
+        anyprog::real_block c = Eigen::Map<const Eigen::VectorXd>(cost.data(), n), b = anyprog::real_block::Zero(m, 1);
+        for (size_t k = 0; k < m / 10; ++k) {
+            double s = std::floor(10 * rng.generate());
+            b(size_t(rng.generate() * m) % m, 0) += s;
+            b(size_t(rng.generate() * m) % m, 0) -= s;
+        }
+
+        anyprog::optimization::simplex lp(c, std::vector<anyprog::optimization::range_t>(n, { 0, 20 }));
+        lp.add_equation(A, b);
+        auto start = std::chrono::steady_clock::now();
+        auto status = lp.solve();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << m << "x" << n << "\tstatus=\t" << status << "\tobject=\t" << lp.obj() << "\tpivots=\t" << lp.iterations() << "\tmax violation=\t" << (A * lp.solution() - b).cwiseAbs().maxCoeff() << "\tseconds=\t" << elapsed << "\n";
+    }
+    return 0;
+}
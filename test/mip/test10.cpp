@@ -0,0 +1,60 @@
+#include "../help.hpp"
+
+// A 0-1 knapsack with 40 items solved by LP-based branch and bound;
+// the optimum is checked against dynamic programming. The same problem
+// is solved again through optimization::solve with a 100 node cap, with
+// its incumbents and branch and bound stats forwarded.
+
+int main(int argc, char** argv)
+{
+    size_t n = 40, capacity = 500;
+    anyprog::random rng(0, 1, 2019);
+    std::vector<size_t> weight(n), value(n);
+    anyprog::real_block obj(n, 1), A(1, n), b(1, 1);
+    for (size_t i = 0; i < n; ++i) {
+        weight[i] = 10 + size_t(rng.generate() * 40);
+        value[i] = weight[i] + size_t(rng.generate() * 20);
+        obj(i, 0) = -double(value[i]);
+        A(0, i) = weight[i];
+    }
+    b(0, 0) = capacity;
+
+    std::vector<size_t> best(capacity + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t w = capacity; w >= weight[i]; --w) {
+            best[w] = std::max(best[w], best[w - weight[i]] + value[i]);
+        }
+    }
+
+    anyprog::optimization::range_t range = { 0, 1 };
+    anyprog::optimization opt(obj, range);
+    opt.set_inequation_condition(A, b);
+    opt.set_enable_binary_filter();
+    auto ret = opt.solve();
+    anyprog::print(opt.is_ok(), ret, obj);
+
+    std::vector<size_t> index(n);
+    for (size_t i = 0; i < n; ++i) {
+        index[i] = i;
+    }
+    anyprog::optimization::milp bb(obj, std::vector<anyprog::optimization::range_t>(n, range), index);
+    bb.add_inequation(A, b);
+    bb.set_progress_function([](size_t nodes, double incumbent, double bound) {
+        std::cout << "nodes=\t" << nodes << "\tincumbent=\t" << incumbent << "\tbound=\t" << bound << "\n";
+    });
+    bb.solve();
+    std::cout << "gap=\t" << bb.gap() << "\n";
+    std::cout << "same as dynamic programming=\t" << (-obj.col(0).dot(ret.col(0)) == best[capacity] ? "true" : "false") << "\n";
+
+    anyprog::optimization capped(obj, range);
+    capped.set_inequation_condition(A, b);
+    capped.set_enable_binary_filter();
+    capped.set_enable_stats();
+    capped.set_progress_function([](double value, const anyprog::real_block&) {
+        std::cout << "incumbent=\t" << value << "\n";
+    });
+    capped.solve(anyprog::optimization::method::LN_COBYLA, 1e-5, 100);
+    std::cout << "capped ok=\t" << capped.is_ok() << "\tgap=\t" << capped.get_gap() << "\n";
+    std::cout << capped.get_stats().to_json() << "\n";
+    return 0;
+}
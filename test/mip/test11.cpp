@@ -0,0 +1,68 @@
+#include "../help.hpp"
+#include <chrono>
+
+// test1 solved by nonlinear branch and bound instead of the rounding filter,
+// on one and on four threads; both runs must reach the same objective with no gap.
+// A run cut off after five nodes then has to report the gap it left open.
+int main(int argc, char** argv)
+{
+    anyprog::optimization::function_t obj = [](const anyprog::real_block& x) {
+        return pow(x(0) - 1, 2) + pow(x(1) - 1, 2) + pow(x(2) - 1, 2) - log(1 + x(3)) + pow(x(4) - 1, 2) + pow(x(5) - 2, 2) + pow(x(6) - 3, 2);
+    };
+    std::vector<anyprog::optimization::inequation_condition_function_t> ineq = {
+        [](const anyprog::real_block& x) {
+            return x.sum() - x(3) - 5;
+        },
+        [](const anyprog::real_block& x) {
+            return pow(x(2), 2) + pow(x(4), 2) + pow(x(5), 2) + pow(x(6), 2) - 5.5;
+        },
+        [](const anyprog::real_block& x) {
+            return x(0) + x(4) - 1.2;
+        },
+        [](const anyprog::real_block& x) {
+            return x(1) + x(5) - 1.8;
+        },
+        [](const anyprog::real_block& x) {
+            return x(2) + x(6) - 2.5;
+        },
+        [](const anyprog::real_block& x) {
+            return x(3) + x(4) - 1.2;
+        },
+        [](const anyprog::real_block& x) {
+            return pow(x(1), 2) + pow(x(5), 2) - 1.64;
+        },
+        [](const anyprog::real_block& x) {
+            return pow(x(2), 2) + pow(x(6), 2) - 4.25;
+        },
+        [](const anyprog::real_block& x) {
+            return pow(x(1), 2) + pow(x(6), 2) - 4.64;
+        }
+    };
+    std::vector<anyprog::optimization::range_t> range = { { 0, 1 }, { 0, 1 }, { 0, 1 }, { 0, 1 }, { 0, 10 }, { 0, 10 }, { 0, 10 } };
+    anyprog::real_block param(range.size(), 1);
+    param.fill(0);
+    std::vector<double> fval;
+    for (size_t threads : { 1, 4 }) {
+        anyprog::optimization opt(obj, param, range);
+        opt.set_inequation_condition(ineq);
+        opt.set_enable_binary_filter({ 0, 1, 2, 3 });
+        opt.set_solver(anyprog::optimization::solver_t::BRANCH_BOUND).set_thread_number(threads);
+        auto start = std::chrono::steady_clock::now();
+        auto ret = opt.search();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        anyprog::print(opt.is_ok(), ret, obj);
+        std::cout << "threads=\t" << threads << "\tseconds=\t" << elapsed << "\tgap=\t" << opt.get_gap() << "\n";
+        fval.push_back(opt.is_ok() ? obj(ret) : 0);
+    }
+    std::cout << "same object=\t" << (fabs(fval[0] - fval[1]) < 1e-4 ? "true" : "false") << "\n";
+
+    anyprog::optimization::max_branch_node = 5;
+    anyprog::optimization limited(obj, param, range);
+    limited.set_inequation_condition(ineq);
+    limited.set_enable_binary_filter({ 0, 1, 2, 3 });
+    limited.set_solver(anyprog::optimization::solver_t::BRANCH_BOUND).set_thread_number(1);
+    auto ret = limited.solve();
+    std::cout << "node limit 5\tok=\t" << limited.is_ok() << "\tobject=\t" << (limited.is_ok() ? obj(ret) : 0) << "\tgap=\t" << limited.get_gap() << "\n";
+
+    return 0;
+}
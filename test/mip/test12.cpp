@@ -0,0 +1,71 @@
+#include "../help.hpp"
+#include <chrono>
+
+// Travelling salesman: p01 (optimal length 291) and 2000 random cities in the unit
+// square, where the improved tour is compared with the plain nearest-neighbour tour.
+// A single city must cost 0 with the dense, packed and cluster-first constructors.
+int main(int argc, char** argv)
+{
+    //https://people.sc.fsu.edu/~jburkardt/datasets/tsp/p01.tsp
+    anyprog::real_block dis(15, 15);
+    dis << 0, 29, 82, 46, 68, 52, 72, 42, 51, 55, 29, 74, 23, 72, 46,
+        29, 0, 55, 46, 42, 43, 43, 23, 23, 31, 41, 51, 11, 52, 21,
+        82, 55, 0, 68, 46, 55, 23, 43, 41, 29, 79, 21, 64, 31, 51,
+        46, 46, 68, 0, 82, 15, 72, 31, 62, 42, 21, 51, 51, 43, 64,
+        68, 42, 46, 82, 0, 74, 23, 52, 21, 46, 82, 58, 46, 65, 23,
+        52, 43, 55, 15, 74, 0, 61, 23, 55, 31, 33, 37, 51, 29, 59,
+        72, 43, 23, 72, 23, 61, 0, 42, 23, 31, 77, 37, 51, 46, 33,
+        42, 23, 43, 31, 52, 23, 42, 0, 33, 15, 37, 33, 33, 31, 37,
+        51, 23, 41, 62, 21, 55, 23, 33, 0, 29, 62, 46, 29, 51, 11,
+        55, 31, 29, 42, 46, 31, 31, 15, 29, 0, 51, 21, 41, 23, 37,
+        29, 41, 79, 21, 82, 33, 77, 37, 62, 51, 0, 65, 42, 59, 61,
+        74, 51, 21, 51, 58, 37, 37, 33, 46, 21, 65, 0, 61, 11, 55,
+        23, 11, 64, 51, 46, 51, 51, 33, 29, 41, 42, 61, 0, 62, 23,
+        72, 52, 31, 43, 65, 29, 46, 31, 51, 23, 59, 11, 62, 0, 59,
+        46, 21, 51, 64, 23, 59, 33, 37, 11, 37, 61, 55, 23, 59, 0;
+    anyprog::optimization::tsp small(dis);
+    std::cout << "path=|";
+    for (auto& i : small.solve()) {
+        std::cout << i << "|";
+    }
+    std::cout << "\ndistance=\t" << small.obj() << "\n";
+
+    size_t n = 2000;
+    anyprog::random rg(0, 1, 2019);
+    std::vector<anyprog::optimization::tsp::point2d_t> city;
+    for (size_t i = 0; i < n; ++i) {
+        double x = rg.generate();
+        city.push_back({ x, rg.generate() });
+    }
+    anyprog::real_block d = anyprog::optimization::tsp::distance(city, [](const anyprog::optimization::tsp::point2d_t& a, const anyprog::optimization::tsp::point2d_t b) {
+        return std::hypot(a.first - b.first, a.second - b.second);
+    });
+    std::vector<char> visited(n, 0);
+    double greedy = 0;
+    visited[0] = 1;
+    for (size_t k = 1, cur = 0; k <= n; ++k) {
+        size_t best = 0;
+        for (size_t j = 0; j < n && k < n; ++j) {
+            if (!visited[j] && (best == 0 || d(cur, j) < d(cur, best))) {
+                best = j;
+            }
+        }
+        greedy += d(cur, best);
+        visited[best] = 1;
+        cur = best;
+    }
+    auto start = std::chrono::steady_clock::now();
+    anyprog::optimization::tsp large(d, 0, 1e10, 2);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "nearest neighbour=\t" << greedy << "\nimproved=\t" << large.obj() << "\texcess removed=\t" << (greedy / large.obj() - 1) * 100 << "%\tseconds=\t" << elapsed << "\n";
+
+    auto euclid = [](const anyprog::optimization::tsp::point2d_t& a, const anyprog::optimization::tsp::point2d_t b) {
+        return std::hypot(a.first - b.first, a.second - b.second);
+    };
+    std::vector<anyprog::optimization::tsp::point2d_t> one(city.begin(), city.begin() + 1);
+    anyprog::optimization::tsp dense(anyprog::optimization::tsp::distance(one, euclid));
+    anyprog::optimization::tsp packed(anyprog::optimization::tsp::packed_distance<float>(one, euclid));
+    anyprog::optimization::tsp cluster(one, euclid, 10);
+    std::cout << "one city dense=\t" << dense.obj() << "\tpacked=\t" << packed.obj() << "\tcluster=\t" << cluster.obj() << "\n";
+    return 0;
+}
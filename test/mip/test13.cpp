@@ -0,0 +1,54 @@
+#include "../help.hpp"
+#include <chrono>
+
+// Distance matrix builders on 3000 GPS stops: the dense block, the packed float
+// triangle and the streamed tiles must agree, also with a tile size of 0 (taken as
+// 1) on the first 50 stops, and tsp runs on the packed form.
+int main(int argc, char** argv)
+{
+    typedef anyprog::optimization::tsp tsp;
+    size_t n = 3000;
+    anyprog::random rg(0, 1, 2019);
+    std::vector<tsp::point2d_t> stop;
+    for (size_t i = 0; i < n; ++i) {
+        double lat = 30 + rg.generate();
+        stop.push_back({ lat, 120 + rg.generate() });
+    }
+    auto f = [](const tsp::point2d_t& a, const tsp::point2d_t b) {
+        return anyprog::gps_distance(a.first, a.second, b.first, b.second);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    anyprog::real_block dense = tsp::distance(stop, f);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "dense seconds=\t" << elapsed << "\tMB=\t" << n * n * sizeof(double) / 1048576.0 << "\n";
+
+    start = std::chrono::steady_clock::now();
+    tsp::packed_block<float> packed = tsp::packed_distance<float>(stop, f);
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "packed seconds=\t" << elapsed << "\tMB=\t" << n * (n + 1) / 2 * sizeof(float) / 1048576.0 << "\n";
+
+    double error = 0;
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = i + 1; j < n; ++j) {
+            error = std::max(error, fabs(packed(i, j) - dense(i, j)) / dense(i, j));
+        }
+    }
+    size_t mismatch = 0;
+    tsp::distance_tiles(stop, f, [&](size_t row, size_t col, const anyprog::real_block& block) {
+        mismatch += (block.array() != dense.block(row, col, block.rows(), block.cols()).array()).count();
+    },
+        512);
+    std::vector<tsp::point2d_t> head(stop.begin(), stop.begin() + 50);
+    size_t tiles = 0;
+    tsp::distance_tiles(head, f, [&](size_t row, size_t col, const anyprog::real_block& block) {
+        ++tiles;
+        mismatch += (block.array() != dense.block(row, col, block.rows(), block.cols()).array()).count();
+    },
+        0);
+    std::cout << "float relative error=\t" << error << "\ttile mismatches=\t" << mismatch << "\tunit tiles=\t" << tiles << "\n";
+
+    tsp a(dense), b(packed);
+    std::cout << "tour dense=\t" << a.obj() << "\ttour packed=\t" << b.obj() << "\n";
+    return 0;
+}
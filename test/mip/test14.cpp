@@ -0,0 +1,46 @@
+#include "../help.hpp"
+#include <chrono>
+
+// Batched gps_distance: the Vincenty batch must reproduce the scalar call, and the
+// Andoyer and haversine modes are measured against it on pairs all over the globe.
+int main(int argc, char** argv)
+{
+    size_t n = 1000000;
+    anyprog::random rg(0, 1, 2019);
+    std::vector<double> lat1(n), lon1(n), lat2(n), lon2(n), scalar(n), batch(n);
+    for (size_t i = 0; i < n; ++i) {
+        lat1[i] = 170 * rg.generate() - 85;
+        lon1[i] = 360 * rg.generate() - 180;
+        lat2[i] = 170 * rg.generate() - 85;
+        lon2[i] = i % 2 == 0 ? lon1[i] + rg.generate() : 360 * rg.generate() - 180;
+    }
+    lat2[0] = lat1[0];
+    lon2[0] = lon1[0];
+    lat1[1] = lat2[1] = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        scalar[i] = anyprog::gps_distance(lat1[i], lon1[i], lat2[i], lon2[i]);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "scalar vincenty seconds=\t" << elapsed << "\n";
+
+    const char* name[] = { "vincenty", "andoyer", "haversine" };
+    for (int method = anyprog::VINCENTY; method <= anyprog::HAVERSINE; ++method) {
+        start = std::chrono::steady_clock::now();
+        anyprog::gps_distance(lat1.data(), lon1.data(), lat2.data(), lon2.data(), batch.data(), n, 1e3,
+            static_cast<anyprog::gps_distance_method_t>(method));
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double absolute = 0, relative = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (scalar[i] > 0) {
+                absolute = std::max(absolute, fabs(batch[i] - scalar[i]));
+                relative = std::max(relative, fabs(batch[i] - scalar[i]) / scalar[i]);
+            }
+        }
+        std::cout << name[method] << " seconds=\t" << elapsed << "\tmax km error=\t" << absolute
+                  << "\tmax relative error=\t" << relative << "\n";
+    }
+    std::cout << "equator=\t" << scalar[1] << "\tsame point=\t" << scalar[0] << "\n";
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "../help.hpp"
+#include <chrono>
+
+// Spatial candidate index: k nearest neighbours against a brute force scan, then tsp
+// and assignment fed with the sparse candidate graph instead of a dense matrix.
+int main(int argc, char** argv)
+{
+    typedef anyprog::optimization::tsp tsp;
+    typedef anyprog::optimization::neighbor_index neighbor_index;
+    typedef anyprog::optimization::assignment assignment;
+    auto f = [](const tsp::point2d_t& a, const tsp::point2d_t b) {
+        return anyprog::gps_distance(a.first, a.second, b.first, b.second);
+    };
+    anyprog::random rg(0, 1, 2019);
+    auto stops = [&](size_t n) {
+        std::vector<tsp::point2d_t> ret;
+        for (size_t i = 0; i < n; ++i) {
+            double lat = 30 + rg.generate();
+            ret.push_back({ lat, 120 + rg.generate() });
+        }
+        return ret;
+    };
+
+    std::vector<tsp::point2d_t> small = stops(2000);
+    neighbor_index index(small);
+    size_t k = 10, mismatch = 0;
+    for (size_t i = 0; i < small.size(); ++i) {
+        std::vector<std::pair<double, size_t>> all;
+        for (size_t j = 0; j < small.size(); ++j) {
+            if (j != i) {
+                all.push_back({ f(small[i], small[j]), j });
+            }
+        }
+        std::partial_sort(all.begin(), all.begin() + k, all.end());
+        std::vector<size_t> knn = index.nearest(small[i], k, i);
+        for (size_t t = 0; t < k; ++t) {
+            mismatch += f(small[i], small[knn[t]]) > all[t].first * 1.005;
+        }
+    }
+    std::cout << "knn ranks more than 0.5% off the vincenty order=\t" << mismatch << "\n";
+
+    tsp dense(tsp::distance(small, f)), sparse(index.candidates(tsp::neighbors, f), small, f);
+    std::cout << "tour dense=\t" << dense.obj() << "\ttour sparse=\t" << sparse.obj() << "\n";
+
+    size_t n = argc > 1 ? atoi(argv[1]) : 100000;
+    std::vector<tsp::point2d_t> big = stops(n);
+    auto start = std::chrono::steady_clock::now();
+    neighbor_index big_index(big);
+    assignment::sparse_block graph = big_index.candidates(tsp::neighbors, f);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << n << " stops candidate graph seconds=\t" << elapsed << "\tedges=\t" << graph.nonZeros() << "\n";
+    start = std::chrono::steady_clock::now();
+    tsp route(graph, big, f);
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << n << " stops tour seconds=\t" << elapsed << "\tkm=\t" << route.obj() << "\tcities=\t" << route.solve().size() << "\n";
+
+    std::vector<tsp::point2d_t> worker = stops(1000), job = stops(1000);
+    anyprog::real_block cost(worker.size(), job.size());
+    for (size_t i = 0; i < worker.size(); ++i) {
+        for (size_t j = 0; j < job.size(); ++j) {
+            cost(i, j) = f(worker[i], job[j]);
+        }
+    }
+    assignment exact(cost), near(neighbor_index(worker).candidates(job, 20, f), 1e-6);
+    std::cout << "assignment dense=\t" << exact.obj() << "\tassignment sparse=\t" << near.obj() << "\n";
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include "../help.hpp"
+#include <chrono>
+
+// Cluster-first route-second tsp on 50000 GPS stops against the single tour over the
+// sparse candidate graph, for two cluster sizes, then on planar points in a square.
+int main(int argc, char** argv)
+{
+    typedef anyprog::optimization::tsp tsp;
+    auto f = [](const tsp::point2d_t& a, const tsp::point2d_t b) {
+        return anyprog::gps_distance(a.first, a.second, b.first, b.second);
+    };
+    size_t n = argc > 1 ? atoi(argv[1]) : 50000;
+    anyprog::random rg(0, 1, 2019);
+    std::vector<tsp::point2d_t> stop;
+    for (size_t i = 0; i < n; ++i) {
+        double lat = 30 + rg.generate();
+        stop.push_back({ lat, 120 + rg.generate() });
+    }
+    auto valid = [&](const std::vector<size_t>& path) {
+        std::vector<char> seen(n, 0);
+        for (size_t i = 0; i + 1 < path.size(); ++i) {
+            seen[path[i]] = 1;
+        }
+        return path.size() == n + 1 && path.front() == path.back() && std::count(seen.begin(), seen.end(), 1) == n;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    tsp whole(anyprog::optimization::neighbor_index(stop).candidates(tsp::neighbors, f), stop, f);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "single tour seconds=\t" << elapsed << "\tkm=\t" << whole.obj() << "\tvalid=\t" << valid(whole.solve()) << "\n";
+
+    for (const auto& size : { 1000, 5000 }) {
+        start = std::chrono::steady_clock::now();
+        tsp split(stop, f, size);
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const tsp::decomposition_t& d = split.decomposition();
+        std::cout << "cluster size=\t" << size << "\tclusters=\t" << d.clusters << "\tseconds=\t" << elapsed
+                  << "\troute=\t" << d.route_seconds << "\tstitch=\t" << d.stitch_seconds
+                  << "\tjoined km=\t" << d.joined << "\tkm=\t" << split.obj() << "\tvalid=\t" << valid(split.solve()) << "\n";
+    }
+
+    auto euclid = [](const tsp::point2d_t& a, const tsp::point2d_t b) {
+        return std::hypot(a.first - b.first, a.second - b.second);
+    };
+    std::vector<tsp::point2d_t> plane;
+    for (size_t i = 0; i < n; ++i) {
+        plane.push_back({ 1000 * rg.generate(), 1000 * rg.generate() });
+    }
+    start = std::chrono::steady_clock::now();
+    tsp flat(plane, euclid, 1000, 0, anyprog::optimization::default_thread_number, false);
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "planar cluster size=\t1000\tseconds=\t" << elapsed << "\tjoined=\t" << flat.decomposition().joined << "\tlength=\t" << flat.obj() << "\tvalid=\t" << valid(flat.solve()) << "\n";
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "../help.hpp"
+#include <chrono>
+
+// Vehicle routing: a 10 stop instance against the exact optimum from subset dynamic
+// programming, then 2000 GPS stops with time windows on 50 vehicles, every route
+// checked independently for load, windows and cost.
+int main(int argc, char** argv)
+{
+    typedef anyprog::optimization::tsp tsp;
+    typedef anyprog::optimization::vrp vrp;
+    anyprog::random rg(0, 1, 2019);
+
+    size_t m = 11;
+    anyprog::real_block xy(m, 2), c(m, m), q(m, 1);
+    rg.fill(xy, 0, 100);
+    for (size_t i = 0; i < m; ++i) {
+        q(i) = i == 0 ? 0 : 1 + floor(rg.generate() * 9);
+        for (size_t j = 0; j < m; ++j) {
+            c(i, j) = floor((xy.row(i) - xy.row(j)).norm());
+        }
+    }
+    double capacity = 20;
+    size_t full = 1 << (m - 1);
+    std::vector<double> tour(full, 1e100), part(full, 1e100);
+    std::vector<std::vector<double>> held(full, std::vector<double>(m, 1e100));
+    for (size_t j = 1; j < m; ++j) {
+        held[1 << (j - 1)][j] = c(0, j);
+    }
+    for (size_t s = 1; s < full; ++s) {
+        double load = 0;
+        for (size_t j = 1; j < m; ++j) {
+            if (s & (1 << (j - 1))) {
+                load += q(j);
+                for (size_t k = 1; k < m; ++k) {
+                    if (!(s & (1 << (k - 1)))) {
+                        double& h = held[s | (1 << (k - 1))][k];
+                        h = std::min(h, held[s][j] + c(j, k));
+                    }
+                }
+                tour[s] = std::min(tour[s], held[s][j] + c(j, 0));
+            }
+        }
+        if (load > capacity) {
+            tour[s] = 1e100;
+        }
+    }
+    part[0] = 0;
+    for (size_t s = 1; s < full; ++s) {
+        size_t low = s & (~s + 1);
+        for (size_t t = s; t > 0; t = (t - 1) & s) {
+            if (t & low) {
+                part[s] = std::min(part[s], part[s ^ t] + tour[t]);
+            }
+        }
+    }
+    vrp small(c, q, capacity, 10);
+    small.solve(1);
+    std::cout << "optimum=\t" << part[full - 1] << "\tvrp=\t" << small.obj() << "\troutes=\t" << small.routes().size() << "\n";
+
+    size_t n = argc > 1 ? atoi(argv[1]) : 2000, vehicles = 50;
+    double seconds = argc > 2 ? atof(argv[2]) : 20;
+    std::vector<tsp::point2d_t> stop(1, tsp::point2d_t(30.5, 120.5));
+    for (size_t i = 1; i < n; ++i) {
+        double lat = 30 + rg.generate();
+        stop.push_back({ lat, 120 + rg.generate() });
+    }
+    anyprog::real_block d = tsp::distance(stop, [](const tsp::point2d_t& a, const tsp::point2d_t b) {
+        return anyprog::gps_distance(a.first, a.second, b.first, b.second);
+    },
+        0);
+    anyprog::real_block travel = d * 1.5, demand(n, 1), service(n, 1);
+    std::vector<anyprog::optimization::range_t> window(n, { 0, 720 });
+    for (size_t i = 1; i < n; ++i) {
+        demand(i) = 1 + floor(rg.generate() * 10);
+        service(i) = 5;
+        double open = rg.generate() * 480;
+        window[i] = { open, open + 240 };
+    }
+    service(0) = 0;
+    demand(0) = 0;
+    vrp fleet(d, demand, 250, vehicles);
+    fleet.set_time_windows(travel, window, service);
+    auto start = std::chrono::steady_clock::now();
+    fleet.solve(seconds);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<size_t> seen(n, 0);
+    double total = 0;
+    size_t broken = 0;
+    for (const auto& r : fleet.routes()) {
+        double load = 0, t = 0;
+        for (size_t k = 1; k < r.size(); ++k) {
+            size_t a = r[k - 1], b = r[k];
+            total += d(a, b);
+            t = std::max(window[b].first, t + service(a) + travel(a, b));
+            broken += t > window[b].second;
+            load += demand(b);
+            ++seen[b];
+        }
+        broken += load > 250;
+    }
+    size_t served = 0;
+    for (size_t i = 1; i < n; ++i) {
+        served += seen[i] == 1;
+    }
+    std::cout << n - 1 << " stops seconds=\t" << elapsed << "\tkm=\t" << fleet.obj() << "\tchecked km=\t" << total
+              << "\troutes=\t" << fleet.routes().size() << "\tserved=\t" << served << "\tunserved=\t" << fleet.unserved().size()
+              << "\tviolations=\t" << broken << "\n";
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "../help.hpp"
+#include <atomic>
+
+// The integer filter maps most points a local solver probes onto a few lattice
+// points, so the same search with an evaluation cache must return the same answer
+// while calling the objective and the conditions far less often. A copy of a cached
+// problem given another objective must not change what the original returns.
+int main(int argc, char** argv)
+{
+    size_t dim = 3;
+    std::atomic<size_t> calls(0);
+    anyprog::optimization::function_t obj = [&](const anyprog::real_block& x) {
+        ++calls;
+        return pow(x(0) - 1, 2) + pow(x(1) - 2, 2) + pow(x(2) - 4, 2);
+    };
+
+    std::vector<anyprog::optimization::inequation_condition_function_t> ineq = {
+        [&](const anyprog::real_block& x) {
+            ++calls;
+            return -x(0) + x(1) + x(2) - 3.5;
+        },
+        [&](const anyprog::real_block& x) {
+            ++calls;
+            return x(0) + x(1) - x(2) - 6;
+        }
+    };
+
+    anyprog::optimization::range_t range = { 0, 100 };
+    size_t count[2];
+    double hit_rate = 0;
+    anyprog::real_block ret[2];
+    for (size_t k = 0; k < 2; ++k) {
+        anyprog::optimization opt(obj, range, dim);
+        opt.set_inequation_condition(ineq);
+        opt.set_enable_integer_filter();
+        opt.set_seed(2019);
+        if (k == 1) {
+            opt.set_evaluation_cache(1 << 16);
+        }
+        calls = 0;
+        ret[k] = opt.search(10, 3);
+        count[k] = calls;
+        hit_rate = opt.get_cache_hit_rate();
+        anyprog::print(opt.is_ok(), ret[k], obj);
+    }
+    std::cout << "same solution=\t" << (ret[0] == ret[1]) << "\n";
+    std::cout << "calls without cache=\t" << count[0] << "\tcalls with cache=\t" << count[1] << "\n";
+    std::cout << "hit rate=\t" << hit_rate << "\n";
+
+    anyprog::optimization a(obj, range, dim);
+    a.set_evaluation_cache(100);
+    double before = a.obj(ret[1]);
+    anyprog::optimization b(a);
+    b.set_fused_function([](const anyprog::real_block& x, anyprog::real_block&, anyprog::real_block&, anyprog::real_block*) {
+        return 100 + x.sum();
+    },
+        0, 0);
+    double copied = b.obj(ret[1]);
+    std::cout << "copy object=\t" << copied << "\toriginal object=\t" << a.obj(ret[1]) << "\tunchanged=\t" << (a.obj(ret[1]) == before && copied != before) << "\n";
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "../help.hpp"
+#include <chrono>
+
+// Anytime linear solving: a 0-1 knapsack with 150 items and 10 weight rows, solved by
+// the LP branch and bound under a 0.3 s budget with a node cap too high to matter,
+// then again with a cancel token raised by the progress function at the second
+// incumbent. Both must come back with their incumbent and the gap left open. A min
+// cost flow LP with its token already raised stops in the simplex after 100 pivots.
+
+int main(int argc, char** argv)
+{
+    size_t n = 150, rows = 10;
+    anyprog::optimization::range_t range = { 0, 1 };
+    anyprog::random rng(0, 1, 2019);
+    anyprog::real_block obj(n, 1), A(rows, n), b(rows, 1);
+    for (size_t i = 0; i < n; ++i) {
+        obj(i, 0) = -std::floor(10 + 90 * rng.generate());
+        for (size_t k = 0; k < rows; ++k) {
+            A(k, i) = std::floor(5 + 45 * rng.generate());
+        }
+    }
+    b = A.rowwise().sum() / 2;
+
+    anyprog::optimization timed(obj, range);
+    timed.set_inequation_condition(A, b);
+    timed.set_enable_binary_filter();
+    timed.set_enable_stats().set_time_budget(0.3);
+    auto begin = std::chrono::steady_clock::now();
+    auto ret = timed.solve(anyprog::optimization::method::LN_COBYLA, 1e-5, 10000000);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    anyprog::optimization::solve_stats stats = timed.get_stats();
+    std::cout << "budget 0.3 s\tobject=\t" << timed.obj(ret) << "\tok=\t" << timed.is_ok() << "\tgap=\t" << timed.get_gap() << "\tresult=\t" << stats.result << "\tnodes=\t" << stats.nodes << "\tseconds=\t" << elapsed << "\n";
+
+    anyprog::optimization::cancel_token token;
+    size_t incumbents = 0;
+    anyprog::optimization cancelled(obj, range);
+    cancelled.set_inequation_condition(A, b);
+    cancelled.set_enable_binary_filter();
+    cancelled.set_enable_stats().set_cancel_token(token).set_progress_function([&](double, const anyprog::real_block&) {
+        if (++incumbents == 2) {
+            token.cancel();
+        }
+    });
+    ret = cancelled.solve(anyprog::optimization::method::LN_COBYLA, 1e-5, 10000000);
+    stats = cancelled.get_stats();
+    std::cout << "cancel at incumbent 2\tobject=\t" << cancelled.obj(ret) << "\tok=\t" << cancelled.is_ok() << "\tgap=\t" << cancelled.get_gap() << "\tresult=\t" << stats.result << "\tnodes=\t" << stats.nodes << "\n";
+
+    size_t side = 20, m = side * side;
+    std::vector<std::pair<size_t, size_t>> arc;
+    for (size_t u = 0; u < m; ++u) {
+        if (u % side + 1 < side) {
+            arc.push_back({ u, u + 1 });
+            arc.push_back({ u + 1, u });
+        }
+        if (u + side < m) {
+            arc.push_back({ u, u + side });
+            arc.push_back({ u + side, u });
+        }
+    }
+    anyprog::real_block cost(arc.size(), 1), E = anyprog::real_block::Zero(m, arc.size()), supply = anyprog::real_block::Zero(m, 1);
+    for (size_t j = 0; j < arc.size(); ++j) {
+        cost(j, 0) = 1 + 9 * rng.generate();
+        E(arc[j].first, j) = 1;
+        E(arc[j].second, j) = -1;
+    }
+    for (size_t k = 0; k < m / 10; ++k) {
+        double s = std::floor(10 * rng.generate());
+        supply(size_t(rng.generate() * m) % m, 0) += s;
+        supply(size_t(rng.generate() * m) % m, 0) -= s;
+    }
+    anyprog::optimization::cancel_token raised;
+    raised.cancel();
+    anyprog::optimization flow(cost, anyprog::optimization::range_t(0, 20));
+    flow.set_equation_condition(E, supply);
+    flow.set_enable_stats().set_cancel_token(raised);
+    flow.solve();
+    std::cout << "cancelled LP\tok=\t" << flow.is_ok() << "\tresult=\t" << flow.get_stats().result << "\n";
+    raised.reset();
+    ret = flow.solve();
+    std::cout << "after reset\tok=\t" << flow.is_ok() << "\tobject=\t" << flow.obj(ret) << "\tresult=\t" << flow.get_stats().result << "\n";
+    return 0;
+}
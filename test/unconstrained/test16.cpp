@@ -0,0 +1,52 @@
+#include "../help.hpp"
+
+// Extended Rosenbrock through the zero-copy callback signature.
+// The global minima: x* =  (1, …, 1), f(x*) = 0.
+// Counts heap allocations made between two consecutive objective evaluations.
+
+extern "C" void* __libc_malloc(size_t);
+
+static size_t malloc_count = 0;
+
+extern "C" void* malloc(size_t n)
+{
+    ++malloc_count;
+    return __libc_malloc(n);
+}
+
+int main(int argc, char** argv)
+{
+    size_t dim = 100, evaluations = 0, allocations = 0, last = 0;
+    anyprog::optimization::map_function_t obj = [&](const anyprog::const_real_vector_map& x, anyprog::real_vector_map& grad) {
+        if (evaluations++ > 0) {
+            allocations += malloc_count - last;
+        }
+        double s = 0;
+        for (size_t i = 0; i + 1 < dim; ++i) {
+            s += 100 * pow(x(i + 1) - x(i) * x(i), 2) + pow(1 - x(i), 2);
+        }
+        if (grad.size() > 0) {
+            grad.setZero();
+            for (size_t i = 0; i + 1 < dim; ++i) {
+                grad(i) += -400 * x(i) * (x(i + 1) - x(i) * x(i)) - 2 * (1 - x(i));
+                grad(i + 1) += 200 * (x(i + 1) - x(i) * x(i));
+            }
+        }
+        last = malloc_count;
+        return s;
+    };
+
+    anyprog::real_block param(dim, 1);
+    param.fill(0);
+    anyprog::optimization opt(obj, param);
+    auto start = std::chrono::steady_clock::now();
+    auto ret = opt.solve(anyprog::optimization::method::LD_LBFGS, 1e-10);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t solve_evaluations = evaluations, solve_allocations = allocations;
+    anyprog::print(opt.is_ok(), ret, [&](const anyprog::real_block& x) { return opt.obj(x); });
+
+    std::cout << "evaluations=\t" << solve_evaluations << "\n";
+    std::cout << "allocations per evaluation=\t" << (solve_evaluations > 1 ? double(solve_allocations) / (solve_evaluations - 1) : 0) << "\n";
+    std::cout << "seconds=\t" << elapsed << "\n";
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "../help.hpp"
+
+// Extended Rosenbrock in 1000 variables, written once over autodiff::var;
+// the gradient for LD_LBFGS comes from the reverse sweep.
+// The global minima: x* =  (1, …, 1), f(x*) = 0.
+
+int main(int argc, char** argv)
+{
+    size_t dim = 1000;
+    anyprog::autodiff::function_t obj = [](const anyprog::autodiff::var_block& x) {
+        anyprog::autodiff::var s = 0;
+        for (size_t i = 0; i + 1 < x.rows(); ++i) {
+            s += 100 * pow(x(i + 1) - x(i) * x(i), 2) + pow(1 - x(i), 2);
+        }
+        return s;
+    };
+
+    anyprog::real_block param(dim, 1);
+    param.fill(0);
+    anyprog::optimization opt(anyprog::autodiff::map_function(obj), param);
+    auto start = std::chrono::steady_clock::now();
+    auto ret = opt.solve(anyprog::optimization::method::LD_LBFGS, 1e-10, 10000);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "object=\t" << opt.obj(ret) << "\n";
+    std::cout << "max |x - 1|=\t" << (ret.array() - 1).abs().maxCoeff() << "\n";
+    std::cout << "seconds=\t" << elapsed << "\n";
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "../help.hpp"
+#include <chrono>
+
+// Rastrigin in 10 variables through the population methods, once point by point and
+// once with a batch objective written over whole columns of candidate points. ESCH
+// and ISRES hand over every generation, CRS its initial population.
+// The global minima: x* = (0, …, 0), f(x*) = 0.
+
+int main(int argc, char** argv)
+{
+    size_t dim = 10, singles = 0, batches = 0, batched = 0;
+    anyprog::optimization::function_t obj = [&](const anyprog::real_block& x) {
+        ++singles;
+        return 10.0 * x.rows() + (x.array().square() - 10 * (2 * M_PI * x.array()).cos()).sum();
+    };
+    anyprog::optimization::batch_function_t batch = [&](const anyprog::real_block& x) {
+        ++batches;
+        batched += x.cols();
+        anyprog::real_block ret = (x.array().square() - 10 * (2 * M_PI * x.array()).cos()).colwise().sum().transpose();
+        return (ret.array() + 10.0 * x.rows()).matrix().eval();
+    };
+
+    std::vector<std::pair<std::string, anyprog::optimization::method>> methods = {
+        { "GN_ESCH", anyprog::optimization::method::GN_ESCH },
+        { "GN_ISRES", anyprog::optimization::method::GN_ISRES },
+        { "GN_CRS2_LM", anyprog::optimization::method::GN_CRS2_LM }
+    };
+    anyprog::real_block start = anyprog::real_block::Constant(dim, 1, 3);
+    for (const auto& m : methods) {
+        for (size_t k = 0; k < 2; ++k) {
+            anyprog::optimization opt(obj, start, std::vector<anyprog::optimization::range_t>(dim, { -5.12, 5.12 }));
+            if (k == 1) {
+                opt.set_batch_function(batch);
+            }
+            singles = batches = batched = 0;
+            auto begin = std::chrono::steady_clock::now();
+            auto ret = opt.solve(m.second, 1e-12, 100000);
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            std::cout << m.first << (k == 1 ? " batch" : " single") << "\tobject=\t" << opt.obj(ret) << "\tsingle calls=\t" << singles << "\tbatch calls=\t" << batches << "\tbatched points=\t" << batched << "\tseconds=\t" << elapsed << "\n";
+        }
+    }
+    return 0;
+}
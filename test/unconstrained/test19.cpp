@@ -0,0 +1,65 @@
+#include "../help.hpp"
+#include <chrono>
+#include <future>
+#include <thread>
+#include <unordered_map>
+
+// Ask/tell against a simulated farm: every evaluation is a 2 ms job on its own thread
+// and the caller only polls, handing requests out and values back. Rosenbrock in 4
+// variables with search() on 8 local solves in flight, then Rastrigin in 6 variables
+// with ISRES, which posts a whole generation at once.
+
+static void drive(anyprog::optimization::ask_tell& at, const anyprog::optimization::function_t& f, const std::string& name)
+{
+    std::unordered_map<size_t, std::future<double>> farm;
+    size_t evaluations = 0, peak = 0;
+    auto begin = std::chrono::steady_clock::now();
+    while (!at.done() || !farm.empty()) {
+        for (const auto& r : at.ask(farm.empty() ? 0.01 : 0)) {
+            anyprog::real_block x = r.x;
+            farm[r.id] = std::async(std::launch::async, [x, &f]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                return f(x);
+            });
+        }
+        peak = std::max(peak, farm.size());
+        for (auto i = farm.begin(); i != farm.end();) {
+            if (i->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                at.tell(i->first, i->second.get());
+                ++evaluations;
+                i = farm.erase(i);
+            } else {
+                ++i;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << name << "\tobject=\t" << f(at.solution()) << "\tevaluations=\t" << evaluations << "\tpeak in flight=\t" << peak << "\tseconds=\t" << elapsed << "\tone at a time=\t" << evaluations * 0.002 << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    anyprog::optimization::function_t rosenbrock = [](const anyprog::real_block& x) {
+        double s = 0;
+        for (size_t i = 0; i + 1 < x.rows(); ++i) {
+            s += 100 * pow(x(i + 1) - x(i) * x(i), 2) + pow(1 - x(i), 2);
+        }
+        return s;
+    };
+    anyprog::optimization::function_t rastrigin = [](const anyprog::real_block& x) {
+        return 10.0 * x.rows() + (x.array().square() - 10 * (2 * M_PI * x.array()).cos()).sum();
+    };
+
+    anyprog::optimization first(rosenbrock, { -2, 2 }, 4);
+    first.set_seed(2019);
+    anyprog::optimization::ask_tell search(first, 8);
+    search.start_search(8, 2, 0.382, anyprog::optimization::method::LN_SBPLX, 1e-6, 300);
+    drive(search, rosenbrock, "search LN_SBPLX");
+
+    anyprog::optimization second(rastrigin, { -5.12, 5.12 }, 6);
+    anyprog::optimization::ask_tell population(second);
+    population.start_solve(anyprog::optimization::method::GN_ISRES, 1e-8, 20000);
+    drive(population, rastrigin, "solve GN_ISRES");
+    return 0;
+}
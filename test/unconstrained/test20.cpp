@@ -0,0 +1,64 @@
+#include "../help.hpp"
+#include <csignal>
+#include <chrono>
+#include <thread>
+
+// A "legacy" objective that keeps its scratch space in statics, so two threads of one
+// process must never run it at once, that brings its process down whenever x(0) > 1.99
+// and that hangs on the 1500th call of a process. Four worker processes carry search()
+// and ESCH while the pool kills and forks workers again. Last, two pools live side by
+// side and the first must go away at once while the second keeps answering.
+// The global minima: x* = (1, …, 1), f(x*) = 0.
+
+static double scratch[16];
+static size_t calls = 0;
+
+static double legacy(const anyprog::real_block& x)
+{
+    if (x(0) > 1.99) {
+        raise(SIGSEGV);
+    }
+    if (++calls == 1500) {
+        std::this_thread::sleep_for(std::chrono::seconds(5));
+    }
+    for (size_t i = 0; i < x.rows(); ++i) {
+        scratch[i] = x(i);
+    }
+    double s = 0;
+    for (size_t i = 0; i + 1 < x.rows(); ++i) {
+        s += 100 * pow(scratch[i + 1] - scratch[i] * scratch[i], 2) + pow(1 - scratch[i], 2);
+    }
+    return s;
+}
+
+int main(int argc, char** argv)
+{
+    size_t dim = 4;
+    anyprog::optimization::process_pool::timeout = 0.2;
+    anyprog::optimization::process_pool::max_restarts = 500;
+    anyprog::optimization::process_pool pool(legacy, 4);
+    std::cout << "workers=\t" << pool.size() << "\n";
+
+    anyprog::optimization opt(legacy, { -2, 2 }, dim);
+    opt.set_seed(2019);
+    opt.set_process_pool(pool);
+    auto ret = opt.search(8, 2, 0.382, anyprog::optimization::method::LN_SBPLX, 1e-8, 2000);
+    std::cout << "search object=\t" << opt.obj(ret) << "\trestarts=\t" << pool.restarts() << "\tworkers=\t" << pool.size() << "\n";
+
+    anyprog::optimization population(legacy, { -2, 2 }, dim);
+    population.set_process_pool(pool);
+    ret = population.solve(anyprog::optimization::method::GN_ESCH, 1e-12, 20000);
+    std::cout << "GN_ESCH object=\t" << population.obj(ret) << "\trestarts=\t" << pool.restarts() << "\tworkers=\t" << pool.size() << "\n";
+    std::cout << "calls in this process=\t" << calls << "\n";
+
+    anyprog::optimization::process_pool* a = new anyprog::optimization::process_pool(legacy, 2);
+    anyprog::optimization::process_pool* b = new anyprog::optimization::process_pool(legacy, 2);
+    auto begin = std::chrono::steady_clock::now();
+    delete a;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    anyprog::real_block one(dim, 1);
+    one.fill(1);
+    std::cout << "first of two pools gone in seconds=\t" << elapsed << "\tsecond answers=\t" << b->evaluate(one) << "\n";
+    delete b;
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "../help.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// A four-thread search() on Rosenbrock in 6 variables, run once plainly and once
+// recording a trace, then GN_ESCH with a batch objective into the same trace. The
+// trace is written to search_trace.json, counted by event name and removed again.
+// The global minima: x* = (1, …, 1), f(x*) = 0.
+
+static size_t count(const std::string& text, const std::string& name)
+{
+    size_t n = 0;
+    for (size_t i = text.find(name); i != std::string::npos; i = text.find(name, i + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+int main(int argc, char** argv)
+{
+    size_t dim = 6;
+    anyprog::optimization::function_t rosenbrock = [](const anyprog::real_block& x) {
+        double s = 0;
+        for (size_t i = 0; i + 1 < x.rows(); ++i) {
+            s += 100 * pow(x(i + 1) - x(i) * x(i), 2) + pow(1 - x(i), 2);
+        }
+        return s;
+    };
+    anyprog::optimization::batch_function_t batch = [&](const anyprog::real_block& x) {
+        anyprog::real_block ret(x.cols(), 1);
+        for (size_t j = 0; j < x.cols(); ++j) {
+            ret(j) = rosenbrock(x.col(j));
+        }
+        return ret;
+    };
+
+    for (size_t k = 0; k < 2; ++k) {
+        anyprog::optimization opt(rosenbrock, { -2, 2 }, dim);
+        opt.set_seed(2019).set_thread_number(4);
+        if (k == 1) {
+            opt.set_enable_trace();
+        }
+        auto begin = std::chrono::steady_clock::now();
+        auto ret = opt.search(40, 10, 0.382, anyprog::optimization::method::LN_SBPLX, 1e-8, 2000);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << (k == 1 ? "traced" : "plain") << "\tobject=\t" << opt.obj(ret) << "\tseconds=\t" << elapsed << "\n";
+        if (k == 1) {
+            opt.set_batch_function(batch);
+            ret = opt.solve(anyprog::optimization::method::GN_ESCH, 1e-12, 20000);
+            std::cout << "GN_ESCH\tobject=\t" << opt.obj(ret) << "\twritten=\t" << opt.write_trace("search_trace.json") << "\n";
+        }
+    }
+
+    std::stringstream text;
+    {
+        std::ifstream in("search_trace.json");
+        text << in.rdbuf();
+    }
+    std::remove("search_trace.json");
+    std::cout << "threads=\t" << count(text.str(), "\"thread_name\"") << "\tsearch=\t" << count(text.str(), "\"search\"") << "\trounds=\t" << count(text.str(), "\"round\"") << "\tlocal solves=\t" << count(text.str(), "\"local solve\"") << "\tbatches=\t" << count(text.str(), "\"batch\"") << "\tincumbents=\t" << count(text.str(), "\"incumbent\"") << "\n";
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include "../help.hpp"
+#include <chrono>
+#include <thread>
+
+// Anytime solving on Rosenbrock in 8 variables with an objective that sleeps 50 µs a
+// call: a two-thread search() under a 0.5 s budget that reports every incumbent, then
+// an ISRES run with a huge evaluation limit that another thread cancels after 0.3 s.
+// Both must come back on time with the best point they had found.
+// The global minima: x* = (1, …, 1), f(x*) = 0.
+
+int main(int argc, char** argv)
+{
+    size_t dim = 8;
+    anyprog::optimization::function_t obj = [](const anyprog::real_block& x) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        double s = 0;
+        for (size_t i = 0; i + 1 < x.rows(); ++i) {
+            s += 100 * pow(x(i + 1) - x(i) * x(i), 2) + pow(1 - x(i), 2);
+        }
+        return s;
+    };
+
+    size_t incumbents = 0;
+    double last = HUGE_VAL;
+    anyprog::optimization opt(obj, { -2, 2 }, dim);
+    opt.set_seed(2019).set_thread_number(2).set_time_budget(0.5).set_progress_function([&](double value, const anyprog::real_block&) {
+        ++incumbents;
+        last = value;
+    });
+    auto begin = std::chrono::steady_clock::now();
+    auto ret = opt.search(1000, 1000, 0.382, anyprog::optimization::method::LN_SBPLX, 1e-8, 2000);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "budget 0.5 s\tobject=\t" << opt.obj(ret) << "\tok=\t" << opt.is_ok() << "\tincumbents=\t" << incumbents << "\tlast reported=\t" << last << "\tseconds=\t" << elapsed << "\n";
+
+    anyprog::optimization::cancel_token token;
+    anyprog::optimization population(obj, { -2, 2 }, dim);
+    population.set_seed(2019).set_cancel_token(token);
+    std::thread stopper([token]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        token.cancel();
+    });
+    begin = std::chrono::steady_clock::now();
+    ret = population.solve(anyprog::optimization::method::GN_ISRES, 1e-12, 1000000);
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    stopper.join();
+    std::cout << "cancel 0.3 s\tobject=\t" << population.obj(ret) << "\tok=\t" << population.is_ok() << "\tcancelled=\t" << token.is_cancelled() << "\tseconds=\t" << elapsed << "\n";
+    return 0;
+}
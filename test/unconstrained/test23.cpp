@@ -0,0 +1,34 @@
+#include "../help.hpp"
+
+// Stochastic NLopt methods under a fixed seed: GN_CRS2_LM and GN_ISRES searches of
+// Rastrigin in 5 variables, each run twice on one thread and twice on four threads,
+// must return the same point every time.
+// The global minima: x* = (0, …, 0), f(x*) = 0.
+
+int main(int argc, char** argv)
+{
+    size_t dim = 5;
+    anyprog::optimization::function_t rastrigin = [](const anyprog::real_block& x) {
+        double s = 10 * x.rows();
+        for (size_t i = 0; i < static_cast<size_t>(x.rows()); ++i) {
+            s += x(i) * x(i) - 10 * cos(2 * M_PI * x(i));
+        }
+        return s;
+    };
+
+    for (auto m : { anyprog::optimization::method::GN_CRS2_LM, anyprog::optimization::method::GN_ISRES }) {
+        std::vector<anyprog::real_block> ret;
+        for (size_t threads : { 1, 1, 4, 4 }) {
+            anyprog::optimization opt(rastrigin, { -5.12, 5.12 }, dim);
+            opt.set_seed(42).set_thread_number(threads);
+            ret.push_back(opt.search(8, 3, 0.382, m, 1e-6, 300));
+            std::cout << "threads=\t" << threads << "\tobject=\t" << opt.obj(ret.back()) << "\n";
+        }
+        bool same = true;
+        for (const auto& r : ret) {
+            same = same && r == ret[0];
+        }
+        std::cout << "same result=\t" << (same ? "true" : "false") << "\n";
+    }
+    return 0;
+}